@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+// Raw CAN frame as read from the controller, stamped on reception
+struct CANFrame {
+    uint32_t id;
+    uint32_t timestampUs; // micros() when the frame was read from the controller
+    uint8_t len;
+    uint8_t data[8];
+};
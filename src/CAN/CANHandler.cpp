@@ -1,193 +1,763 @@
-#include "CANHandler.hpp"
-#include <regex>
-
-#include "../LOG/LogHandler.hpp"
-#include "../SETTINGS/SettingsHandler.hpp"
-
-CANHandler::CANHandler(int csPin, std::map<byte, PIDConfig>& pidMapRef) : can(csPin), pidMap(pidMapRef) {}
-
-bool CANHandler::begin() {
-    if (can.begin(MCP_ANY, CAN_500KBPS, MCP_8MHZ) == CAN_OK) {
-        LogHandler::writeMessage(LogHandler::DebugType::CAN, String("MCP2515 Initialized Successfully!"));
-        can.setMode(MCP_NORMAL);
-        canInitialized = true;
-        return true;
-    } else {
-        LogHandler::writeMessage(LogHandler::DebugType::CAN, String("Error Initializing MCP2515..."));
-        return false;
-    }
-}
-
-
-void CANHandler::sendRequests() {
-    if (!canInitialized || pidMap.empty()) return;
-
-    unsigned long currentTime = millis();
-
-    // If not waiting for a response, and enough time has passed since last response, send next PID
-    if (!waitingForResponse && (currentTime - lastResponseTime >= 100) && (currentTime - lastIterationTime >= SettingsHandler::getCanRequestInterval())) {
-        if (!pidQueue.empty()) {
-            currentPid = pidQueue.front();
-            pidQueue.pop();
-            byte request[] = {0x02, 0x01, currentPid, 0x00, 0x00, 0x00, 0x00, 0x00};
-            if (can.sendMsgBuf(obdRequestId, 0, 8, request) == CAN_OK) {
-                LogHandler::writeMessage(LogHandler::DebugType::CAN, String("Request sent for PID: ") + String(currentPid, HEX) + " (" + pidMap[currentPid].label + ")");
-                waitingForResponse = true;
-                lastRequestTime = currentTime;
-            } else {
-                LogHandler::writeMessage(LogHandler::DebugType::CAN, String("Error sending request for PID: ") + String(currentPid, HEX));
-                waitingForResponse = false;
-                lastResponseTime = currentTime; // Skip to next PID after error
-            }
-        }
-    }
-    // Timeout: if waiting for response and too much time has passed, skip to next PID
-    if (waitingForResponse && (currentTime - lastRequestTime >= SettingsHandler::getCanResponseThreshold())) {
-        LogHandler::writeMessage(LogHandler::DebugType::CAN, String("Timeout waiting for response for PID: ") + String(currentPid, HEX));
-        waitingForResponse = false;
-        lastResponseTime = currentTime;
-    }
-}
-
-bool CANHandler::handleResponses(std::vector<CANResponse>& results) {
-    unsigned long rxId;
-    byte len;
-    static byte rxBuf[8];
-    while (can.checkReceive() == CAN_MSGAVAIL) {
-        can.readMsgBuf(&rxId, &len, rxBuf);
-        if (rxId == ecuResponseId && len >= 3 && rxBuf[1] == 0x41) {
-            byte pid = rxBuf[2];
-            if (pidMap.find(pid) != pidMap.end()) {
-                if (waitingForResponse && pid == currentPid) {
-                    waitingForResponse = false;
-                    lastResponseTime = millis();
-                }
-                String pidLabel = getLabelForPID(pid);
-                String humanReadable = convertToHumanReadable(pid, rxBuf);
-                LogHandler::writeMessage(LogHandler::DebugType::CAN, String("Received Response: ") + pidLabel + " -> " + humanReadable, false);
-                results.push_back({pidLabel, humanReadable});
-                break;
-            }
-        }
-    }
-
-    if (pidQueue.empty() && !waitingForResponse) {
-        lastIterationTime = millis();
-        // If the queue is empty and not waiting for a response, refill the queue
-        for (const auto& entry : pidMap) {
-            pidQueue.push(entry.first);
-        }
-        return true;
-    }
-
-    return false;
-}
-
-String CANHandler::convertToHumanReadable(byte pid, byte* rxBuf) {
-    if (!rxBuf) return "No Data";
-    if (pidMap.find(pid) == pidMap.end()) return "Unknown PID";
-
-    const PIDConfig& config = pidMap[pid];
-    String formula = config.formula;
-    if (formula.isEmpty()) return "No formula";
-
-    // Replace B3, B4, ... with actual values
-    formula.replace("B3", String(rxBuf[3]));
-    formula.replace("B4", String(rxBuf[4]));
-    formula.replace("B5", String(rxBuf[5]));
-    formula.replace("B6", String(rxBuf[6]));
-    formula.replace("B7", String(rxBuf[7]));
-
-    // Also support A, B, C, D as aliases for B3, B4, B5, B6
-    formula.replace("A", String(rxBuf[3]));
-    formula.replace("B", String(rxBuf[4]));
-    formula.replace("C", String(rxBuf[5]));
-    formula.replace("D", String(rxBuf[6]));
-
-    double result = 0.0;
-    bool evalOk = false;
-
-    // Support (B3 * 100) / 255 or (A * 100) / 255
-    if (formula.indexOf('*') != -1 && formula.indexOf('/') != -1 && formula.indexOf("100") != -1 && formula.indexOf("255") != -1) {
-        int a;
-        if (sscanf(formula.c_str(), "(%d * 100) / 255", &a) == 1) {
-            result = (a * 100.0) / 255.0;
-            evalOk = true;
-        }
-    }
-    // Existing patterns...
-    else if (formula.indexOf('*') != -1 && formula.indexOf('+') != -1 && formula.indexOf('/') != -1) {
-        int a, b, c;
-        if (sscanf(formula.c_str(), "((%d * 256) + %d) / %d", &a, &b, &c) == 3) {
-            result = ((a * 256) + b) / (double)c;
-            evalOk = true;
-        }
-    } else if (formula.indexOf('-') != -1) {
-        int a, b;
-        if (sscanf(formula.c_str(), "%d - %d", &a, &b) == 2) {
-            result = a - b;
-            evalOk = true;
-        }
-    } else if (formula.indexOf('/') != -1) {
-        int a, b;
-        if (sscanf(formula.c_str(), "%d / %d", &a, &b) == 2 && b != 0) {
-            result = a / (double)b;
-            evalOk = true;
-        }
-    } else if (formula.indexOf('+') != -1) {
-        int a, b;
-        if (sscanf(formula.c_str(), "%d + %d", &a, &b) == 2) {
-            result = a + b;
-            evalOk = true;
-        }
-    } else if (formula.indexOf('*') != -1) {
-        int a, b;
-        if (sscanf(formula.c_str(), "%d * %d", &a, &b) == 2) {
-            result = a * b;
-            evalOk = true;
-        }
-    } else {
-        // Just a number
-        result = atof(formula.c_str());
-        evalOk = true;
-    }
-
-    if (evalOk) {
-        return String(result);
-    } else {
-        return "Eval error: " + formula;
-    }
-}
-
-// String CANHandler::convertToHumanReadable(byte pid, byte* rxBuf) {
-//     if (!rxBuf) return "No Data";
-
-//     int value = 0;
-//     if (pidMap.find(pid) == pidMap.end()) return "Unknown PID";
-
-//     String label = pidMap[pid];
-//     if (label == "RPM") {
-//         value = ((rxBuf[3] * 256) + rxBuf[4]) / 4;
-//         return String(value);
-//     } else if (label == "Speed") {
-//         value = rxBuf[3];
-//         return String(value);
-//     } else if (label == "Coolant_Temp") {
-//         value = rxBuf[3] - 40;
-//         return String(value);
-//     } else if (label == "Oil_Temp") {
-//         value = rxBuf[3] - 40;
-//         return String(value);
-//     } else if (label == "MAF") {
-//         float maf = ((rxBuf[3] * 256) + rxBuf[4]) / 100.0;
-//         return String(maf);
-//     }
-//     return "Unknown Data";
-// }
-
-String CANHandler::getLabelForPID(byte pid) {
-    if (pidMap.find(pid) != pidMap.end()) {
-        return pidMap[pid].label;
-    }
-    return "Unknown PID";
+#include "CANHandler.hpp"
+
+#include "../LOG/LogHandler.hpp"
+#include "../SETTINGS/SettingsHandler.hpp"
+
+TaskHandle_t CANHandler::rxTaskHandle = nullptr;
+
+CANHandler::CANHandler(CANController& controller, SharedPIDTable& pidTables, int intPin)
+    : can(controller), intPin(intPin), sharedPids(pidTables), pids(std::make_shared<const PIDTable>()) {}
+
+bool CANHandler::begin() {
+    if (can.begin()) {
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("CAN controller initialized successfully!"));
+        canInitialized = true;
+
+        // Only let OBD responses through while polling PIDs
+        setFilterMode(FilterMode::OBD_RESPONSES);
+        startDiscovery();
+
+        // Move reception to a high priority task woken by the INT line
+        if (intPin >= 0 && rxTaskHandle == nullptr) {
+            spiMutex = xSemaphoreCreateMutex();
+            xTaskCreatePinnedToCore(rxTask, "can_rx", 4096, this, configMAX_PRIORITIES - 2, &rxTaskHandle, xPortGetCoreID());
+            pinMode(intPin, INPUT_PULLUP);
+            attachInterrupt(digitalPinToInterrupt(intPin), onInterrupt, FALLING);
+            LOG_MESSAGE(LogHandler::DebugType::CAN, String("CAN interrupt reception enabled on pin ") + String(intPin));
+        }
+        return true;
+    } else {
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("Error initializing CAN controller..."));
+        return false;
+    }
+}
+
+
+bool CANHandler::setFilterMode(FilterMode mode) {
+    bool result = true;
+    if (mode == FilterMode::ACCEPT_ALL) {
+        result = programFilters(0, nullptr, 0);
+    } else if (mode == FilterMode::OBD_RESPONSES) {
+        // 0x7E8 - 0x7EF only differ in the lowest three bits
+        const unsigned long first = OBD_RESPONSE_ID_FIRST;
+        result = programFilters(0x7FF & ~(OBD_RESPONSE_ID_LAST - OBD_RESPONSE_ID_FIRST), &first, 1);
+    }
+    if (result) {
+        filterMode = mode;
+    }
+    return result;
+}
+
+bool CANHandler::setAcceptanceFilter(const unsigned long* ids, byte count) {
+    if (!ids || count == 0) return false;
+
+    unsigned long mask = 0x7FF;
+    if (count > FILTER_COUNT) {
+        // Keep only the bits every ID agrees on
+        for (byte i = 1; i < count; i++) {
+            mask &= ~(ids[i] ^ ids[0]);
+        }
+        count = 1;
+    }
+
+    if (!programFilters(mask, ids, count)) return false;
+    filterMode = FilterMode::CUSTOM;
+    return true;
+}
+
+bool CANHandler::programFilters(unsigned long mask, const unsigned long* ids, byte count) {
+    if (!canInitialized) return false;
+
+    bool ok = true;
+    lockBus();
+    for (byte i = 0; i < CANController::MASK_COUNT; i++) {
+        ok &= can.setMask(i, mask);
+    }
+    for (byte i = 0; i < FILTER_COUNT; i++) {
+        unsigned long id = count > 0 ? ids[i % count] & mask : 0;
+        ok &= can.setFilter(i, id);
+    }
+    unlockBus();
+
+    if (ok) {
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("CAN acceptance filter set, mask: ") + String(mask, HEX) + ", IDs: " + String(count));
+    } else {
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("Error programming CAN acceptance filter"));
+    }
+    return ok;
+}
+
+void CANHandler::lockBus() {
+    if (spiMutex) xSemaphoreTake(spiMutex, portMAX_DELAY);
+}
+
+void CANHandler::unlockBus() {
+    if (spiMutex) xSemaphoreGive(spiMutex);
+}
+
+void CANHandler::reloadPIDs() {
+    unsigned long now = millis();
+    defaultPeriodMs = SettingsHandler::getCanRequestInterval();
+
+    // Drop PIDs that are no longer configured or turned out unsupported
+    for (byte pid = 0; ; pid++) {
+        if (scheduler.contains(pid) && !isPolled(pid)) {
+            scheduler.remove(pid);
+        }
+        if (pid == 0xFF) break;
+    }
+
+    // Add new PIDs and update rates, keeping deadlines of existing ones
+    for (const PIDConfig& config : *pids) {
+        if (!isPolled(config.pid)) {
+            LOG_MESSAGE(LogHandler::DebugType::WARNING, String("PID ") + String(config.pid, HEX) + " (" + config.label + ") not supported by the vehicle, not polled");
+            continue;
+        }
+        unsigned long period = config.periodMs > 0 ? config.periodMs : defaultPeriodMs;
+        if (!scheduler.set(config.pid, period, config.priority, now)) {
+            LOG_MESSAGE(LogHandler::DebugType::WARNING, String("Scheduler full, PID not polled: ") + String(config.pid, HEX));
+        }
+    }
+    publishPIDSupport();
+}
+
+void CANHandler::applyPublishedPIDs() {
+    uint32_t version = sharedPids.getVersion();
+    if (version == pidsVersion) return;
+    pidsVersion = version;
+    pids = sharedPids.load();
+    reloadPIDs();
+    LOG_MESSAGE(LogHandler::DebugType::CAN, String("Applied new PID config: ") + String((unsigned)pids->size()) + " PIDs");
+}
+
+void CANHandler::sendRequests() {
+    applyPublishedPIDs();
+    if (!canInitialized || pids->empty()) return;
+
+    // Pick up a changed default request interval
+    if (defaultPeriodMs != (unsigned long)SettingsHandler::getCanRequestInterval()) {
+        reloadPIDs();
+    }
+
+    unsigned long currentTime = millis();
+
+    if (discoveryRequested.exchange(false)) {
+        if (supportCache && vin[0] != '\0') {
+            char name[32];
+            cacheName(name, sizeof(name));
+            supportCache->remove(name);
+        }
+        startDiscovery();
+    } else if (discovery == Discovery::FAILED && currentTime - discoveryFailedTime >= DISCOVERY_RETRY_MS) {
+        startDiscovery();
+    }
+
+    // Diagnostic and discovery requests go ahead of the PID schedule
+    if (!waitingForResponse && (currentTime - lastResponseTime >= MIN_REQUEST_GAP_MS)) {
+        // Claimed here, requestVIN() / requestStoredDTCs() queue from other tasks
+        byte service = queuedService.exchange(0);
+        if (service == 0 && discovery == Discovery::VIN) service = OBDPids::SERVICE_VEHICLE_INFO;
+        if (service != 0) {
+            sendDiagnosticRequest(service, currentTime);
+        } else if (discovery == Discovery::BITMAPS) {
+            sendBitmapRequest(currentTime);
+        }
+    }
+
+    // If not waiting for a response, and enough time has passed since last response, send the PIDs that are due
+    if (!waitingForResponse && !isDiscovering() && (currentTime - lastResponseTime >= MIN_REQUEST_GAP_MS) && scheduler.timeUntilNext(currentTime) == 0) {
+        packPendingPids(currentTime);
+        pendingService = OBDPids::SERVICE_CURRENT_DATA;
+
+        if (pendingCount > 0) {
+            byte request[8] = {0};
+            request[0] = 1 + pendingCount; // Single frame length: service + PIDs
+            request[1] = OBDPids::SERVICE_CURRENT_DATA;
+            memcpy(&request[2], pendingPids, pendingCount);
+
+            lockBus();
+            bool sent = can.send(obdRequestId, request, 8);
+            unlockBus();
+
+            metrics.beginRequest(pendingPids, pendingCount, currentTime);
+            if (sent) {
+                logPendingPids(LogFormat::CAN_REQUEST_SENT);
+                for (byte i = 0; i < pendingCount; i++) {
+                    scheduler.reschedule(pendingPids[i], currentTime);
+                }
+                waitingForResponse = true;
+                lastRequestTime = currentTime;
+            } else {
+                logPendingPids(LogFormat::CAN_REQUEST_FAILED);
+                metrics.endRequest(CANMetrics::Outcome::SEND_FAILED);
+                for (byte i = 0; i < pendingCount; i++) {
+                    scheduler.restore(pendingPids[i]); // Retry after the gap
+                }
+                waitingForResponse = false;
+                lastResponseTime = currentTime;
+            }
+        }
+    }
+    // Timeout: if waiting for response and too much time has passed, skip to next PIDs
+    unsigned long timeout = SettingsHandler::getCanResponseThreshold();
+    if (isDiscoveryPending() && timeout > DISCOVERY_TIMEOUT_MS) timeout = DISCOVERY_TIMEOUT_MS;
+    if (waitingForResponse && (currentTime - lastRequestTime >= timeout)) {
+        bool discoveryPending = isDiscoveryPending();
+        if (pendingService == OBDPids::SERVICE_CURRENT_DATA) {
+            logPendingPids(LogFormat::CAN_RESPONSE_TIMEOUT);
+            metrics.endRequest(CANMetrics::Outcome::TIMEOUT);
+        } else {
+            LOG_MESSAGE(LogHandler::DebugType::CAN, String("Timeout waiting for response for ") + describePendingPids());
+        }
+        waitingForResponse = false;
+        lastResponseTime = currentTime;
+        if (discoveryPending) onDiscoveryUnanswered(currentTime);
+    }
+
+    if (currentTime - lastHealthTime >= HEALTH_INTERVAL_MS) {
+        lastHealthTime = currentTime;
+        publishHealth();
+    }
+
+    if (currentTime - lastStatsReportTime >= STATS_REPORT_INTERVAL_MS) {
+        lastStatsReportTime = currentTime;
+        logSchedulerStats();
+    }
+}
+
+void CANHandler::packPendingPids(unsigned long now) {
+    // Take due PIDs in deadline order while the positive response (service
+    // byte + PID/data pairs) fits the ISO-TP receive buffer. PIDs that do not
+    // fit go back to the scheduler untouched.
+    byte deferred[PIDScheduler::MAX_ENTRIES];
+    byte deferredCount = 0;
+    pendingCount = 0;
+    uint16_t responseLength = 1;
+    byte pid;
+    while (pendingCount < OBDPids::MAX_PIDS_PER_REQUEST && scheduler.popDue(now, pid)) {
+        if (!isPolled(pid)) {
+            scheduler.remove(pid);
+            continue;
+        }
+
+        byte dataLength = OBDPids::dataLength(pid);
+        if (dataLength == 0) {
+            // Unknown response length, it can only be parsed when requested alone
+            if (pendingCount > 0) {
+                deferred[deferredCount++] = pid;
+                continue;
+            }
+            pendingPids[pendingCount++] = pid;
+            break;
+        }
+        if (responseLength + 1 + dataLength > IsoTpSession::MAX_PAYLOAD) {
+            deferred[deferredCount++] = pid;
+            continue;
+        }
+
+        pendingPids[pendingCount++] = pid;
+        responseLength += 1 + dataLength;
+    }
+
+    for (byte i = 0; i < deferredCount; i++) {
+        scheduler.restore(deferred[i]);
+    }
+}
+
+void CANHandler::logSchedulerStats() {
+    PIDScheduler::Stats stats;
+    for (size_t i = 0; scheduler.getStats(i, stats); i++) {
+        String line = String("PID ") + String(stats.pid, HEX) + " (" + getLabelForPID(stats.pid) + "): " + String(stats.achievedHz) + " / " + String(stats.targetHz) + " Hz, " + String(stats.samples) + " of " + String(stats.requests) + " answered";
+        const CANMetrics::PIDMetrics* pid = metrics.get(stats.pid);
+        if (pid) {
+            line += String(", ") + String(pid->timeouts) + " timeouts, " + String(pid->negative) + " negative, " + String(pid->unanswered) + " unanswered, p99 " + String(CANMetrics::latencyPercentileMs(*pid, 990)) + " ms";
+        }
+        LOG_MESSAGE(LogHandler::DebugType::CAN, line);
+    }
+}
+
+void CANHandler::publishHealth() {
+    CANController::ErrorState state;
+    lockBus();
+    bool hasErrorState = can.readErrorState(state);
+    unlockBus();
+    if (hasErrorState) metrics.onErrorState(state);
+
+    std::lock_guard<std::mutex> lock(healthMutex);
+    metrics.copyTo(healthSnapshot);
+    for (uint8_t i = 0; i < healthSnapshot.pidCount; i++) {
+        CANMetrics::PIDMetrics& pid = healthSnapshot.pids[i];
+        pid.achievedHz = scheduler.getAchievedHz(pid.pid);
+    }
+}
+
+void CANHandler::getHealth(CANMetrics::Snapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(healthMutex);
+    snapshot.pidCount = healthSnapshot.pidCount;
+    memcpy(snapshot.pids, healthSnapshot.pids, healthSnapshot.pidCount * sizeof(CANMetrics::PIDMetrics));
+    snapshot.bus = healthSnapshot.bus;
+}
+
+bool CANHandler::isPending(byte pid) const {
+    for (byte i = 0; i < pendingCount; i++) {
+        if (pendingPids[i] == pid) return true;
+    }
+    return false;
+}
+
+void CANHandler::logPendingPids(LogFormat format) {
+    uint32_t first, second;
+    LogHandler::packPids(pendingPids, pendingCount, first, second);
+    LogHandler::writeBinary(format, first, second);
+}
+
+String CANHandler::describePendingPids() {
+    if (pendingService != OBDPids::SERVICE_CURRENT_DATA) {
+        return String("service ") + String(pendingService, HEX);
+    }
+
+    String description;
+    for (byte i = 0; i < pendingCount; i++) {
+        if (i > 0) description += ", ";
+        description += String(pendingPids[i], HEX) + " (" + getLabelForPID(pendingPids[i]) + ")";
+    }
+    return description;
+}
+
+void IRAM_ATTR CANHandler::onInterrupt() {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(rxTaskHandle, &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
+void CANHandler::rxTask(void* param) {
+    CANHandler* handler = static_cast<CANHandler*>(param);
+    while (true) {
+        // The timeout is a safety net in case a falling edge is missed
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        handler->drainController();
+    }
+}
+
+void CANHandler::drainController() {
+    // Empty both RX buffers; INT stays low until they are both read
+    while (true) {
+        CANFrame frame;
+        xSemaphoreTake(spiMutex, portMAX_DELAY);
+        bool available = can.receive(frame);
+        xSemaphoreGive(spiMutex);
+        if (!available) break;
+
+        frame.timestampUs = micros();
+        rxCounters.receivedFrames.fetch_add(1, std::memory_order_relaxed);
+        if (!rxRing.push(frame)) {
+            rxCounters.droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        } else if (rxRing.size() > rxCounters.ringHighWater.load(std::memory_order_relaxed)) {
+            rxCounters.ringHighWater.store(rxRing.size(), std::memory_order_relaxed);
+        }
+    }
+}
+
+bool CANHandler::readFrame(CANFrame& frame) {
+    if (rxTaskHandle) {
+        if (!rxRing.pop(frame)) return false;
+        unsigned long latency = micros() - frame.timestampUs;
+        if (latency > rxCounters.maxLatencyUs.load(std::memory_order_relaxed)) rxCounters.maxLatencyUs.store(latency, std::memory_order_relaxed);
+        return true;
+    }
+
+    // No interrupt line configured, poll the controller directly
+    if (!can.receive(frame)) return false;
+    frame.timestampUs = micros();
+    rxCounters.receivedFrames.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+CANHandler::RxStats CANHandler::getRxStats() const {
+    // Each counter has a single writer; the copy is per field, not a snapshot
+    // of all four at one instant
+    RxStats stats;
+    stats.receivedFrames = rxCounters.receivedFrames.load(std::memory_order_relaxed);
+    stats.droppedFrames = rxCounters.droppedFrames.load(std::memory_order_relaxed);
+    stats.maxLatencyUs = rxCounters.maxLatencyUs.load(std::memory_order_relaxed);
+    stats.ringHighWater = rxCounters.ringHighWater.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool CANHandler::handleResponses(std::vector<SampleRecord>& results) {
+    size_t resultCount = results.size();
+    unsigned long now = millis();
+    applyIsoTpSettings();
+
+    CANFrame frame;
+    while (readFrame(frame)) {
+        if (frame.id < OBD_RESPONSE_ID_FIRST || frame.id > OBD_RESPONSE_ID_LAST) {
+            softwareFilteredFrames++;
+            continue;
+        }
+
+        // Every ECU gets its own ISO-TP session so interleaved replies do not mix
+        byte ecu = frame.id - OBD_RESPONSE_ID_FIRST;
+        IsoTpSession& session = isoTpSessions[ecu];
+        byte flowControl[8];
+        switch (session.onFrame(frame.data, frame.len, now, flowControl)) {
+            case IsoTpSession::Result::FLOW_CONTROL:
+                lockBus();
+                can.send(OBD_PHYSICAL_REQUEST_ID_FIRST + ecu, flowControl, 8);
+                unlockBus();
+                break;
+            case IsoTpSession::Result::COMPLETE:
+                handleMessage(frame.id, session.payload(), session.payloadLength(), results);
+                break;
+            case IsoTpSession::Result::ERROR:
+                LogHandler::writeBinary(LogFormat::ISOTP_ERROR, frame.id);
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (byte ecu = 0; ecu < ECU_COUNT; ecu++) {
+        if (isoTpSessions[ecu].checkTimeout(now)) {
+            LogHandler::writeBinary(LogFormat::ISOTP_TIMEOUT, OBD_RESPONSE_ID_FIRST + ecu);
+        }
+    }
+
+    return results.size() > resultCount;
+}
+
+void CANHandler::handleMessage(unsigned long rxId, const byte* payload, uint16_t length, std::vector<SampleRecord>& results) {
+    if (length < 2) return;
+
+    byte service = payload[0];
+    if (service == OBDPids::NEGATIVE_RESPONSE) {
+        if (length >= 3 && payload[1] == pendingService) {
+            LogHandler::writeBinary(LogFormat::CAN_NEGATIVE_RESPONSE, payload[2], pendingService);
+            metrics.endRequest(CANMetrics::Outcome::NEGATIVE);
+            bool discoveryPending = isDiscoveryPending();
+            finishRequest();
+            if (discoveryPending) onDiscoveryUnanswered(millis());
+        }
+        return;
+    }
+
+    switch (service - OBDPids::POSITIVE_RESPONSE_OFFSET) {
+        case OBDPids::SERVICE_CURRENT_DATA:
+            // PID values are only taken from the primary ECU; six PIDs never exceed 255 bytes
+            if (rxId == ecuResponseId && length <= 0x100 && parseCurrentDataResponse(rxId, &payload[1], length - 1, results)) {
+                metrics.endRequest(CANMetrics::Outcome::ANSWERED);
+                finishRequest();
+            }
+            break;
+        case OBDPids::SERVICE_VEHICLE_INFO:
+            parseVehicleInfo(payload, length);
+            if (pendingService == OBDPids::SERVICE_VEHICLE_INFO && waitingForResponse) {
+                finishRequest();
+                if (discovery == Discovery::VIN) onVINRead();
+            }
+            break;
+        case OBDPids::SERVICE_STORED_DTCS:
+            parseStoredDTCs(payload, length);
+            if (pendingService == OBDPids::SERVICE_STORED_DTCS) finishRequest();
+            break;
+        default:
+            break;
+    }
+}
+
+void CANHandler::finishRequest() {
+    if (waitingForResponse) {
+        waitingForResponse = false;
+        lastResponseTime = millis();
+    }
+}
+
+void CANHandler::requestVIN() {
+    queuedService = OBDPids::SERVICE_VEHICLE_INFO;
+}
+
+void CANHandler::requestStoredDTCs() {
+    queuedService = OBDPids::SERVICE_STORED_DTCS;
+}
+
+bool CANHandler::sendDiagnosticRequest(byte service, unsigned long currentTime) {
+    byte request[8] = {0};
+    if (service == OBDPids::SERVICE_VEHICLE_INFO) {
+        request[0] = 0x02;
+        request[1] = OBDPids::SERVICE_VEHICLE_INFO;
+        request[2] = OBDPids::VEHICLE_INFO_VIN;
+    } else {
+        request[0] = 0x01;
+        request[1] = service;
+        dtcCount = 0; // Every ECU appends its own codes
+    }
+    pendingService = service;
+
+    lockBus();
+    bool sent = can.send(obdRequestId, request, 8);
+    unlockBus();
+
+    if (!sent) {
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("Error sending request for ") + describePendingPids());
+        lastResponseTime = currentTime;
+        return false;
+    }
+    LOG_MESSAGE(LogHandler::DebugType::CAN, String("Request sent for ") + describePendingPids());
+    waitingForResponse = true;
+    lastRequestTime = currentTime;
+    return true;
+}
+
+void CANHandler::parseVehicleInfo(const byte* payload, uint16_t length) {
+    // 49 02 [count] + 17 ASCII characters; some ECUs omit the count byte
+    if (payload[1] != OBDPids::VEHICLE_INFO_VIN) return;
+    uint16_t offset = length >= 20 ? 3 : 2;
+    if (length < offset + 17) return;
+
+    memcpy(vin, &payload[offset], 17);
+    vin[17] = '\0';
+    LOG_MESSAGE(LogHandler::DebugType::CAN, String("VIN: ") + vin);
+}
+
+void CANHandler::parseStoredDTCs(const byte* payload, uint16_t length) {
+    // 43 [count] followed by two bytes per code
+    byte count = payload[1];
+    for (byte i = 0; i < count && 2 + i * 2 + 1 < length && dtcCount < MAX_DTCS; i++) {
+        uint16_t code = (payload[2 + i * 2] << 8) | payload[3 + i * 2];
+        if (code == 0) continue;
+        dtcs[dtcCount++] = code;
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("Stored DTC: ") + getDTC(dtcCount - 1));
+    }
+}
+
+String CANHandler::getDTC(byte index) const {
+    if (index >= dtcCount) return "";
+    static const char systems[] = {'P', 'C', 'B', 'U'};
+    uint16_t code = dtcs[index];
+    char text[6];
+    snprintf(text, sizeof(text), "%c%04X", systems[code >> 14], code & 0x3FFF);
+    return String(text);
+}
+
+void CANHandler::applyIsoTpSettings() {
+    byte blockSize = SettingsHandler::getIsoTpBlockSize();
+    byte stMin = SettingsHandler::getIsoTpStMin();
+    if (blockSize == isoTpBlockSize && stMin == isoTpStMin) return;
+
+    isoTpBlockSize = blockSize;
+    isoTpStMin = stMin;
+    for (auto& session : isoTpSessions) {
+        session.configure(blockSize, stMin);
+    }
+}
+
+void CANHandler::startDiscovery() {
+    supported.clear();
+    discoveryPid = 0;
+    // The VIN is only read once per boot, after that the cache is checked directly
+    if (vin[0] == '\0') {
+        discovery = Discovery::VIN;
+    } else {
+        onVINRead();
+    }
+}
+
+bool CANHandler::isDiscoveryPending() const {
+    if (!waitingForResponse) return false;
+    if (discovery == Discovery::VIN) return pendingService == OBDPids::SERVICE_VEHICLE_INFO;
+    if (discovery == Discovery::BITMAPS) return pendingService == OBDPids::SERVICE_CURRENT_DATA;
+    return false;
+}
+
+void CANHandler::sendBitmapRequest(unsigned long currentTime) {
+    pendingPids[0] = discoveryPid;
+    pendingCount = 1;
+    pendingService = OBDPids::SERVICE_CURRENT_DATA;
+
+    byte request[8] = {0x02, OBDPids::SERVICE_CURRENT_DATA, discoveryPid, 0, 0, 0, 0, 0};
+    lockBus();
+    bool sent = can.send(obdRequestId, request, 8);
+    unlockBus();
+
+    if (!sent) {
+        logPendingPids(LogFormat::CAN_REQUEST_FAILED);
+        lastResponseTime = currentTime;
+        return;
+    }
+    logPendingPids(LogFormat::CAN_REQUEST_SENT);
+    waitingForResponse = true;
+    lastRequestTime = currentTime;
+}
+
+void CANHandler::onSupportedBitmap(byte pid, const byte* data) {
+    uint32_t bitmap = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+    byte next;
+    switch (supported.add(pid, bitmap, next)) {
+        case SupportedPIDs::AddResult::MORE: discoveryPid = next; break;
+        case SupportedPIDs::AddResult::COMPLETE: finishDiscovery(false); break;
+        case SupportedPIDs::AddResult::IGNORED: break; // Keep waiting for the expected bitmap
+    }
+}
+
+void CANHandler::onVINRead() {
+    if (vin[0] != '\0' && supportCache) {
+        char name[32];
+        cacheName(name, sizeof(name));
+        SupportedPIDs::Record record;
+        if (supportCache->read(name, 0, &record, sizeof(record)) == sizeof(record) && supported.fromRecord(record)) {
+            finishDiscovery(true);
+            return;
+        }
+    }
+    discovery = Discovery::BITMAPS;
+}
+
+void CANHandler::onDiscoveryUnanswered(unsigned long currentTime) {
+    if (discovery == Discovery::VIN) {
+        // No VIN, no cache key: ask the ECU directly
+        discovery = Discovery::BITMAPS;
+        return;
+    }
+    discovery = Discovery::FAILED;
+    discoveryFailedTime = currentTime;
+    supported.clear();
+    LOG_MESSAGE(LogHandler::DebugType::WARNING, String("Supported PIDs not answered, polling all configured PIDs"));
+    reloadPIDs();
+}
+
+void CANHandler::finishDiscovery(bool fromCache) {
+    discovery = Discovery::DONE;
+    supportFromCache = fromCache;
+    if (!fromCache && supportCache && vin[0] != '\0') {
+        char name[32];
+        cacheName(name, sizeof(name));
+        SupportedPIDs::Record record;
+        supported.toRecord(record);
+        if (!supportCache->write(name, &record, sizeof(record))) {
+            LOG_MESSAGE(LogHandler::DebugType::WARNING, String("Could not cache supported PIDs"));
+        }
+    }
+    LOG_MESSAGE(LogHandler::DebugType::CAN, String("Supported PIDs ") + (fromCache ? "loaded from cache" : "read from ECU") + ", " + String(supported.getBitmapCount()) + " bitmaps");
+    reloadPIDs();
+}
+
+bool CANHandler::isPolled(byte pid) const {
+    return pids->contains(pid) && (discovery != Discovery::DONE || supported.contains(pid));
+}
+
+void CANHandler::publishPIDSupport() {
+    std::lock_guard<std::mutex> lock(supportMutex);
+    PIDSupport& support = supportSnapshot;
+    support.discovered = discovery == Discovery::DONE;
+    support.fromCache = support.discovered && supportFromCache;
+    memcpy(support.vin, vin, sizeof(support.vin));
+    support.bitmapCount = supported.getBitmapCount();
+    for (uint8_t i = 0; i < SupportedPIDs::MAX_BITMAPS; i++) {
+        support.bitmaps[i] = supported.getBitmap(i);
+    }
+    support.unsupportedCount = 0;
+    for (const PIDConfig& config : *pids) {
+        if (support.discovered && !supported.contains(config.pid) && support.unsupportedCount < PIDScheduler::MAX_ENTRIES) {
+            support.unsupported[support.unsupportedCount++] = config.pid;
+        }
+    }
+    supportVersion++;
+}
+
+void CANHandler::getPIDSupport(PIDSupport& support) {
+    std::lock_guard<std::mutex> lock(supportMutex);
+    support = supportSnapshot;
+}
+
+void CANHandler::cacheName(char* name, size_t size) const {
+    // VINs are alphanumeric, anything else is left out of the file name
+    char key[sizeof(vin)];
+    size_t length = 0;
+    for (const char* c = vin; *c; c++) {
+        if (isalnum((unsigned char)*c)) key[length++] = *c;
+    }
+    key[length] = '\0';
+    snprintf(name, size, "%s.pids", key);
+}
+
+bool CANHandler::parseCurrentDataResponse(unsigned long rxId, const byte* data, byte length, std::vector<SampleRecord>& results) {
+    // A (multi-PID) response is a sequence of PID / data byte pairs
+    bool matched = false;
+    unsigned long now = millis();
+    byte i = 0;
+    while (i < length) {
+        byte pid = data[i++];
+        byte dataLength = OBDPids::dataLength(pid);
+        if (dataLength == 0) {
+            // Unknown length, only valid for a PID that was requested alone
+            if (!(pendingCount == 1 && pendingPids[0] == pid)) break;
+            dataLength = length - i;
+        }
+        if (i + dataLength > length) break;
+
+        if (isPending(pid)) {
+            matched = true;
+            metrics.onResponse(pid, now);
+            if (discovery == Discovery::BITMAPS && pid == discoveryPid && dataLength == 4) onSupportedBitmap(pid, &data[i]);
+        }
+        if (pids->contains(pid)) {
+            scheduler.recordSample(pid, now);
+
+            // Raw bytes only; decoding happens on the uplink side
+            SampleRecord sample;
+            sample.timestampMs = now;
+            sample.ecuId = rxId;
+            sample.pid = pid;
+            sample.len = dataLength < SampleRecord::MAX_DATA ? dataLength : SampleRecord::MAX_DATA;
+            memcpy(sample.data, &data[i], sample.len);
+            results.push_back(sample);
+        }
+        i += dataLength;
+    }
+    return matched;
+}
+
+String CANHandler::convertToHumanReadable(byte pid, const byte* data, byte length) {
+    if (!data) return "No Data";
+    const PIDConfig* config = pids->find(pid);
+    if (!config) return "Unknown PID";
+    if (config->formula.isEmpty()) return "No formula";
+
+    double result;
+    if (config->program.evaluate(data, length, result)) {
+        return String(result);
+    } else {
+        return "Eval error: " + config->formula;
+    }
+}
+
+// String CANHandler::convertToHumanReadable(byte pid, byte* rxBuf) {
+//     if (!rxBuf) return "No Data";
+
+//     int value = 0;
+//     if (pidMap.find(pid) == pidMap.end()) return "Unknown PID";
+
+//     String label = pidMap[pid];
+//     if (label == "RPM") {
+//         value = ((rxBuf[3] * 256) + rxBuf[4]) / 4;
+//         return String(value);
+//     } else if (label == "Speed") {
+//         value = rxBuf[3];
+//         return String(value);
+//     } else if (label == "Coolant_Temp") {
+//         value = rxBuf[3] - 40;
+//         return String(value);
+//     } else if (label == "Oil_Temp") {
+//         value = rxBuf[3] - 40;
+//         return String(value);
+//     } else if (label == "MAF") {
+//         float maf = ((rxBuf[3] * 256) + rxBuf[4]) / 100.0;
+//         return String(maf);
+//     }
+//     return "Unknown Data";
+// }
+
+const char* CANHandler::getLabelForPID(byte pid) const {
+    const PIDConfig* config = pids->find(pid);
+    return config ? config->label.c_str() : "Unknown PID";
 }
\ No newline at end of file
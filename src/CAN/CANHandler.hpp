@@ -1,41 +1,216 @@
-#ifndef CAN_HANDLER_HPP
-#define CAN_HANDLER_HPP
-
-#include <SPI.h>
-#include <mcp_can.h>
-#include <map>
-#include <Arduino.h>
-#include <tuple>
-#include <vector>
-#include <queue>
-
-#include "UTILS/CANResponse.hpp"
-#include "UTILS/PIDConfig.hpp"
-
-class CANHandler {
-public:
-    CANHandler(int csPin, std::map<byte, PIDConfig>& pidMapRef);
-    bool begin();
-    void sendRequests();
-    // std::tuple<byte, byte*> handleResponse(); // Returns PID and raw message
-    bool handleResponses(std::vector<CANResponse>& results);
-    String convertToHumanReadable(byte pid, byte* rxBuf); // Converts raw data to human-readable
-    String getLabelForPID(byte pid); // Returns the label for a given PID
-private:
-    MCP_CAN can;
-    const unsigned long obdRequestId = 0x7DF; // Standard OBD-II request ID
-    const unsigned long ecuResponseId = 0x7E8; // Standard response ID from ECU
-
-    std::map<byte, PIDConfig>& pidMap;
-
-    std::queue<byte> pidQueue;
-    byte currentPid = 0;
-    bool waitingForResponse = false;
-    unsigned long lastResponseTime = 0;
-    unsigned long lastRequestTime = 0;
-    unsigned long lastIterationTime = 0;
-
-    bool canInitialized = false; // Flag to check if CAN is initialized
-};
-
+#ifndef CAN_HANDLER_HPP
+#define CAN_HANDLER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <Arduino.h>
+#include <tuple>
+#include <vector>
+
+#include "CANFrame.hpp"
+#include "CANMetrics.hpp"
+#include "../HAL/CANController.hpp"
+#include "../HAL/Storage.hpp"
+#include "../LOG/LogFormat.hpp"
+#include "IsoTpSession.hpp"
+#include "OBDPids.hpp"
+#include "PIDScheduler.hpp"
+#include "SupportedPIDs.hpp"
+#include "UTILS/PIDTable.hpp"
+#include "UTILS/SampleRecord.hpp"
+#include "UTILS/SPSCRing.hpp"
+
+class CANHandler {
+public:
+    // Which response IDs the controller acceptance filters let through
+    enum class FilterMode {
+        ACCEPT_ALL,     // Masks cleared, every frame reaches the RX buffers
+        OBD_RESPONSES,  // 0x7E8 - 0x7EF, replies to functional OBD requests
+        CUSTOM          // IDs passed to setAcceptanceFilter()
+    };
+
+    struct RxStats {
+        unsigned long receivedFrames;  // Frames read from the controller
+        unsigned long droppedFrames;   // Frames lost because the ring was full
+        unsigned long maxLatencyUs;    // Worst reception -> processing delay
+        size_t ringHighWater;          // Highest ring fill level seen
+    };
+
+    // Outcome of the supported-PID discovery against the configured PIDs
+    struct PIDSupport {
+        bool discovered;   // false: not finished or unanswered, every configured PID is polled
+        bool fromCache;    // Bitmaps taken from the per-vehicle cache instead of the ECU
+        char vin[18];      // Empty if the ECU does not report one
+        uint8_t bitmapCount;
+        uint32_t bitmaps[SupportedPIDs::MAX_BITMAPS];
+        uint8_t unsupportedCount;
+        uint8_t unsupported[PIDScheduler::MAX_ENTRIES]; // Configured PIDs left out of the schedule
+    };
+
+    // intPin is the controller's INT line; -1 keeps reception polled from loop()
+    // New tables published to pidTables (from any task) are picked up by the next sendRequests()
+    CANHandler(CANController& controller, SharedPIDTable& pidTables, int intPin = -1);
+    bool begin();
+    void reloadPIDs(); // Syncs the request schedule with the PID table after a config change
+    void sendRequests();
+    // std::tuple<byte, byte*> handleResponse(); // Returns PID and raw message
+    bool handleResponses(std::vector<SampleRecord>& results); // Returns true if new samples were added
+    String convertToHumanReadable(byte pid, const byte* data, byte length); // Converts raw PID data (A = data[0]) to human-readable
+    const char* getLabelForPID(byte pid) const; // Returns the label for a given PID
+    RxStats getRxStats() const; // Safe to call from any task
+
+    // Programs the hardware masks/filters. Up to six IDs are matched exactly,
+    // more are covered by a mask of the bits they have in common.
+    bool setAcceptanceFilter(const unsigned long* ids, byte count);
+    bool setFilterMode(FilterMode mode);
+    FilterMode getFilterMode() const { return filterMode; }
+    unsigned long getSoftwareFilteredFrames() const { return softwareFilteredFrames; } // Frames read over SPI but discarded by ID
+
+    // Diagnostic requests, sent ahead of the next PID request. Results arrive
+    // (possibly segmented over ISO-TP) through handleResponses().
+    void requestVIN();
+    void requestStoredDTCs();
+    const char* getVIN() const { return vin; } // Empty until read
+    byte getDTCCount() const { return dtcCount; }
+    String getDTC(byte index) const; // e.g. "P0301"
+    const IsoTpSession::Stats& getIsoTpStats(byte ecu) const { return isoTpSessions[ecu].getStats(); }
+
+    // Supported-PID discovery starts with begin(): the VIN is read to look
+    // the vehicle up in the cache, otherwise the ECU's bitmaps are queried
+    // (and cached). PID polling waits for it; configured PIDs the ECU does
+    // not support are not requested.
+    void setSupportCache(Storage* storage) { supportCache = storage; }
+    // Queries the ECU again on the next sendRequests(), replacing the cache entry
+    void requestPIDDiscovery() { discoveryRequested = true; }
+    // Refreshed on discovery and config changes; safe to call from any task
+    void getPIDSupport(PIDSupport& support);
+    uint32_t getPIDSupportVersion() const { return supportVersion; } // Changes with every refresh
+    // Per-PID request metrics and bus error counters, refreshed every
+    // HEALTH_INTERVAL_MS by sendRequests(); safe to call from any task
+    void getHealth(CANMetrics::Snapshot& snapshot);
+private:
+    static constexpr unsigned long OBD_RESPONSE_ID_FIRST = 0x7E8;
+    static constexpr unsigned long OBD_RESPONSE_ID_LAST = 0x7EF;
+    static constexpr unsigned long OBD_PHYSICAL_REQUEST_ID_FIRST = 0x7E0; // Flow control goes to the ECU's own request ID
+    static constexpr byte ECU_COUNT = OBD_RESPONSE_ID_LAST - OBD_RESPONSE_ID_FIRST + 1;
+    static constexpr byte MAX_DTCS = 32;
+    static constexpr byte FILTER_COUNT = CANController::FILTER_COUNT;
+
+    bool programFilters(unsigned long mask, const unsigned long* ids, byte count);
+    void lockBus();
+    void unlockBus();
+
+    static constexpr size_t RX_RING_SIZE = 64;
+
+    static void IRAM_ATTR onInterrupt();
+    static void rxTask(void* param);
+    void drainController();
+    bool readFrame(CANFrame& frame);
+
+    CANController& can;
+    int intPin;
+    SemaphoreHandle_t spiMutex = nullptr;   // Serializes SPI access between loop() and the RX task
+    static TaskHandle_t rxTaskHandle;
+    SPSCRing<CANFrame, RX_RING_SIZE> rxRing;
+    // Written by the RX task (frames, drops, high water) and the acquisition
+    // task (latency), read by anyone through getRxStats()
+    struct RxCounters {
+        std::atomic<unsigned long> receivedFrames{0};
+        std::atomic<unsigned long> droppedFrames{0};
+        std::atomic<unsigned long> maxLatencyUs{0};
+        std::atomic<size_t> ringHighWater{0};
+    };
+    RxCounters rxCounters;
+    FilterMode filterMode = FilterMode::ACCEPT_ALL;
+    unsigned long softwareFilteredFrames = 0;
+
+    const unsigned long obdRequestId = 0x7DF; // Standard OBD-II request ID
+    const unsigned long ecuResponseId = 0x7E8; // Standard response ID from ECU
+
+    SharedPIDTable& sharedPids;
+    std::shared_ptr<const PIDTable> pids; // Table in use by this task
+    uint32_t pidsVersion = UINT32_MAX;
+
+    void applyPublishedPIDs();
+
+    static constexpr unsigned long MIN_REQUEST_GAP_MS = 100;
+    static constexpr unsigned long STATS_REPORT_INTERVAL_MS = 60000;
+    static constexpr unsigned long HEALTH_INTERVAL_MS = 1000;
+
+    void packPendingPids(unsigned long now);
+    void logSchedulerStats();
+    void publishHealth(); // Polls the controller error state and refreshes healthSnapshot
+    bool isPending(byte pid) const;
+    // Binary log record with the PIDs of the request in flight (service 01)
+    void logPendingPids(LogFormat format);
+    String describePendingPids();
+    bool parseCurrentDataResponse(unsigned long rxId, const byte* data, byte length, std::vector<SampleRecord>& results);
+    void handleMessage(unsigned long rxId, const byte* payload, uint16_t length, std::vector<SampleRecord>& results);
+    void parseVehicleInfo(const byte* payload, uint16_t length);
+    void parseStoredDTCs(const byte* payload, uint16_t length);
+    void finishRequest();
+    bool sendDiagnosticRequest(byte service, unsigned long currentTime);
+    void applyIsoTpSettings();
+
+    IsoTpSession isoTpSessions[ECU_COUNT]; // One per responding ECU (0x7E8 - 0x7EF)
+    byte isoTpBlockSize = 0;
+    byte isoTpStMin = 0;
+    std::atomic<uint8_t> queuedService{0};  // Diagnostic service waiting to be sent
+    byte pendingService = 0; // Service of the request in flight
+    char vin[18] = {0};
+    uint16_t dtcs[MAX_DTCS];
+    byte dtcCount = 0;
+
+    PIDScheduler scheduler;
+    unsigned long defaultPeriodMs = 0;  // Period for PIDs without their own rate
+    byte pendingPids[OBDPids::MAX_PIDS_PER_REQUEST]; // PIDs of the request in flight
+    byte pendingCount = 0;
+    bool waitingForResponse = false;
+    unsigned long lastResponseTime = 0;
+    unsigned long lastRequestTime = 0;
+    unsigned long lastStatsReportTime = 0;
+
+    CANMetrics metrics;
+    CANMetrics::Snapshot healthSnapshot = {};
+    std::mutex healthMutex;
+    unsigned long lastHealthTime = 0;
+
+    enum class Discovery : uint8_t {
+        IDLE,
+        VIN,      // Reading the VIN for the cache lookup
+        BITMAPS,  // Querying the supported-PID bitmaps
+        DONE,
+        FAILED    // Unanswered, retried after DISCOVERY_RETRY_MS
+    };
+    // Shorter than the response threshold: a compliant ECU answers within
+    // 50 ms and polling waits for discovery
+    static constexpr unsigned long DISCOVERY_TIMEOUT_MS = 1000;
+    static constexpr unsigned long DISCOVERY_RETRY_MS = 60000;
+
+    void startDiscovery();
+    bool isDiscovering() const { return discovery == Discovery::VIN || discovery == Discovery::BITMAPS; }
+    bool isDiscoveryPending() const; // The request in flight is a discovery request
+    void sendBitmapRequest(unsigned long currentTime);
+    void onSupportedBitmap(byte pid, const byte* data);
+    void onVINRead();
+    void onDiscoveryUnanswered(unsigned long currentTime);
+    void finishDiscovery(bool fromCache);
+    bool isPolled(byte pid) const; // Configured and not known to be unsupported
+    void publishPIDSupport();
+    void cacheName(char* name, size_t size) const;
+
+    Discovery discovery = Discovery::IDLE;
+    byte discoveryPid = 0;             // Bitmap PID to query next
+    unsigned long discoveryFailedTime = 0;
+    bool supportFromCache = false;
+    SupportedPIDs supported;
+    Storage* supportCache = nullptr;
+    PIDSupport supportSnapshot = {};
+    std::mutex supportMutex;
+    std::atomic<uint32_t> supportVersion{0};
+    std::atomic<bool> discoveryRequested{false};
+
+    bool canInitialized = false; // Flag to check if CAN is initialized
+};
+
 #endif // CAN_HANDLER_HPP
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "CANMetrics.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// ,"name":value; one field per snprintf so no entry can outgrow the buffer
+void appendCount(String& json, const char* name, unsigned long value) {
+    char field[48];
+    snprintf(field, sizeof(field), ",\"%s\":%lu", name, value);
+    json += field;
+}
+
+} // namespace
+
+CANMetrics::CANMetrics() {
+    clear();
+}
+
+void CANMetrics::clear() {
+    memset(pids, 0, sizeof(pids));
+    memset(slotForPid, NO_SLOT, sizeof(slotForPid));
+    pidCount = 0;
+    bus = {};
+    pendingCount = 0;
+    answered = 0;
+}
+
+CANMetrics::PIDMetrics* CANMetrics::find(uint8_t pid, bool create) {
+    uint8_t slot = slotForPid[pid];
+    if (slot != NO_SLOT) return &pids[slot];
+    if (!create || pidCount == MAX_PIDS) return nullptr;
+
+    slot = pidCount++;
+    slotForPid[pid] = slot;
+    pids[slot].pid = pid;
+    return &pids[slot];
+}
+
+void CANMetrics::beginRequest(const uint8_t* requested, uint8_t count, unsigned long now) {
+    pendingCount = 0;
+    answered = 0;
+    requestTime = now;
+    for (uint8_t i = 0; i < count && i < OBDPids::MAX_PIDS_PER_REQUEST; i++) {
+        PIDMetrics* metrics = find(requested[i], true);
+        if (!metrics) continue;
+        metrics->requests++;
+        pendingSlots[pendingCount++] = metrics - pids;
+    }
+}
+
+void CANMetrics::onResponse(uint8_t pid, unsigned long now) {
+    uint8_t slot = slotForPid[pid];
+    for (uint8_t i = 0; i < pendingCount; i++) {
+        if (pendingSlots[i] != slot || (answered & (1 << i))) continue;
+        answered |= 1 << i;
+
+        PIDMetrics& metrics = pids[slot];
+        uint32_t latency = now - requestTime;
+        uint8_t bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && latency > LATENCY_BOUNDS_MS[bucket]) bucket++;
+        metrics.responses++;
+        metrics.latencyBuckets[bucket]++;
+        metrics.latencyTotalMs += latency;
+        if (latency > metrics.latencyMaxMs) metrics.latencyMaxMs = latency;
+        return;
+    }
+}
+
+void CANMetrics::endRequest(Outcome outcome) {
+    for (uint8_t i = 0; i < pendingCount; i++) {
+        if (answered & (1 << i)) continue;
+        PIDMetrics& metrics = pids[pendingSlots[i]];
+        switch (outcome) {
+            case Outcome::ANSWERED: metrics.unanswered++; break;
+            case Outcome::TIMEOUT: metrics.timeouts++; break;
+            case Outcome::NEGATIVE: metrics.negative++; break;
+            case Outcome::SEND_FAILED: metrics.sendFailures++; break;
+        }
+    }
+    pendingCount = 0;
+    answered = 0;
+}
+
+void CANMetrics::onErrorState(const CANController::ErrorState& state) {
+    bus.polls++;
+    if (state.errorWarning) bus.errorWarning++;
+    if (state.errorPassive) bus.errorPassive++;
+    if (state.busOff) bus.busOff++;
+    if (state.rxOverflow) bus.rxOverflows++;
+    bus.txErrors = state.txErrors;
+    bus.rxErrors = state.rxErrors;
+    if (state.txErrors > bus.maxTxErrors) bus.maxTxErrors = state.txErrors;
+    if (state.rxErrors > bus.maxRxErrors) bus.maxRxErrors = state.rxErrors;
+}
+
+void CANMetrics::copyTo(Snapshot& snapshot) const {
+    snapshot.pidCount = pidCount;
+    memcpy(snapshot.pids, pids, pidCount * sizeof(PIDMetrics));
+    snapshot.bus = bus;
+}
+
+uint32_t CANMetrics::latencyPercentileMs(const PIDMetrics& metrics, uint32_t permille) {
+    uint32_t rank = (uint64_t)metrics.responses * permille / 1000;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        seen += metrics.latencyBuckets[i];
+        if (seen > rank) return LATENCY_BOUNDS_MS[i] < metrics.latencyMaxMs ? LATENCY_BOUNDS_MS[i] : metrics.latencyMaxMs;
+    }
+    return metrics.latencyMaxMs;
+}
+
+void CANMetrics::buildJson(const Snapshot& snapshot, String& json) {
+    char entry[256];
+    const BusMetrics& bus = snapshot.bus;
+    snprintf(entry, sizeof(entry), "{\"bus\":{\"polls\":%lu,\"error_warning\":%lu,\"error_passive\":%lu,\"bus_off\":%lu,\"rx_overflows\":%lu,"
+             "\"tec\":%u,\"rec\":%u,\"tec_max\":%u,\"rec_max\":%u},\"pids\":{",
+             (unsigned long)bus.polls, (unsigned long)bus.errorWarning, (unsigned long)bus.errorPassive, (unsigned long)bus.busOff,
+             (unsigned long)bus.rxOverflows, bus.txErrors, bus.rxErrors, bus.maxTxErrors, bus.maxRxErrors);
+    json = entry;
+
+    for (uint8_t i = 0; i < snapshot.pidCount; i++) {
+        const PIDMetrics& m = snapshot.pids[i];
+        snprintf(entry, sizeof(entry), "%s\"%02X\":{\"requests\":%lu", i ? "," : "", m.pid, (unsigned long)m.requests);
+        json += entry;
+        appendCount(json, "responses", m.responses);
+        appendCount(json, "timeouts", m.timeouts);
+        appendCount(json, "negative", m.negative);
+        appendCount(json, "unanswered", m.unanswered);
+        appendCount(json, "send_failures", m.sendFailures);
+        snprintf(entry, sizeof(entry), ",\"hz\":%.2f", m.achievedHz);
+        json += entry;
+        appendCount(json, "latency_avg_ms", m.responses ? m.latencyTotalMs / m.responses : 0);
+        appendCount(json, "latency_p50_ms", latencyPercentileMs(m, 500));
+        appendCount(json, "latency_p99_ms", latencyPercentileMs(m, 990));
+        appendCount(json, "latency_max_ms", m.latencyMaxMs);
+        json += ",\"latency_buckets\":[";
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            snprintf(entry, sizeof(entry), "%s%lu", b ? "," : "", (unsigned long)m.latencyBuckets[b]);
+            json += entry;
+        }
+        json += "]}";
+    }
+    json += "}}";
+}
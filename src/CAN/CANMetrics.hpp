@@ -0,0 +1,94 @@
+#ifndef CAN_METRICS_HPP
+#define CAN_METRICS_HPP
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "../HAL/CANController.hpp"
+#include "OBDPids.hpp"
+#include "PIDScheduler.hpp"
+
+// Per-PID request outcomes and bus error counters, cumulative since boot, in
+// fixed memory. Updated by CANHandler on the acquisition task; other tasks
+// read the snapshot it publishes.
+class CANMetrics {
+public:
+    static constexpr uint8_t MAX_PIDS = PIDScheduler::MAX_ENTRIES;
+    static constexpr uint8_t LATENCY_BUCKETS = 8;
+    // Upper bounds in ms; the last bucket takes everything slower
+    static constexpr uint16_t LATENCY_BOUNDS_MS[LATENCY_BUCKETS - 1] = {10, 20, 50, 100, 200, 500, 1000};
+
+    enum class Outcome {
+        ANSWERED,  // Primary ECU responded; requested PIDs missing from it count as unanswered
+        TIMEOUT,
+        NEGATIVE,  // Negative response (7F)
+        SEND_FAILED
+    };
+
+    struct PIDMetrics {
+        uint8_t pid;
+        uint32_t requests;
+        uint32_t responses;
+        uint32_t timeouts;
+        uint32_t negative;
+        uint32_t unanswered;  // Left out of a response, usually unsupported by the ECU
+        uint32_t sendFailures;
+        uint32_t latencyBuckets[LATENCY_BUCKETS]; // Request -> response
+        uint32_t latencyTotalMs;
+        uint32_t latencyMaxMs;
+        float achievedHz;     // Filled in by CANHandler from the scheduler
+    };
+
+    struct BusMetrics {
+        uint32_t polls;          // Error state reads
+        uint32_t errorWarning;   // Polls that found the controller in each state
+        uint32_t errorPassive;
+        uint32_t busOff;
+        uint32_t rxOverflows;    // Polls that found frames lost to full receive buffers
+        uint8_t txErrors;        // Last TEC / REC
+        uint8_t rxErrors;
+        uint8_t maxTxErrors;
+        uint8_t maxRxErrors;
+    };
+
+    struct Snapshot {
+        uint8_t pidCount;
+        PIDMetrics pids[MAX_PIDS];
+        BusMetrics bus;
+    };
+
+    CANMetrics();
+
+    // A service 01 request for pids was sent at now
+    void beginRequest(const uint8_t* pids, uint8_t count, unsigned long now);
+    void onResponse(uint8_t pid, unsigned long now);
+    // Closes the request begun last, outcome applies to the PIDs not yet answered
+    void endRequest(Outcome outcome);
+    void onErrorState(const CANController::ErrorState& state);
+    void clear();
+
+    const PIDMetrics* get(uint8_t pid) const { return slotForPid[pid] == NO_SLOT ? nullptr : &pids[slotForPid[pid]]; }
+    void copyTo(Snapshot& snapshot) const;
+    // Latency below which permille of the responses fell, as a bucket bound
+    static uint32_t latencyPercentileMs(const PIDMetrics& metrics, uint32_t permille);
+    // {"bus": {...}, "pids": {"<pid hex>": {...}, ...}}
+    static void buildJson(const Snapshot& snapshot, String& json);
+
+private:
+    static constexpr uint8_t NO_SLOT = 0xFF;
+
+    PIDMetrics* find(uint8_t pid, bool create);
+
+    PIDMetrics pids[MAX_PIDS];
+    uint8_t slotForPid[256];
+    uint8_t pidCount = 0;
+    BusMetrics bus = {};
+
+    // Request in flight
+    uint8_t pendingSlots[OBDPids::MAX_PIDS_PER_REQUEST];
+    uint8_t pendingCount = 0;
+    uint8_t answered = 0; // Bit per pending slot
+    unsigned long requestTime = 0;
+};
+
+#endif // CAN_METRICS_HPP
@@ -0,0 +1,121 @@
+#include "IsoTpSession.hpp"
+
+#include <string.h>
+
+// Protocol control information, upper nibble of the first byte
+static constexpr uint8_t PCI_SINGLE_FRAME = 0x0;
+static constexpr uint8_t PCI_FIRST_FRAME = 0x1;
+static constexpr uint8_t PCI_CONSECUTIVE_FRAME = 0x2;
+
+static constexpr uint8_t FLOW_STATUS_CONTINUE = 0x0;
+static constexpr uint8_t FLOW_STATUS_OVERFLOW = 0x2;
+
+void IsoTpSession::configure(uint8_t blockSize, uint8_t stMin) {
+    this->blockSize = blockSize;
+    this->stMin = stMin;
+}
+
+void IsoTpSession::reset() {
+    receiving = false;
+    length = 0;
+    received = 0;
+}
+
+IsoTpSession::Result IsoTpSession::onFrame(const uint8_t* data, uint8_t len, unsigned long nowMs, uint8_t* flowControl) {
+    if (!data || len < 1) return Result::NONE;
+
+    switch (data[0] >> 4) {
+        case PCI_SINGLE_FRAME: {
+            uint8_t size = data[0] & 0x0F;
+            if (size == 0 || size > 7 || size >= len) return Result::NONE;
+            // A new single frame aborts any reassembly in progress
+            receiving = false;
+            memcpy(buffer, &data[1], size);
+            length = size;
+            received = size;
+            stats.completed++;
+            return Result::COMPLETE;
+        }
+
+        case PCI_FIRST_FRAME: {
+            if (len < 8) return fail();
+            uint16_t size = ((data[0] & 0x0F) << 8) | data[1];
+            if (size <= 7) return fail();
+            if (size > MAX_PAYLOAD) {
+                // Tell the ECU we cannot take it instead of letting it time out
+                buildFlowControl(FLOW_STATUS_OVERFLOW, flowControl);
+                stats.errors++;
+                reset();
+                return Result::FLOW_CONTROL;
+            }
+
+            memcpy(buffer, &data[2], 6);
+            length = size;
+            received = 6;
+            nextSequence = 1;
+            blockCounter = 0;
+            receiving = true;
+            firstFrameTime = nowMs;
+            lastFrameTime = nowMs;
+            buildFlowControl(FLOW_STATUS_CONTINUE, flowControl);
+            return Result::FLOW_CONTROL;
+        }
+
+        case PCI_CONSECUTIVE_FRAME: {
+            if (!receiving) return Result::NONE;
+            if ((data[0] & 0x0F) != nextSequence) return fail();
+
+            uint16_t chunk = length - received;
+            if (chunk > 7) chunk = 7;
+            if (len < chunk + 1) return fail();
+            memcpy(&buffer[received], &data[1], chunk);
+            received += chunk;
+            nextSequence = (nextSequence + 1) & 0x0F;
+            lastFrameTime = nowMs;
+
+            if (received >= length) {
+                receiving = false;
+                stats.completed++;
+                stats.multiFrame++;
+                stats.lastTransferMs = nowMs - firstFrameTime;
+                if (stats.lastTransferMs > stats.maxTransferMs) stats.maxTransferMs = stats.lastTransferMs;
+                return Result::COMPLETE;
+            }
+
+            // The ECU waits for another Flow Control after every block
+            if (blockSize > 0 && ++blockCounter >= blockSize) {
+                blockCounter = 0;
+                buildFlowControl(FLOW_STATUS_CONTINUE, flowControl);
+                return Result::FLOW_CONTROL;
+            }
+            return Result::NONE;
+        }
+
+        default:
+            // Flow Control frames are only relevant when transmitting
+            return Result::NONE;
+    }
+}
+
+bool IsoTpSession::checkTimeout(unsigned long nowMs) {
+    if (receiving && nowMs - lastFrameTime >= CONSECUTIVE_FRAME_TIMEOUT_MS) {
+        stats.errors++;
+        reset();
+        return true;
+    }
+    return false;
+}
+
+void IsoTpSession::buildFlowControl(uint8_t status, uint8_t* flowControl) const {
+    if (!flowControl) return;
+    memset(flowControl, 0, 8);
+    flowControl[0] = 0x30 | status;
+    flowControl[1] = blockSize;
+    flowControl[2] = stMin;
+}
+
+IsoTpSession::Result IsoTpSession::fail() {
+    stats.errors++;
+    reset();
+    return Result::ERROR;
+}
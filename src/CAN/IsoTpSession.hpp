@@ -0,0 +1,65 @@
+#ifndef ISOTP_SESSION_HPP
+#define ISOTP_SESSION_HPP
+
+#include <stdint.h>
+
+// Receive side of an ISO 15765-2 (ISO-TP) connection with one ECU.
+//
+// Single frames complete immediately. A First Frame starts reassembly into a
+// preallocated buffer and asks the caller to send a Flow Control frame with
+// the configured block size and STmin; Consecutive Frames are appended until
+// the announced length is reached.
+class IsoTpSession {
+public:
+    static constexpr uint16_t MAX_PAYLOAD = 512;
+    static constexpr unsigned long CONSECUTIVE_FRAME_TIMEOUT_MS = 1000; // N_Cr
+
+    enum class Result {
+        NONE,           // Frame ignored or reassembly still in progress
+        FLOW_CONTROL,   // flowControl was filled in and must be sent to the ECU
+        COMPLETE,       // payload() holds a complete message
+        ERROR           // Sequence, length or overflow error, session reset
+    };
+
+    struct Stats {
+        unsigned long completed;        // Messages received (single + multi frame)
+        unsigned long multiFrame;       // Of which were segmented
+        unsigned long errors;
+        unsigned long lastTransferMs;   // First Frame -> last Consecutive Frame
+        unsigned long maxTransferMs;
+    };
+
+    // blockSize 0 = send all frames without waiting, stMin in ISO-TP encoding
+    // (0x00-0x7F ms, 0xF1-0xF9 = 100-900 us)
+    void configure(uint8_t blockSize, uint8_t stMin);
+    void reset();
+
+    Result onFrame(const uint8_t* data, uint8_t len, unsigned long nowMs, uint8_t* flowControl);
+    // Drops a reassembly that stalled. Returns true if one was dropped.
+    bool checkTimeout(unsigned long nowMs);
+
+    bool isReceiving() const { return receiving; }
+    const uint8_t* payload() const { return buffer; }
+    uint16_t payloadLength() const { return length; }
+    const Stats& getStats() const { return stats; }
+
+private:
+    void buildFlowControl(uint8_t status, uint8_t* flowControl) const;
+    Result fail();
+
+    uint8_t buffer[MAX_PAYLOAD];
+    uint16_t length = 0;        // Announced (or single frame) payload length
+    uint16_t received = 0;
+    uint8_t nextSequence = 0;
+    uint8_t blockCounter = 0;
+    bool receiving = false;
+    unsigned long firstFrameTime = 0;
+    unsigned long lastFrameTime = 0;
+
+    uint8_t blockSize = 0;
+    uint8_t stMin = 0;
+
+    Stats stats = {};
+};
+
+#endif // ISOTP_SESSION_HPP
@@ -0,0 +1,46 @@
+#ifndef OBD_PIDS_HPP
+#define OBD_PIDS_HPP
+
+#include <stdint.h>
+
+// SAE J1979 service IDs and service 01 PID data lengths.
+namespace OBDPids {
+
+constexpr uint8_t SERVICE_CURRENT_DATA = 0x01;
+constexpr uint8_t SERVICE_STORED_DTCS = 0x03;
+constexpr uint8_t SERVICE_VEHICLE_INFO = 0x09;
+constexpr uint8_t VEHICLE_INFO_VIN = 0x02;
+constexpr uint8_t POSITIVE_RESPONSE_OFFSET = 0x40;
+constexpr uint8_t NEGATIVE_RESPONSE = 0x7F;
+
+// A single service 01 request carries at most six PIDs
+constexpr uint8_t MAX_PIDS_PER_REQUEST = 6;
+
+// Number of data bytes the ECU returns for a service 01 PID, or 0 when the
+// length is not known (manufacturer specific or newer than this table).
+inline uint8_t dataLength(uint8_t pid) {
+    static const uint8_t lengths[0x68] = {
+        // 0x00 - 0x0F
+        4, 4, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1,
+        // 0x10 - 0x1F
+        2, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2,
+        // 0x20 - 0x2F
+        4, 2, 2, 2, 4, 4, 4, 4, 4, 4, 4, 4, 1, 1, 1, 1,
+        // 0x30 - 0x3F
+        1, 2, 2, 1, 4, 4, 4, 4, 4, 4, 4, 4, 2, 2, 2, 2,
+        // 0x40 - 0x4F
+        4, 4, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 4,
+        // 0x50 - 0x5F
+        4, 1, 1, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2, 1,
+        // 0x60 - 0x67
+        4, 1, 1, 2, 5, 2, 5, 3
+    };
+    if (pid < sizeof(lengths)) return lengths[pid];
+    // Supported PID bitmaps
+    if (pid == 0x80 || pid == 0xA0 || pid == 0xC0) return 4;
+    return 0;
+}
+
+} // namespace OBDPids
+
+#endif // OBD_PIDS_HPP
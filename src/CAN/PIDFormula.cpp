@@ -0,0 +1,298 @@
+#include "PIDFormula.hpp"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool PIDFormula::compile(const char* source) {
+    instructionCount = 0;
+    constantCount = 0;
+    byteCount = 0;
+    valid = false;
+    error = nullptr;
+    errorPos = 0;
+
+    if (!source) source = "";
+    Parser p{source, source, 0};
+
+    skipSpaces(p);
+    if (*p.pos == '\0') return fail(p, "Empty formula");
+    if (!parseOr(p)) return false;
+
+    skipSpaces(p);
+    if (*p.pos != '\0') return fail(p, "Unexpected character");
+
+    valid = true;
+    return true;
+}
+
+bool PIDFormula::evaluate(const uint8_t* data, uint8_t len, double& result) const {
+    if (!valid || !data || byteCount > len) return false;
+
+    double stack[MAX_STACK];
+    uint8_t sp = 0;
+
+    for (uint8_t i = 0; i < instructionCount; ++i) {
+        const Instruction& ins = program[i];
+        switch (ins.op) {
+            case Op::PUSH_CONST: stack[sp++] = constants[ins.arg]; break;
+            case Op::PUSH_BYTE: stack[sp++] = data[ins.arg]; break;
+            case Op::NEG: stack[sp - 1] = -stack[sp - 1]; break;
+            case Op::S8: stack[sp - 1] = (int8_t)(uint8_t)(int64_t)stack[sp - 1]; break;
+            default: {
+                // Binary operators
+                double rhs = stack[--sp];
+                double& lhs = stack[sp - 1];
+                int64_t l = (int64_t)lhs;
+                int64_t r = (int64_t)rhs;
+                switch (ins.op) {
+                    case Op::ADD: lhs += rhs; break;
+                    case Op::SUB: lhs -= rhs; break;
+                    case Op::MUL: lhs *= rhs; break;
+                    case Op::DIV:
+                        if (rhs == 0.0) return false;
+                        lhs /= rhs;
+                        break;
+                    case Op::MOD:
+                        if (rhs == 0.0) return false;
+                        lhs = fmod(lhs, rhs);
+                        break;
+                    case Op::AND: lhs = (double)(l & r); break;
+                    case Op::OR: lhs = (double)(l | r); break;
+                    case Op::XOR: lhs = (double)(l ^ r); break;
+                    // Shifts work on the 32 bit pattern, defined for negative values too
+                    case Op::SHL: lhs = (double)((uint32_t)l << (r & 31)); break;
+                    case Op::SHR: lhs = (double)((uint32_t)l >> (r & 31)); break;
+                    case Op::BIT: lhs = (double)(((uint32_t)l >> (r & 31)) & 1); break;
+                    case Op::S16: lhs = (double)(int16_t)(((l & 0xFF) << 8) | (r & 0xFF)); break;
+                    default: return false;
+                }
+                break;
+            }
+        }
+    }
+
+    result = stack[0];
+    return true;
+}
+
+// Precedence levels, lowest first: | ^ & << >> + - * / % unary
+
+bool PIDFormula::parseOr(Parser& p) {
+    if (!parseXor(p)) return false;
+    while (true) {
+        skipSpaces(p);
+        if (*p.pos == '|') {
+            ++p.pos;
+            if (!parseXor(p) || !emit(p, Op::OR)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool PIDFormula::parseXor(Parser& p) {
+    if (!parseAnd(p)) return false;
+    while (true) {
+        skipSpaces(p);
+        if (*p.pos == '^') {
+            ++p.pos;
+            if (!parseAnd(p) || !emit(p, Op::XOR)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool PIDFormula::parseAnd(Parser& p) {
+    if (!parseShift(p)) return false;
+    while (true) {
+        skipSpaces(p);
+        if (*p.pos == '&') {
+            ++p.pos;
+            if (!parseShift(p) || !emit(p, Op::AND)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool PIDFormula::parseShift(Parser& p) {
+    if (!parseAdditive(p)) return false;
+    while (true) {
+        if (accept(p, "<<")) {
+            if (!parseAdditive(p) || !emit(p, Op::SHL)) return false;
+        } else if (accept(p, ">>")) {
+            if (!parseAdditive(p) || !emit(p, Op::SHR)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool PIDFormula::parseAdditive(Parser& p) {
+    if (!parseMultiplicative(p)) return false;
+    while (true) {
+        skipSpaces(p);
+        if (*p.pos == '+') {
+            ++p.pos;
+            if (!parseMultiplicative(p) || !emit(p, Op::ADD)) return false;
+        } else if (*p.pos == '-') {
+            ++p.pos;
+            if (!parseMultiplicative(p) || !emit(p, Op::SUB)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool PIDFormula::parseMultiplicative(Parser& p) {
+    if (!parseUnary(p)) return false;
+    while (true) {
+        skipSpaces(p);
+        if (*p.pos == '*') {
+            ++p.pos;
+            if (!parseUnary(p) || !emit(p, Op::MUL)) return false;
+        } else if (*p.pos == '/') {
+            ++p.pos;
+            if (!parseUnary(p) || !emit(p, Op::DIV)) return false;
+        } else if (*p.pos == '%') {
+            ++p.pos;
+            if (!parseUnary(p) || !emit(p, Op::MOD)) return false;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool PIDFormula::parseUnary(Parser& p) {
+    skipSpaces(p);
+    if (*p.pos == '-') {
+        ++p.pos;
+        return parseUnary(p) && emit(p, Op::NEG);
+    }
+    if (*p.pos == '+') {
+        ++p.pos;
+        return parseUnary(p);
+    }
+    return parsePrimary(p);
+}
+
+bool PIDFormula::parsePrimary(Parser& p) {
+    skipSpaces(p);
+    const char c = *p.pos;
+
+    if (c == '(') {
+        ++p.pos;
+        if (!parseOr(p)) return false;
+        skipSpaces(p);
+        if (*p.pos != ')') return fail(p, "Expected ')'");
+        ++p.pos;
+        return true;
+    }
+
+    if (isdigit((unsigned char)c) || c == '.') {
+        char* end = nullptr;
+        double value;
+        if (c == '0' && (p.pos[1] == 'x' || p.pos[1] == 'X')) {
+            value = (double)strtoul(p.pos, &end, 16);
+        } else {
+            value = strtod(p.pos, &end);
+        }
+        if (end == p.pos) return fail(p, "Invalid number");
+        if (constantCount >= MAX_CONSTANTS) return fail(p, "Too many constants");
+        constants[constantCount] = value;
+        if (!emit(p, Op::PUSH_CONST, constantCount)) return false;
+        ++constantCount;
+        p.pos = end;
+        return true;
+    }
+
+    if (isalpha((unsigned char)c)) {
+        const char* start = p.pos;
+        while (isalnum((unsigned char)*p.pos)) ++p.pos;
+        size_t len = p.pos - start;
+
+        int byteIndex = -1;
+        if (len == 1 && c >= 'A' && c <= 'D') {
+            byteIndex = c - 'A';
+        } else if (len == 2 && c == 'B' && start[1] >= '3' && start[1] <= '7') {
+            byteIndex = start[1] - '3';
+        }
+        if (byteIndex >= 0) {
+            if (byteIndex + 1 > byteCount) byteCount = byteIndex + 1;
+            return emit(p, Op::PUSH_BYTE, (uint8_t)byteIndex);
+        }
+
+        if (len == 3 && strncasecmp(start, "bit", 3) == 0) return parseCall(p, Op::BIT, 2);
+        if (len == 2 && strncasecmp(start, "s8", 2) == 0) return parseCall(p, Op::S8, 1);
+        if (len == 3 && strncasecmp(start, "s16", 3) == 0) return parseCall(p, Op::S16, 2);
+
+        p.pos = start;
+        return fail(p, "Unknown identifier");
+    }
+
+    if (c == '\0') return fail(p, "Unexpected end of formula");
+    return fail(p, "Unexpected character");
+}
+
+bool PIDFormula::parseCall(Parser& p, Op op, uint8_t argCount) {
+    skipSpaces(p);
+    if (*p.pos != '(') return fail(p, "Expected '('");
+    ++p.pos;
+    for (uint8_t i = 0; i < argCount; ++i) {
+        if (i > 0) {
+            skipSpaces(p);
+            if (*p.pos != ',') return fail(p, "Expected ','");
+            ++p.pos;
+        }
+        if (!parseOr(p)) return false;
+    }
+    skipSpaces(p);
+    if (*p.pos != ')') return fail(p, "Expected ')'");
+    ++p.pos;
+    return emit(p, op);
+}
+
+bool PIDFormula::emit(Parser& p, Op op, uint8_t arg) {
+    if (instructionCount >= MAX_INSTRUCTIONS) return fail(p, "Formula too long");
+
+    // Track the evaluation stack depth so evaluate() never needs to check it
+    switch (op) {
+        case Op::PUSH_CONST:
+        case Op::PUSH_BYTE:
+            if (++p.depth > MAX_STACK) return fail(p, "Formula nested too deeply");
+            break;
+        case Op::NEG:
+        case Op::S8:
+            break;
+        default:
+            --p.depth;
+            break;
+    }
+
+    program[instructionCount++] = {op, arg};
+    return true;
+}
+
+bool PIDFormula::fail(Parser& p, const char* message) {
+    valid = false;
+    if (!error) {
+        error = message;
+        errorPos = (uint8_t)(p.pos - p.src);
+    }
+    return false;
+}
+
+void PIDFormula::skipSpaces(Parser& p) {
+    while (*p.pos == ' ' || *p.pos == '\t') ++p.pos;
+}
+
+bool PIDFormula::accept(Parser& p, const char* token) {
+    skipSpaces(p);
+    size_t len = strlen(token);
+    if (strncmp(p.pos, token, len) != 0) return false;
+    p.pos += len;
+    return true;
+}
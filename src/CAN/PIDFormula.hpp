@@ -0,0 +1,99 @@
+#ifndef PID_FORMULA_HPP
+#define PID_FORMULA_HPP
+
+#include <stdint.h>
+
+// Compiled form of a PID formula string (e.g. "((A * 256) + B) / 4").
+//
+// The formula is parsed once when the PID configuration is loaded and turned
+// into a small stack program. Evaluating it on a response frame only walks
+// that program; nothing is allocated on the heap.
+//
+// Supported syntax:
+//   operands   A, B, C, D       -> data bytes 0..3
+//              B3, B4 ... B7    -> data bytes 0..4 (frame bytes 3..7)
+//   numbers    decimal, fractional (0.5) or hex (0x1F)
+//   operators  + - * / %  & | ^ << >>  unary -, with C precedence
+//   functions  bit(x, n)  -> bit n of x (0 or 1)
+//              s8(x)      -> x as a signed byte
+//              s16(h, l)  -> (h << 8 | l) as a signed word
+class PIDFormula {
+public:
+    static constexpr uint8_t MAX_INSTRUCTIONS = 32;
+    static constexpr uint8_t MAX_CONSTANTS = 8;
+    static constexpr uint8_t MAX_STACK = 8;
+
+    // Compiles the formula. Returns false on a syntax error; getError() and
+    // getErrorPosition() then describe what went wrong (getError() is nullptr
+    // after a successful compile).
+    bool compile(const char* source);
+
+    // Evaluates the program on the data bytes of a response (data[0] is A).
+    // Returns false if the program is invalid, references a byte beyond len
+    // or divides by zero. Evaluated in double, so 32 bit values stay exact.
+    bool evaluate(const uint8_t* data, uint8_t len, double& result) const;
+
+    bool isValid() const { return valid; }
+    uint8_t bytesUsed() const { return byteCount; }  // Highest data byte referenced + 1
+    const char* getError() const { return error; }
+    uint8_t getErrorPosition() const { return errorPos; }
+
+private:
+    enum class Op : uint8_t {
+        PUSH_CONST,
+        PUSH_BYTE,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        NEG,
+        AND,
+        OR,
+        XOR,
+        SHL,
+        SHR,
+        BIT,
+        S8,
+        S16
+    };
+
+    struct Instruction {
+        Op op;
+        uint8_t arg; // Constant index for PUSH_CONST, byte index for PUSH_BYTE
+    };
+
+    // Parser state, only used while compiling
+    struct Parser {
+        const char* src;
+        const char* pos;
+        uint8_t depth;
+    };
+
+    bool parseOr(Parser& p);
+    bool parseXor(Parser& p);
+    bool parseAnd(Parser& p);
+    bool parseShift(Parser& p);
+    bool parseAdditive(Parser& p);
+    bool parseMultiplicative(Parser& p);
+    bool parseUnary(Parser& p);
+    bool parsePrimary(Parser& p);
+    bool parseCall(Parser& p, Op op, uint8_t argCount);
+
+    bool emit(Parser& p, Op op, uint8_t arg = 0);
+    bool fail(Parser& p, const char* message);
+    static void skipSpaces(Parser& p);
+    static bool accept(Parser& p, const char* token);
+
+    Instruction program[MAX_INSTRUCTIONS];
+    double constants[MAX_CONSTANTS];
+    uint8_t instructionCount = 0;
+    uint8_t constantCount = 0;
+    uint8_t byteCount = 0;
+    bool valid = false;
+
+    const char* error = "Not compiled";
+    uint8_t errorPos = 0;
+};
+
+#endif // PID_FORMULA_HPP
@@ -0,0 +1,198 @@
+#include "PIDScheduler.hpp"
+
+#include <string.h>
+
+// Wrap-safe "a is earlier than b" for millis() timestamps
+static inline bool timeBefore(unsigned long a, unsigned long b) {
+    return (long)(a - b) < 0;
+}
+
+static void updateRate(unsigned long& windowStart, unsigned long& windowSamples, float& achievedHz, unsigned long now, unsigned long windowMs) {
+    unsigned long elapsed = now - windowStart;
+    if (elapsed >= windowMs) {
+        achievedHz = windowSamples * 1000.0f / elapsed;
+        windowStart = now;
+        windowSamples = 0;
+    }
+}
+
+PIDScheduler::PIDScheduler() {
+    clear();
+}
+
+void PIDScheduler::clear() {
+    memset(slotForPid, NO_SLOT, sizeof(slotForPid));
+    count = 0;
+    heapSize = 0;
+}
+
+bool PIDScheduler::set(uint8_t pid, unsigned long periodMs, uint8_t priority, unsigned long now) {
+    if (periodMs == 0) periodMs = 1;
+
+    uint8_t slot = slotForPid[pid];
+    if (slot != NO_SLOT) {
+        Entry& e = entries[slot];
+        e.periodMs = periodMs;
+        e.priority = priority;
+        // A shorter period should take effect without waiting out the old one
+        if (timeBefore(now + periodMs, e.deadline)) e.deadline = now + periodMs;
+        if (e.heapPos != NO_SLOT) {
+            siftUp(e.heapPos);
+            siftDown(e.heapPos);
+        }
+        return true;
+    }
+
+    if (count >= MAX_ENTRIES) return false;
+
+    slot = count++;
+    Entry& e = entries[slot];
+    e.pid = pid;
+    e.priority = priority;
+    e.heapPos = NO_SLOT;
+    e.periodMs = periodMs;
+    e.deadline = now; // Due immediately
+    e.requests = 0;
+    e.samples = 0;
+    e.windowStart = now;
+    e.windowSamples = 0;
+    e.achievedHz = 0.0f;
+    slotForPid[pid] = slot;
+    push(slot);
+    return true;
+}
+
+bool PIDScheduler::remove(uint8_t pid) {
+    uint8_t slot = slotForPid[pid];
+    if (slot == NO_SLOT) return false;
+
+    if (entries[slot].heapPos != NO_SLOT) removeFromHeap(slot);
+    slotForPid[pid] = NO_SLOT;
+
+    // Move the last entry into the freed slot
+    uint8_t last = --count;
+    if (slot != last) {
+        entries[slot] = entries[last];
+        slotForPid[entries[slot].pid] = slot;
+        if (entries[slot].heapPos != NO_SLOT) heap[entries[slot].heapPos] = slot;
+    }
+    return true;
+}
+
+bool PIDScheduler::popDue(unsigned long now, uint8_t& pid) {
+    if (heapSize == 0) return false;
+    uint8_t slot = heap[0];
+    if (timeBefore(now, entries[slot].deadline)) return false;
+
+    removeFromHeap(slot);
+    pid = entries[slot].pid;
+    return true;
+}
+
+void PIDScheduler::restore(uint8_t pid) {
+    uint8_t slot = slotForPid[pid];
+    if (slot != NO_SLOT && entries[slot].heapPos == NO_SLOT) push(slot);
+}
+
+void PIDScheduler::reschedule(uint8_t pid, unsigned long now) {
+    uint8_t slot = slotForPid[pid];
+    if (slot == NO_SLOT || entries[slot].heapPos != NO_SLOT) return;
+
+    Entry& e = entries[slot];
+    e.requests++;
+    e.deadline += e.periodMs;
+    // When running behind, do not try to catch up on missed slots
+    if (timeBefore(e.deadline, now)) e.deadline = now;
+    updateRate(e.windowStart, e.windowSamples, e.achievedHz, now, RATE_WINDOW_MS);
+    push(slot);
+}
+
+unsigned long PIDScheduler::timeUntilNext(unsigned long now) const {
+    if (heapSize == 0) return 0;
+    unsigned long deadline = entries[heap[0]].deadline;
+    return timeBefore(now, deadline) ? deadline - now : 0;
+}
+
+void PIDScheduler::recordSample(uint8_t pid, unsigned long now) {
+    uint8_t slot = slotForPid[pid];
+    if (slot == NO_SLOT) return;
+
+    Entry& e = entries[slot];
+    e.samples++;
+    e.windowSamples++;
+    updateRate(e.windowStart, e.windowSamples, e.achievedHz, now, RATE_WINDOW_MS);
+}
+
+bool PIDScheduler::getStats(size_t index, Stats& stats) const {
+    if (index >= count) return false;
+
+    const Entry& e = entries[index];
+    stats.pid = e.pid;
+    stats.priority = e.priority;
+    stats.periodMs = e.periodMs;
+    stats.requests = e.requests;
+    stats.samples = e.samples;
+    stats.targetHz = 1000.0f / e.periodMs;
+    stats.achievedHz = e.achievedHz;
+    return true;
+}
+
+float PIDScheduler::getAchievedHz(uint8_t pid) const {
+    uint8_t slot = slotForPid[pid];
+    return slot == NO_SLOT ? 0.0f : entries[slot].achievedHz;
+}
+
+bool PIDScheduler::before(uint8_t a, uint8_t b) const {
+    const Entry& ea = entries[a];
+    const Entry& eb = entries[b];
+    if (ea.deadline != eb.deadline) return timeBefore(ea.deadline, eb.deadline);
+    return ea.priority > eb.priority;
+}
+
+void PIDScheduler::push(uint8_t slot) {
+    uint8_t pos = heapSize++;
+    heap[pos] = slot;
+    entries[slot].heapPos = pos;
+    siftUp(pos);
+}
+
+void PIDScheduler::removeFromHeap(uint8_t slot) {
+    uint8_t pos = entries[slot].heapPos;
+    uint8_t last = --heapSize;
+    if (pos != last) {
+        swapHeap(pos, last);
+        siftUp(pos);
+        siftDown(pos);
+    }
+    entries[slot].heapPos = NO_SLOT;
+}
+
+void PIDScheduler::siftUp(uint8_t pos) {
+    while (pos > 0) {
+        uint8_t parent = (pos - 1) / 2;
+        if (!before(heap[pos], heap[parent])) break;
+        swapHeap(pos, parent);
+        pos = parent;
+    }
+}
+
+void PIDScheduler::siftDown(uint8_t pos) {
+    while (true) {
+        uint8_t smallest = pos;
+        uint8_t left = 2 * pos + 1;
+        uint8_t right = left + 1;
+        if (left < heapSize && before(heap[left], heap[smallest])) smallest = left;
+        if (right < heapSize && before(heap[right], heap[smallest])) smallest = right;
+        if (smallest == pos) break;
+        swapHeap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void PIDScheduler::swapHeap(uint8_t a, uint8_t b) {
+    uint8_t tmp = heap[a];
+    heap[a] = heap[b];
+    heap[b] = tmp;
+    entries[heap[a]].heapPos = a;
+    entries[heap[b]].heapPos = b;
+}
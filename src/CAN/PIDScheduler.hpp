@@ -0,0 +1,80 @@
+#ifndef PID_SCHEDULER_HPP
+#define PID_SCHEDULER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Earliest-deadline-first scheduler for PID requests.
+//
+// Every PID has a target period and a priority. Deadlines live in a fixed
+// binary min-heap (earliest deadline on top, higher priority first on ties),
+// so choosing the next PID to request is O(log n) and never allocates.
+class PIDScheduler {
+public:
+    static constexpr uint8_t MAX_ENTRIES = 32;
+
+    struct Stats {
+        uint8_t pid;
+        uint8_t priority;
+        unsigned long periodMs;      // Target period
+        unsigned long requests;      // Total requests sent
+        unsigned long samples;       // Total responses received
+        float targetHz;
+        float achievedHz;            // Responses per second over the last window
+    };
+
+    PIDScheduler();
+
+    // Adds the PID or updates its period/priority, keeping its current deadline
+    bool set(uint8_t pid, unsigned long periodMs, uint8_t priority, unsigned long now);
+    bool remove(uint8_t pid);
+    void clear();
+    bool contains(uint8_t pid) const { return slotForPid[pid] != NO_SLOT; }
+    size_t size() const { return count; }
+
+    // Removes and returns the PID with the earliest deadline if it is due.
+    bool popDue(unsigned long now, uint8_t& pid);
+    // Puts a popped PID back with its deadline unchanged (it was not sent).
+    void restore(uint8_t pid);
+    // Puts a popped PID back after it was requested, with its next deadline.
+    void reschedule(uint8_t pid, unsigned long now);
+    // Milliseconds until the next deadline, 0 if something is already due.
+    unsigned long timeUntilNext(unsigned long now) const;
+
+    void recordSample(uint8_t pid, unsigned long now);
+    // Fills stats for the entry at index (0 .. size()-1)
+    bool getStats(size_t index, Stats& stats) const;
+    float getAchievedHz(uint8_t pid) const;
+
+private:
+    static constexpr uint8_t NO_SLOT = 0xFF;
+    static constexpr unsigned long RATE_WINDOW_MS = 10000;
+
+    struct Entry {
+        uint8_t pid;
+        uint8_t priority;
+        uint8_t heapPos;        // Position in heap, NO_SLOT while popped
+        unsigned long periodMs;
+        unsigned long deadline;
+        unsigned long requests;
+        unsigned long samples;
+        unsigned long windowStart;
+        unsigned long windowSamples;
+        float achievedHz;
+    };
+
+    bool before(uint8_t a, uint8_t b) const;
+    void push(uint8_t slot);
+    void removeFromHeap(uint8_t slot);
+    void siftUp(uint8_t pos);
+    void siftDown(uint8_t pos);
+    void swapHeap(uint8_t a, uint8_t b);
+
+    Entry entries[MAX_ENTRIES];
+    uint8_t heap[MAX_ENTRIES];     // Entry slots ordered as a min-heap on deadline
+    uint8_t slotForPid[256];
+    uint8_t count = 0;
+    uint8_t heapSize = 0;
+};
+
+#endif // PID_SCHEDULER_HPP
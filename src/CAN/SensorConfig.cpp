@@ -0,0 +1,55 @@
+#include "SensorConfig.hpp"
+
+#include "../LOG/LogHandler.hpp"
+
+bool SensorConfig::set(uint16_t index, const Entry& entry) {
+    if (index >= MAX_SENSORS) return false;
+    entries[index] = entry;
+    return true;
+}
+
+SensorConfig::Entry* SensorConfig::find(uint16_t index) {
+    auto it = entries.find(index);
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+std::shared_ptr<const PIDTable> SensorConfig::buildTable(const PIDTable& active) {
+    // Always a new table: readers may still iterate the ones published before
+    std::shared_ptr<PIDTable> next = std::make_shared<PIDTable>();
+
+    for (const auto& item : entries) {
+        const Entry& entry = item.second;
+        if (!entry.enabled || entry.pid < 0 || entry.pid > 0xFF) continue;
+
+        PIDConfig& config = next->add((uint8_t)entry.pid);
+        config.label = entry.label;
+        config.formula = entry.formula;
+        config.unit = entry.unit;
+        config.periodMs = entry.rate > 0 ? (unsigned long)(1000.0f / entry.rate) : 0;
+        config.priority = (byte)constrain(entry.priority, 0, 255);
+
+        // Only formulas that changed are compiled again
+        const PIDConfig* current = active.find(config.pid);
+        if (current && current->formula == config.formula) {
+            config.program = current->program;
+        } else if (!config.formula.isEmpty() && !config.program.compile(config.formula.c_str())) {
+            LOG_MESSAGE(LogHandler::DebugType::ERROR, "Invalid formula for PID " + String(config.pid, HEX) + " (" + config.label + "): " + config.program.getError() + " at position " + String(config.program.getErrorPosition()));
+        }
+    }
+
+    if (sameTable(*next, active)) return nullptr;
+    return next;
+}
+
+bool SensorConfig::sameTable(const PIDTable& a, const PIDTable& b) {
+    if (a.size() != b.size()) return false;
+    auto other = b.begin();
+    for (const PIDConfig& config : a) {
+        if (config.pid != other->pid || config.periodMs != other->periodMs || config.priority != other->priority ||
+            config.label != other->label || config.formula != other->formula || config.unit != other->unit) {
+            return false;
+        }
+        ++other;
+    }
+    return true;
+}
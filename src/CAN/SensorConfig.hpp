@@ -0,0 +1,47 @@
+#ifndef SENSOR_CONFIG_HPP
+#define SENSOR_CONFIG_HPP
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+#include "../UTILS/PIDTable.hpp"
+
+// The config/sensors list as edited in the dashboard, kept entry by entry so
+// stream events only touch the entries they name. PID tables are built from
+// the enabled entries; descriptors whose formula did not change take the
+// compiled program from the active table, so a delta only compiles what it
+// touched. Each change is a new table, so readers of the old one are
+// never disturbed.
+class SensorConfig {
+public:
+    static constexpr uint16_t MAX_SENSORS = 20;
+
+    struct Entry {
+        bool enabled = false;
+        int pid = -1;      // -1 until set
+        String label;      // "id" in the dashboard
+        String formula;
+        String unit;
+        float rate = 0;    // Hz, 0 = CAN_REQUEST_INTERVAL
+        int priority = 0;
+    };
+
+    void clear() { entries.clear(); }
+    // False for indexes beyond MAX_SENSORS
+    bool set(uint16_t index, const Entry& entry);
+    void remove(uint16_t index) { entries.erase(index); }
+    Entry* find(uint16_t index);
+    size_t size() const { return entries.size(); }
+
+    // Table for the current entries, or nullptr if it equals active
+    std::shared_ptr<const PIDTable> buildTable(const PIDTable& active);
+
+private:
+    static bool sameTable(const PIDTable& a, const PIDTable& b);
+
+    std::map<uint16_t, Entry> entries; // By list index, in list order
+};
+
+#endif // SENSOR_CONFIG_HPP
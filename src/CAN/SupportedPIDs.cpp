@@ -0,0 +1,38 @@
+#include "SupportedPIDs.hpp"
+
+#include <string.h>
+
+void SupportedPIDs::clear() {
+    memset(bitmaps, 0, sizeof(bitmaps));
+    bitmapCount = 0;
+}
+
+SupportedPIDs::AddResult SupportedPIDs::add(uint8_t bitmapPid, uint32_t bitmap, uint8_t& nextPid) {
+    if (bitmapPid != bitmapCount * 0x20 || bitmapCount == MAX_BITMAPS) return AddResult::IGNORED;
+    bitmaps[bitmapCount++] = bitmap;
+    if (!(bitmap & 1) || bitmapCount == MAX_BITMAPS) return AddResult::COMPLETE;
+    nextPid = bitmapCount * 0x20;
+    return AddResult::MORE;
+}
+
+bool SupportedPIDs::contains(uint8_t pid) const {
+    if (pid == 0) return true;
+    if (pid > LAST_COVERED_PID) return true;
+    uint8_t index = (pid - 1) / 0x20;
+    if (index >= bitmapCount) return false;
+    return bitmaps[index] & (1UL << (31 - (pid - 1) % 0x20));
+}
+
+void SupportedPIDs::toRecord(Record& record) const {
+    memset(&record, 0, sizeof(record));
+    record.magic = RECORD_MAGIC;
+    record.bitmapCount = bitmapCount;
+    memcpy(record.bitmaps, bitmaps, sizeof(bitmaps));
+}
+
+bool SupportedPIDs::fromRecord(const Record& record) {
+    if (record.magic != RECORD_MAGIC || record.bitmapCount == 0 || record.bitmapCount > MAX_BITMAPS) return false;
+    memcpy(bitmaps, record.bitmaps, sizeof(bitmaps));
+    bitmapCount = record.bitmapCount;
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef SUPPORTED_PIDS_HPP
+#define SUPPORTED_PIDS_HPP
+
+#include <stdint.h>
+
+// Service 01 PIDs an ECU reports as supported. PIDs 0x00, 0x20, ... 0xC0
+// each answer a 32 bit bitmap of the next 32 PIDs (bit 31 = base + 1);
+// bit 0 says whether the next bitmap PID is supported, so they are read in
+// order until one leaves it clear.
+class SupportedPIDs {
+public:
+    static constexpr uint8_t MAX_BITMAPS = 7; // 0x00 - 0xC0, covering PIDs 0x01 - 0xE0
+    static constexpr uint8_t LAST_COVERED_PID = MAX_BITMAPS * 0x20;
+
+    static bool isBitmapPid(uint8_t pid) { return pid % 0x20 == 0 && pid < LAST_COVERED_PID; }
+
+    SupportedPIDs() { clear(); }
+    void clear();
+
+    enum class AddResult {
+        MORE,      // nextPid is the bitmap to read next
+        COMPLETE,
+        IGNORED    // Not the bitmap expected next (stale or duplicate reply)
+    };
+
+    // Stores the bitmap answered for bitmapPid, which must be the next one in order
+    AddResult add(uint8_t bitmapPid, uint32_t bitmap, uint8_t& nextPid);
+
+    // PIDs above 0xE0 are not covered by any bitmap and always count as supported
+    bool contains(uint8_t pid) const;
+    uint8_t getBitmapCount() const { return bitmapCount; }
+    uint32_t getBitmap(uint8_t index) const { return index < bitmapCount ? bitmaps[index] : 0; }
+
+    // Fixed size image for the per-vehicle cache
+    struct Record {
+        uint32_t magic;
+        uint32_t bitmapCount;
+        uint32_t bitmaps[MAX_BITMAPS];
+    };
+    void toRecord(Record& record) const;
+    bool fromRecord(const Record& record);
+
+private:
+    static constexpr uint32_t RECORD_MAGIC = 0x53504944; // "SPID"
+
+    uint32_t bitmaps[MAX_BITMAPS];
+    uint8_t bitmapCount;
+};
+
+#endif // SUPPORTED_PIDS_HPP
@@ -0,0 +1,45 @@
+#include "LogCodec.hpp"
+
+#include "Varint.hpp"
+
+size_t LogCodec::encode(const BinaryLogRecord* records, size_t count, uint64_t bootEpochMs, uint8_t* out, size_t outSize) {
+    VarintWriter writer = {out, outSize, 0, false};
+    writer.byte('L');
+    writer.byte('B');
+    writer.byte(VERSION);
+    writer.varint(bootEpochMs);
+    writer.varint(count);
+
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count && !writer.failed; i++) {
+        const BinaryLogRecord& record = records[i];
+        writer.zigzag((int64_t)record.uptimeMs - previous);
+        previous = record.uptimeMs;
+        writer.varint(record.format);
+        writer.byte(record.argCount);
+        for (uint8_t a = 0; a < record.argCount && a < BinaryLogRecord::MAX_ARGS; a++) writer.varint(record.args[a]);
+    }
+    return writer.failed ? 0 : writer.pos;
+}
+
+bool LogCodec::decode(const uint8_t* data, size_t size, const std::function<void(uint64_t bootEpochMs, const BinaryLogRecord& record)>& onRecord) {
+    VarintReader reader = {data, size, 0, false};
+    if (reader.byte() != 'L' || reader.byte() != 'B' || reader.byte() != VERSION) return false;
+    uint64_t bootEpochMs = reader.varint();
+    uint64_t count = reader.varint();
+    if (reader.failed || count > size) return false;
+
+    int64_t uptime = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        BinaryLogRecord record = {};
+        uptime += reader.zigzag();
+        record.uptimeMs = (uint32_t)uptime;
+        record.format = (uint16_t)reader.varint();
+        record.argCount = reader.byte();
+        if (record.argCount > BinaryLogRecord::MAX_ARGS) return false;
+        for (uint8_t a = 0; a < record.argCount; a++) record.args[a] = (uint32_t)reader.varint();
+        if (reader.failed) return false;
+        onRecord(bootEpochMs, record);
+    }
+    return reader.pos == size;
+}
@@ -0,0 +1,28 @@
+#ifndef LOG_CODEC_HPP
+#define LOG_CODEC_HPP
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../LOG/LogFormat.hpp"
+
+// Packed stream of binary log records.
+//
+//   'L' 'B' version
+//   varint  epoch ms at uptime 0 (0 while the wall clock was not set)
+//   varint  record count
+//   per record:
+//     zig-zag varint  uptime delta to the previous record (first one from 0)
+//     varint format, u8 argument count, count x varint argument
+class LogCodec {
+public:
+    static constexpr uint8_t VERSION = 1;
+
+    // Returns the encoded size, or 0 if out is too small
+    static size_t encode(const BinaryLogRecord* records, size_t count, uint64_t bootEpochMs, uint8_t* out, size_t outSize);
+    // Calls onRecord for every record. Returns false on malformed input.
+    static bool decode(const uint8_t* data, size_t size, const std::function<void(uint64_t bootEpochMs, const BinaryLogRecord& record)>& onRecord);
+};
+
+#endif // LOG_CODEC_HPP
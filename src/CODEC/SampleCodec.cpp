@@ -0,0 +1,168 @@
+#include "SampleCodec.hpp"
+
+#include "Varint.hpp"
+
+namespace {
+
+struct Column {
+    uint8_t pid;
+    uint16_t ecuId;
+    uint8_t len;
+    size_t count;
+};
+
+bool sameColumn(const Column& column, const SampleRecord& sample) {
+    return column.pid == sample.pid && column.ecuId == sample.ecuId && column.len == sample.len;
+}
+
+uint64_t rawValue(const SampleRecord& sample) {
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < sample.len; i++) value = (value << 8) | sample.data[i];
+    return value;
+}
+
+const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+} // namespace
+
+size_t SampleCodec::encode(const TimedSample* samples, size_t count, uint8_t* out, size_t outSize) {
+    if (!samples || count == 0) return 0;
+
+    // Group samples into columns without copying them
+    Column columns[MAX_COLUMNS];
+    size_t columnCount = 0;
+    uint64_t base = samples[0].epochMs;
+    for (size_t i = 0; i < count; i++) {
+        const SampleRecord& sample = samples[i].sample;
+        if (samples[i].epochMs < base) base = samples[i].epochMs;
+        size_t c = 0;
+        while (c < columnCount && !sameColumn(columns[c], sample)) c++;
+        if (c == columnCount) {
+            if (columnCount == MAX_COLUMNS) return 0;
+            columns[columnCount++] = {sample.pid, sample.ecuId, sample.len, 0};
+        }
+        columns[c].count++;
+    }
+
+    VarintWriter writer = {out, outSize, 0, false};
+    writer.byte('S');
+    writer.byte('C');
+    writer.byte(VERSION);
+    writer.varint(base);
+    writer.varint(columnCount);
+
+    for (size_t c = 0; c < columnCount && !writer.failed; c++) {
+        const Column& column = columns[c];
+        writer.byte(column.pid);
+        writer.varint(column.ecuId);
+        writer.byte(column.len);
+        writer.varint(column.count);
+
+        uint64_t previousTime = base;
+        for (size_t i = 0; i < count; i++) {
+            if (!sameColumn(column, samples[i].sample)) continue;
+            writer.zigzag((int64_t)(samples[i].epochMs - previousTime));
+            previousTime = samples[i].epochMs;
+        }
+
+        uint64_t previousValue = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!sameColumn(column, samples[i].sample)) continue;
+            uint64_t value = rawValue(samples[i].sample);
+            writer.zigzag((int64_t)(value - previousValue));
+            previousValue = value;
+        }
+    }
+
+    return writer.failed ? 0 : writer.pos;
+}
+
+bool SampleCodec::decode(const uint8_t* data, size_t size, const std::function<void(const TimedSample&)>& onSample) {
+    VarintReader reader = {data, size, 0, false};
+    if (reader.byte() != 'S' || reader.byte() != 'C' || reader.byte() != VERSION) return false;
+    uint64_t base = reader.varint();
+    uint64_t columnCount = reader.varint();
+
+    for (uint64_t c = 0; c < columnCount && !reader.failed; c++) {
+        TimedSample sample = {};
+        sample.sample.pid = reader.byte();
+        sample.sample.ecuId = (uint16_t)reader.varint();
+        sample.sample.len = reader.byte();
+        uint64_t count = reader.varint();
+        if (reader.failed || sample.sample.len > SampleRecord::MAX_DATA || count > size) return false;
+
+        // Timestamps and values are stored as two runs, walk both at once
+        VarintReader values = reader;
+        for (uint64_t i = 0; i < count; i++) values.zigzag();
+        if (values.failed) return false;
+
+        uint64_t time = base;
+        uint64_t value = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            time += reader.zigzag();
+            value += values.zigzag();
+            if (values.failed) return false;
+
+            sample.epochMs = time;
+            for (uint8_t b = 0; b < sample.sample.len; b++) {
+                sample.sample.data[b] = (uint8_t)(value >> (8 * (sample.sample.len - 1 - b)));
+            }
+            onSample(sample);
+        }
+        reader.pos = values.pos;
+    }
+
+    return !reader.failed && reader.pos == size;
+}
+
+size_t SampleCodec::base64Encode(const uint8_t* data, size_t size, char* out, size_t outSize) {
+    size_t length = base64Length(size);
+    if (outSize < length + 1) return 0;
+
+    char* p = out;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < size) chunk |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < size) chunk |= data[i + 2];
+        *p++ = BASE64_ALPHABET[(chunk >> 18) & 0x3F];
+        *p++ = BASE64_ALPHABET[(chunk >> 12) & 0x3F];
+        *p++ = i + 1 < size ? BASE64_ALPHABET[(chunk >> 6) & 0x3F] : '=';
+        *p++ = i + 2 < size ? BASE64_ALPHABET[chunk & 0x3F] : '=';
+    }
+    *p = '\0';
+    return length;
+}
+
+size_t SampleCodec::base64Decode(const char* text, size_t length, uint8_t* out, size_t outSize) {
+    if (length % 4 != 0) return 0;
+
+    size_t pos = 0;
+    for (size_t i = 0; i < length; i += 4) {
+        int v[4];
+        int padding = 0;
+        for (int k = 0; k < 4; k++) {
+            if (text[i + k] == '=' && i + 4 == length && k >= 2) {
+                v[k] = 0;
+                padding++;
+            } else if ((v[k] = base64Value(text[i + k])) < 0 || padding > 0) {
+                return 0;
+            }
+        }
+        uint32_t chunk = (v[0] << 18) | (v[1] << 12) | (v[2] << 6) | v[3];
+        int bytes = 3 - padding;
+        if (pos + bytes > outSize) return 0;
+        out[pos++] = chunk >> 16;
+        if (bytes > 1) out[pos++] = (chunk >> 8) & 0xFF;
+        if (bytes > 2) out[pos++] = chunk & 0xFF;
+    }
+    return pos;
+}
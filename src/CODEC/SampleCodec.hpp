@@ -0,0 +1,40 @@
+#ifndef SAMPLE_CODEC_HPP
+#define SAMPLE_CODEC_HPP
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../UTILS/SampleRecord.hpp"
+
+// Compact columnar encoding of a sample batch.
+//
+//   'S' 'C' version
+//   varint  base time (epoch ms, earliest sample)
+//   varint  column count
+//   per column (one per PID / ECU / data length):
+//     u8 pid, varint ecuId, u8 data length, varint sample count
+//     count x zig-zag varint  timestamp delta (first one from the base)
+//     count x zig-zag varint  raw value delta (data bytes read big-endian)
+//
+// Labels and formulas are not part of the payload; values stay raw and are
+// decoded with the PID config, exactly like the JSON path does on the device.
+class SampleCodec {
+public:
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t MAX_COLUMNS = 64;
+
+    // Returns the encoded size, or 0 if out is too small or the batch has
+    // more than MAX_COLUMNS distinct columns
+    static size_t encode(const TimedSample* samples, size_t count, uint8_t* out, size_t outSize);
+    // Calls onSample for every sample, column by column. Returns false on malformed input.
+    static bool decode(const uint8_t* data, size_t size, const std::function<void(const TimedSample&)>& onSample);
+
+    // Standard base64 with padding. encode returns the text length (without
+    // the terminator) or 0 if out is too small; decode returns the byte count.
+    static size_t base64Encode(const uint8_t* data, size_t size, char* out, size_t outSize);
+    static size_t base64Decode(const char* text, size_t length, uint8_t* out, size_t outSize);
+    static constexpr size_t base64Length(size_t size) { return (size + 2) / 3 * 4; }
+};
+
+#endif // SAMPLE_CODEC_HPP
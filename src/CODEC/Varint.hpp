@@ -0,0 +1,66 @@
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounds-checked LEB128 varint writer, sticks at failed once the buffer is full
+struct VarintWriter {
+    uint8_t* out;
+    size_t size;
+    size_t pos;
+    bool failed;
+
+    void byte(uint8_t value) {
+        if (pos >= size) {
+            failed = true;
+            return;
+        }
+        out[pos++] = value;
+    }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            byte((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        byte((uint8_t)value);
+    }
+
+    void zigzag(int64_t value) {
+        varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+    }
+};
+
+struct VarintReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    bool failed;
+
+    uint8_t byte() {
+        if (pos >= size) {
+            failed = true;
+            return 0;
+        }
+        return data[pos++];
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    int64_t zigzag() {
+        uint64_t value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+};
+
+#endif // VARINT_HPP
@@ -0,0 +1,155 @@
+#include "ConnectionHandler.hpp"
+
+#include <WiFi.h>
+#include <time.h>
+
+#include "../LOG/LogHandler.hpp"
+
+std::atomic<unsigned long> ConnectionHandler::firstSampleTime(0);
+std::atomic<unsigned long> ConnectionHandler::firstUploadTime(0);
+
+ConnectionHandler::ConnectionHandler(FirebaseHandler& firebaseHandler, const char* ntpServer)
+    : firebaseHandler(firebaseHandler), ntpServer(ntpServer) {}
+
+const char* ConnectionHandler::stateName(State state) {
+    switch (state) {
+        case State::WIFI_CONNECTING: return "WIFI_CONNECTING";
+        case State::NTP_SYNC: return "NTP_SYNC";
+        case State::FIREBASE_AUTH: return "FIREBASE_AUTH";
+        case State::FETCH_CONFIG: return "FETCH_CONFIG";
+        case State::READY: return "READY";
+        case State::BACKOFF: return "BACKOFF";
+        default: return "UNKNOWN";
+    }
+}
+
+void ConnectionHandler::handle() {
+    unsigned long elapsed = millis() - stateEnteredAt;
+
+    // Losing WiFi sends every later state back to the start
+    if (state != State::WIFI_CONNECTING && state != State::BACKOFF && WiFi.status() != WL_CONNECTED) {
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, String("WiFi connection lost"), false);
+        configFetched = false; // Check for a newer config once reconnected, cheap while it is unchanged
+        enter(State::WIFI_CONNECTING);
+        return;
+    }
+
+    switch (state) {
+        case State::WIFI_CONNECTING:
+            if (WiFi.status() == WL_CONNECTED) {
+                LogHandler::writeMessage(LogHandler::DebugType::INFO, String("WiFi connected: ") + WiFi.SSID() + ", IP: " + WiFi.localIP().toString());
+                enter(nextSetupState());
+            } else if (elapsed >= WIFI_TIMEOUT_MS) {
+                WiFi.reconnect();
+                fail(State::WIFI_CONNECTING, "WiFi connection timeout");
+            }
+            break;
+
+        case State::NTP_SYNC:
+            if (timeIsSet()) {
+                LogHandler::writeMessage(LogHandler::DebugType::INFO, "Epoch time: " + String(LogHandler::getTime()), false);
+                enter(nextSetupState());
+            } else if (elapsed >= NTP_TIMEOUT_MS) {
+                fail(State::NTP_SYNC, "NTP time sync timeout");
+            }
+            break;
+
+        case State::FIREBASE_AUTH:
+            if (firebaseHandler.completeSetup()) {
+                enter(nextSetupState());
+            } else if (elapsed >= AUTH_TIMEOUT_MS) {
+                firebaseStarted = false; // Start token generation again after the backoff
+                fail(State::FIREBASE_AUTH, "Firebase authentication timeout");
+            }
+            break;
+
+        case State::FETCH_CONFIG:
+            // One bounded request per visit, retried with backoff
+            if (firebaseHandler.fetchCANPIDs()) {
+                configFetched = true;
+                if (configFetchedCallback) configFetchedCallback();
+                enter(nextSetupState());
+            } else {
+                fail(State::FETCH_CONFIG, "PID config fetch failed");
+            }
+            break;
+
+        case State::READY:
+            if (!configFetched) enter(State::FETCH_CONFIG);
+            break;
+
+        case State::BACKOFF:
+            if (elapsed >= backoffMs) enter(retryState);
+            break;
+
+        default:
+            break;
+    }
+}
+
+ConnectionHandler::State ConnectionHandler::nextSetupState() const {
+    if (WiFi.status() != WL_CONNECTED) return State::WIFI_CONNECTING;
+    if (!timeIsSet()) return State::NTP_SYNC;
+    if (!firebaseHandler.firebaseConfigured) return State::FIREBASE_AUTH;
+    if (!configFetched) return State::FETCH_CONFIG;
+    return State::READY;
+}
+
+void ConnectionHandler::enter(State next) {
+    unsigned long now = millis();
+    State previous = state;
+    stateDurations[(uint8_t)previous] = now - stateEnteredAt;
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Connection: ") + stateName(previous) + " -> " + stateName(next) + " after " + String(stateDurations[(uint8_t)previous]) + " ms", false);
+
+    state = next;
+    stateEnteredAt = now;
+
+    switch (next) {
+        case State::NTP_SYNC:
+            configTime(0, 0, ntpServer);
+            break;
+        case State::FIREBASE_AUTH:
+            if (!firebaseStarted) {
+                firebaseHandler.begin();
+                firebaseStarted = true;
+            }
+            break;
+        case State::READY:
+            backoffMs = 0;
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Connection ready ") + String(now) + " ms after boot");
+            break;
+        default:
+            break;
+    }
+
+    if (stateChangedCallback) stateChangedCallback(previous, next);
+}
+
+void ConnectionHandler::fail(State retryState, const char* reason) {
+    backoffMs = backoffMs == 0 ? BACKOFF_MIN_MS : backoffMs * 2;
+    if (backoffMs > BACKOFF_MAX_MS) backoffMs = BACKOFF_MAX_MS;
+    this->retryState = retryState;
+    LogHandler::writeMessage(LogHandler::DebugType::WARNING, String(reason) + ", retrying in " + String(backoffMs) + " ms");
+    enter(State::BACKOFF);
+}
+
+bool ConnectionHandler::timeIsSet() {
+    struct tm timeinfo;
+    return getLocalTime(&timeinfo, 0) && timeinfo.tm_year >= (2020 - 1900);
+}
+
+void ConnectionHandler::markFirstSample() {
+    unsigned long expected = 0;
+    unsigned long now = millis();
+    if (firstSampleTime.compare_exchange_strong(expected, now)) {
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Time to first sample: " + String(now) + " ms");
+    }
+}
+
+void ConnectionHandler::markFirstUpload() {
+    unsigned long expected = 0;
+    unsigned long now = millis();
+    if (firstUploadTime.compare_exchange_strong(expected, now)) {
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Time to first upload: " + String(now) + " ms");
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef CONNECTION_HANDLER_HPP
+#define CONNECTION_HANDLER_HPP
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+
+#include "../Firebase/FirebaseHandler.hpp"
+
+// Brings up WiFi, NTP, Firebase auth and the PID config fetch as an explicit
+// state machine. handle() never waits: every state polls its condition, gives
+// up after a timeout and retries with exponential backoff.
+class ConnectionHandler {
+public:
+    enum class State : uint8_t {
+        WIFI_CONNECTING,
+        NTP_SYNC,
+        FIREBASE_AUTH,
+        FETCH_CONFIG,
+        READY,
+        BACKOFF,
+        COUNT
+    };
+
+    ConnectionHandler(FirebaseHandler& firebaseHandler, const char* ntpServer);
+    void handle();
+
+    State getState() const { return state; }
+    bool isReady() const { return state == State::READY; }
+    static const char* stateName(State state);
+    unsigned long getStateDuration(State state) const { return stateDurations[(uint8_t)state]; } // Length of the last visit, ms
+
+    void requestConfigFetch() { configFetched = false; } // Fetch the PID config again once connected
+    void setStateChangedCallback(std::function<void(State, State)> callback) { stateChangedCallback = callback; }
+    void setConfigFetchedCallback(std::function<void()> callback) { configFetchedCallback = callback; }
+
+    // Boot metrics, in ms since boot (0 until it happened)
+    static void markFirstSample();
+    static void markFirstUpload();
+    static unsigned long getTimeToFirstSample() { return firstSampleTime; }
+    static unsigned long getTimeToFirstUpload() { return firstUploadTime; }
+
+private:
+    static constexpr unsigned long WIFI_TIMEOUT_MS = 20000;
+    static constexpr unsigned long NTP_TIMEOUT_MS = 15000;
+    static constexpr unsigned long AUTH_TIMEOUT_MS = 30000;
+    static constexpr unsigned long BACKOFF_MIN_MS = 1000;
+    static constexpr unsigned long BACKOFF_MAX_MS = 60000;
+
+    void enter(State next);
+    void fail(State retryState, const char* reason);
+    State nextSetupState() const;
+    static bool timeIsSet();
+
+    FirebaseHandler& firebaseHandler;
+    const char* ntpServer;
+
+    State state = State::WIFI_CONNECTING;
+    State retryState = State::WIFI_CONNECTING; // State to resume after BACKOFF
+    unsigned long stateEnteredAt = 0;
+    unsigned long backoffMs = 0;
+    unsigned long stateDurations[(uint8_t)State::COUNT] = {0};
+
+    bool firebaseStarted = false;
+    bool configFetched = false;
+
+    std::function<void(State, State)> stateChangedCallback;
+    std::function<void()> configFetchedCallback;
+
+    static std::atomic<unsigned long> firstSampleTime;
+    static std::atomic<unsigned long> firstUploadTime;
+};
+
+#endif // CONNECTION_HANDLER_HPP
@@ -1,263 +1,382 @@
-#include "FirebaseHandler.hpp"
-#include "addons/TokenHelper.h"
-#include "addons/RTDBHelper.h"
-#include "../LOG/LogHandler.hpp"
-
-FirebaseHandler* FirebaseHandler::instance = nullptr;
-
-FirebaseHandler::FirebaseHandler(const String& apiKey, const String& userEmail, const String& userPassword, const String& databaseUrl, std::map<byte, PIDConfig>& pidMapRef) : pidMap(pidMapRef) {
-    config.api_key = apiKey;
-    auth.user.email = userEmail;
-    auth.user.password = userPassword;
-    config.database_url = databaseUrl;
-    instance = this;
-}
-
-void FirebaseHandler::begin() {
-    Firebase.reconnectWiFi(true);
-    fbdo.setResponseSize(4096);
-
-    // Assign the callback function for the long-running token generation task
-    config.token_status_callback = tokenStatusCallback;
-
-    // Assign the maximum retry of token generation
-    config.max_token_generation_retry = 5;
-
-    // Initialize the library with the Firebase auth and config
-    Firebase.begin(&config, &auth);
-
-    // Wait for the user UID
-    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Waiting for user UID...", false);
-    while ((auth.token.uid) == "") {
-        LogHandler::writeMessage(LogHandler::DebugType::INFO, "...", false);
-        delay(1000);
-    }
-
-    // Store the user UID
-    String uid = auth.token.uid.c_str();
-    LogHandler::writeMessage(LogHandler::DebugType::INFO, "User UID: " + uid);
-
-    // Set paths
-    String userPath = "/data/" + uid;
-    sensorsPath = userPath + "/readings";
-    logsPath = userPath + "/logs";
-
-    // Update the reading path
-    String readingPath = userPath + "/outputs";
-    Firebase.RTDB.beginStream(&stream, readingPath.c_str());
-    Firebase.RTDB.setStreamCallback(&stream, streamCallback, streamTimeoutCallback);
-
-    // Fetch CAN PIDs
-    pidPath = userPath + "/config/sensors";
-    // Firebase.RTDB.beginStream(&stream2, pidPath.c_str());
-    // Firebase.RTDB.setStreamCallback(&stream2, streamCallback2, streamTimeoutCallback2);
-
-    firebaseConfigured = true;
-}
-
-void FirebaseHandler::streamCallback(FirebaseStream data) {
-    if (instance && instance->firebaseConfigured) {
-        if (data.dataTypeEnum() == fb_esp_rtdb_data_type_json) {
-            FirebaseJson* json = data.jsonObjectPtr();
-            FirebaseJsonData result;
-            if (json->get(result, "CAN_REQUEST_INTERVAL") && result.typeNum == FirebaseJson::JSON_INT) {
-                SettingsHandler::setCanRequestInterval(result.intValue);
-            }
-            if (json->get(result, "CAN_RESPONSE_THRESHOLD") && result.typeNum == FirebaseJson::JSON_INT) {
-               SettingsHandler::setCanResponseThreshold(result.intValue);
-            }
-            if (json->get(result, "ENABLE_LOGS") && result.typeNum == FirebaseJson::JSON_INT) {
-                SettingsHandler::setEnableLogs(result.boolValue);
-            }
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN_REQUEST_INTERVAL: " + String(SettingsHandler::getCanRequestInterval()) + ", CAN_RESPONSE_THRESHOLD: " + String(SettingsHandler::getCanResponseThreshold()) + ", ENABLE_LOGS: " + String(SettingsHandler::getEnableLogs()));
-        } else if (data.dataPath() == "/CAN_REQUEST_INTERVAL") {
-            SettingsHandler::setCanRequestInterval(data.intData());
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN_REQUEST_INTERVAL updated: " + String(SettingsHandler::getCanRequestInterval()));
-        } else if (data.dataPath() == "/CAN_RESPONSE_THRESHOLD") {
-            SettingsHandler::setCanResponseThreshold(data.intData());
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN_RESPONSE_THRESHOLD updated: " + String(SettingsHandler::getCanResponseThreshold()));
-        } else if (data.dataPath() == "/ENABLE_LOGS") {
-            SettingsHandler::setEnableLogs(data.boolData());
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "ENABLE_LOGS updated: " + String(SettingsHandler::getEnableLogs()));
-        } else {
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "Stream data received: " + data.dataPath() + " -> " + data.stringData());
-        }
-    }
-}
-
-void FirebaseHandler::streamCallback2(FirebaseStream data)
-{
-    if (instance && instance->firebaseConfigured)
-    {
-        // instance->fetchCANPIDs();
-    }
-}
-
-void FirebaseHandler::streamTimeoutCallback(bool timeout) {
-    if (timeout)
-        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Stream timeout, resuming...");
-}
-
-void FirebaseHandler::streamTimeoutCallback2(bool timeout) {
-    if (timeout)
-        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Stream timeout, resuming...");
-}
-
-void FirebaseHandler::addData(const String& key, const String& value) {
-    String formattedKey = "/" + key;
-    dataMap[formattedKey] = value;
-}
-
-void FirebaseHandler::addData(std::vector<CANResponse>& results) {
-    for (const auto& response : results) {
-        String formattedKey = "/" + response.PID;
-        dataMap[formattedKey] = response.Value;
-    }
-}
-
-void FirebaseHandler::readData() {
-    Firebase.RTDB.readStream(&stream);
-    // Firebase.RTDB.readStream(&stream2);
-}
-
-bool FirebaseHandler::setJSONWithRetry(FirebaseData* fbdo, const String& path, FirebaseJson* json, int maxRetries, int delayMs) {
-    int attempt = 0;
-    bool success = false;
-    while (attempt < maxRetries && !success) {
-        success = Firebase.RTDB.setJSON(fbdo, path.c_str(), json);
-        if (!success) {
-            String msg = "Set json failed (attempt " + String(attempt + 1) + "): " + fbdo->errorReason();
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, msg);
-            delay(delayMs);
-        }
-        attempt++;
-    }
-    return success;
-}
-
-bool FirebaseHandler::sendData(bool dataWasReceived, unsigned long timestamp) {
-    if (dataWasReceived && !dataMap.empty() && Firebase.ready() && (millis() - sendDataPrevMillis > SettingsHandler::getCanRequestInterval() || sendDataPrevMillis == 0)) {
-        sendDataPrevMillis = millis();
-
-        // Construct the full path with the timestamp
-        String fullPath = sensorsPath;
-        fullPath += "/";
-        fullPath += String(timestamp); // Add timestamp as part of the path
-
-        // Set all key-value pairs in the JSON object
-        for (auto it = dataMap.begin(); it != dataMap.end(); ) {
-            json.set(it->first.c_str(), it->second);
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "Adding data to JSON: " + it->first + " -> " + it->second, false);
-            it = dataMap.erase(it);
-        }
-
-        // Optionally include the timestamp in the data
-        json.set("/timestamp", String(timestamp));
-
-        // Send the JSON object to Firebase
-        setJSONWithRetry(&fbdo, fullPath, &json, 3, 100);
-
-        return true;
-    }
-    return false;
-}
-
-void FirebaseHandler::sendQueuedLogMessages() {
-    if (firebaseConfigured) {
-        static unsigned long lastSendTime = 0;
-        unsigned long now = millis();
-        if (now - lastSendTime < 10000) { // 10 seconds
-            return;
-        }
-        lastSendTime = now;
-        std::vector<LogHandler::LogEntry> logEntries = LogHandler::getAndClearLogs();
-
-        // Group by path, then by timestamp
-        std::map<String, std::map<long, std::vector<LogHandler::LogEntry>>> groupedMessages;
-        for (auto& entry : logEntries) {
-            if (entry.timestamp <= 0) {
-                entry.timestamp = LogHandler::getTime() - ((millis() + entry.timestamp) / 1000);
-            }
-            // Assume entry has a .path member; if not, replace with your logic or a default path
-            String path = entry.path.isEmpty() ? "default" : entry.path;
-            groupedMessages[path][entry.timestamp].push_back(entry);
-        }
-
-        for (const auto& pathPair : groupedMessages) {
-            const String& path = pathPair.first;
-            const auto& timestampMap = pathPair.second;
-            for (const auto& tsPair : timestampMap) {
-                long timestamp = tsPair.first;
-                const std::vector<LogHandler::LogEntry>& entries = tsPair.second;
-
-                // Combine all messages for this timestamp into one string
-                String combinedMessage;
-                for (const auto& entry : entries) {
-                    if (!combinedMessage.isEmpty()) combinedMessage += "; ";
-                    combinedMessage += entry.message;
-                }
-
-                String queuedFullPath = logsPath + "/" + path + "/" + String(timestamp);
-                FirebaseJson json;
-                json.set("timestamp", String(timestamp));
-                json.set("message", combinedMessage);
-                Firebase.RTDB.setJSON(&fbdo, queuedFullPath.c_str(), &json);
-                LogHandler::writeMessage(LogHandler::DebugType::INFO, "Queued log message sent to Firebase: " + combinedMessage, false);
-            }
-        }
-    }
-}
-
-bool FirebaseHandler::fetchCANPIDs() {
-    if (!firebaseConfigured) return false;
-
-    if (Firebase.RTDB.getJSON(&fbdo, pidPath.c_str())) {
-        String raw = fbdo.payload().c_str();
-        // Serial.println("RAW JSON FROM FIREBASE:");
-        // Serial.println(raw);
-
-        FirebaseJsonArray arr;
-        arr.setJsonArrayData(raw);
-
-        pidMap.clear();
-        FirebaseJsonData result;
-        int maxSensors = 20;
-        int len = arr.size();
-        if (len > maxSensors) len = maxSensors;
-
-        for (int i = 0; i < len; ++i) {
-            FirebaseJson jsonObj;
-            arr.get(result, i);
-            if (!result.success) continue;
-            jsonObj.setJsonData(result.stringValue);
-
-            // Only add if enabled
-            if (!jsonObj.get(result, "enabled") || !result.boolValue) continue;
-
-            // Get PID as string, then convert to byte
-            if (!jsonObj.get(result, "pid")) continue;
-            String pidStr = result.stringValue;
-            byte pid = (byte)strtol(pidStr.c_str(), nullptr, 0); // Handles "0x.." or decimal
-
-            // Get label/id
-            String label = "";
-            if (jsonObj.get(result, "id")) label = result.stringValue;
-
-            // Get formula
-            String formula = "";
-            if (jsonObj.get(result, "formula")) formula = result.stringValue;
-
-            // Get unit
-            String unit = "";
-            if (jsonObj.get(result, "unit")) unit = result.stringValue;
-
-            pidMap[pid] = PIDConfig{label, formula, unit};
-        }
-
-        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Fetched " + String(pidMap.size()) + " active CAN PIDs from Firebase config.");
-        return true;
-    } else {
-        LogHandler::writeMessage(LogHandler::DebugType::ERROR, "Failed to fetch CAN PID config from Firebase: " + fbdo.errorReason());
-    }
-    return false;
-}
+#include "FirebaseHandler.hpp"
+#include "addons/TokenHelper.h"
+#include "addons/RTDBHelper.h"
+#include "../LOG/LogHandler.hpp"
+
+FirebaseHandler* FirebaseHandler::instance = nullptr;
+
+FirebaseHandler::FirebaseHandler(const String& apiKey, const String& userEmail, const String& userPassword, const String& databaseUrl, SharedPIDTable& pidTables) : pidTables(pidTables) {
+    config.api_key = apiKey;
+    auth.user.email = userEmail;
+    auth.user.password = userPassword;
+    config.database_url = databaseUrl;
+    instance = this;
+}
+
+void FirebaseHandler::begin() {
+    Firebase.reconnectWiFi(true);
+    fbdo.setResponseSize(4096);
+
+    // Assign the callback function for the long-running token generation task
+    config.token_status_callback = tokenStatusCallback;
+
+    // Assign the maximum retry of token generation
+    config.max_token_generation_retry = 5;
+
+    // Initialize the library with the Firebase auth and config; the token is
+    // generated in the background and completeSetup() picks up the result
+    Firebase.begin(&config, &auth);
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Waiting for user UID...", false);
+}
+
+bool FirebaseHandler::completeSetup() {
+    if (firebaseConfigured) return true;
+    if ((auth.token.uid) == "") return false;
+
+    // Store the user UID
+    String uid = auth.token.uid.c_str();
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "User UID: " + uid);
+
+    // Set paths
+    userPath = "/data/" + uid;
+
+    // Update the reading path
+    String readingPath = userPath + "/outputs";
+    Firebase.RTDB.beginStream(&stream, readingPath.c_str());
+    Firebase.RTDB.setStreamCallback(&stream, streamCallback, streamTimeoutCallback);
+
+    // CAN PIDs, streamed by fetchCANPIDs()
+    pidPath = userPath + "/config/sensors";
+    configVersionPath = userPath + "/config/version";
+
+    firebaseConfigured = true;
+    return true;
+}
+
+void FirebaseHandler::streamCallback(FirebaseStream data) {
+    if (instance && instance->firebaseConfigured) {
+        if (data.dataTypeEnum() == fb_esp_rtdb_data_type_json) {
+            FirebaseJson* json = data.jsonObjectPtr();
+            FirebaseJsonData result;
+            if (json->get(result, "CAN_REQUEST_INTERVAL") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setCanRequestInterval(result.intValue);
+            }
+            if (json->get(result, "CAN_RESPONSE_THRESHOLD") && result.typeNum == FirebaseJson::JSON_INT) {
+               SettingsHandler::setCanResponseThreshold(result.intValue);
+            }
+            if (json->get(result, "ENABLE_LOGS") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setEnableLogs(result.boolValue);
+            }
+            if (json->get(result, "ISOTP_BLOCK_SIZE") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setIsoTpBlockSize(result.intValue);
+            }
+            if (json->get(result, "ISOTP_STMIN") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setIsoTpStMin(result.intValue);
+            }
+            if (json->get(result, "UPLOAD_BATCH_SIZE") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setUploadBatchSize(result.intValue);
+            }
+            if (json->get(result, "UPLOAD_BATCH_AGE") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setUploadBatchAge(result.intValue);
+            }
+            if (json->get(result, "UPLOAD_FORMAT") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setUploadFormat(result.intValue);
+            }
+            if (json->get(result, "LOG_LEVEL") && result.typeNum == FirebaseJson::JSON_INT) {
+                SettingsHandler::setLogLevel(result.intValue);
+            }
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN_REQUEST_INTERVAL: " + String(SettingsHandler::getCanRequestInterval()) + ", CAN_RESPONSE_THRESHOLD: " + String(SettingsHandler::getCanResponseThreshold()) + ", ENABLE_LOGS: " + String(SettingsHandler::getEnableLogs()));
+        } else if (data.dataPath() == "/CAN_REQUEST_INTERVAL") {
+            SettingsHandler::setCanRequestInterval(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN_REQUEST_INTERVAL updated: " + String(SettingsHandler::getCanRequestInterval()));
+        } else if (data.dataPath() == "/CAN_RESPONSE_THRESHOLD") {
+            SettingsHandler::setCanResponseThreshold(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN_RESPONSE_THRESHOLD updated: " + String(SettingsHandler::getCanResponseThreshold()));
+        } else if (data.dataPath() == "/ENABLE_LOGS") {
+            SettingsHandler::setEnableLogs(data.boolData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "ENABLE_LOGS updated: " + String(SettingsHandler::getEnableLogs()));
+        } else if (data.dataPath() == "/ISOTP_BLOCK_SIZE") {
+            SettingsHandler::setIsoTpBlockSize(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "ISOTP_BLOCK_SIZE updated: " + String(SettingsHandler::getIsoTpBlockSize()));
+        } else if (data.dataPath() == "/ISOTP_STMIN") {
+            SettingsHandler::setIsoTpStMin(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "ISOTP_STMIN updated: " + String(SettingsHandler::getIsoTpStMin()));
+        } else if (data.dataPath() == "/UPLOAD_BATCH_SIZE") {
+            SettingsHandler::setUploadBatchSize(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "UPLOAD_BATCH_SIZE updated: " + String(SettingsHandler::getUploadBatchSize()));
+        } else if (data.dataPath() == "/UPLOAD_BATCH_AGE") {
+            SettingsHandler::setUploadBatchAge(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "UPLOAD_BATCH_AGE updated: " + String(SettingsHandler::getUploadBatchAge()));
+        } else if (data.dataPath() == "/UPLOAD_FORMAT") {
+            SettingsHandler::setUploadFormat(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "UPLOAD_FORMAT updated: " + String(SettingsHandler::getUploadFormat()));
+        } else if (data.dataPath() == "/LOG_LEVEL") {
+            SettingsHandler::setLogLevel(data.intData());
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "LOG_LEVEL updated: " + String(SettingsHandler::getLogLevel()));
+        } else {
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, "Stream data received: " + data.dataPath() + " -> " + data.stringData());
+        }
+    }
+}
+
+void FirebaseHandler::streamCallback2(FirebaseStream data) {
+    if (instance && instance->firebaseConfigured) {
+        std::lock_guard<std::mutex> lock(instance->sensorsMutex);
+        instance->sensorsEvents.push_back({data.dataPath(), data.payload().c_str(), data.eventType() == "patch"});
+    }
+}
+
+void FirebaseHandler::versionCallback(FirebaseStream data) {
+    if (instance && instance->firebaseConfigured) {
+        // The first event is the value at connect, equal unless it just changed
+        String version = data.dataTypeEnum() == fb_esp_rtdb_data_type_null ? "" : String(data.payload().c_str()).substring(0, PIDConfigCache::MAX_VERSION);
+        std::lock_guard<std::mutex> lock(instance->sensorsMutex);
+        if (version != instance->cachedVersion) instance->versionChanged = true;
+    }
+}
+
+void FirebaseHandler::streamTimeoutCallback(bool timeout) {
+    if (timeout)
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Stream timeout, resuming...");
+}
+
+void FirebaseHandler::streamTimeoutCallback2(bool timeout) {
+    if (timeout)
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Stream timeout, resuming...");
+}
+
+void FirebaseHandler::readData() {
+    Firebase.RTDB.readStream(&stream);
+    Firebase.RTDB.readStream(&stream2);
+    // config/version moved away from the cached config, the list is needed
+    if (versionChanged.exchange(false) && !streamSensors()) versionChanged = true;
+    applySensorsEvents();
+}
+
+bool FirebaseHandler::setJSONWithRetry(FirebaseData* fbdo, const String& path, FirebaseJson* json, int maxRetries, int delayMs) {
+    int attempt = 0;
+    bool success = false;
+    while (attempt < maxRetries && !success) {
+        success = Firebase.RTDB.setJSON(fbdo, path.c_str(), json);
+        if (!success) {
+            String msg = "Set json failed (attempt " + String(attempt + 1) + "): " + fbdo->errorReason();
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, msg);
+            delay(delayMs);
+        }
+        attempt++;
+    }
+    return success;
+}
+
+bool FirebaseHandler::updateNodeWithRetry(FirebaseData* fbdo, const String& path, FirebaseJson* json, int maxRetries, int delayMs) {
+    int attempt = 0;
+    bool success = false;
+    while (attempt < maxRetries && !success) {
+        success = Firebase.RTDB.updateNode(fbdo, path.c_str(), json);
+        if (!success) {
+            String msg = "Update node failed (attempt " + String(attempt + 1) + "): " + fbdo->errorReason();
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, msg);
+            delay(delayMs);
+        }
+        attempt++;
+    }
+    return success;
+}
+
+bool FirebaseHandler::isReady() {
+    return firebaseConfigured && Firebase.ready();
+}
+
+bool FirebaseHandler::update(const char* node, const String& json) {
+    FirebaseJson data;
+    if (!data.setJsonData(json)) return false;
+    return updateNodeWithRetry(&fbdo, userPath + "/" + node, &data, 3, 100);
+}
+
+bool FirebaseHandler::fetchCANPIDs() {
+    if (!firebaseConfigured) return false;
+
+    // The config polled since boot is the cached one, and config/version
+    // says it is still current: only watch config/version
+    String version = fetchConfigVersion();
+    bool current = configCache && !version.isEmpty() && version == configCache->getRemoteVersion() &&
+                   PIDConfigCache::hashOf(*pidTables.load()) == configCache->getHash();
+    {
+        std::lock_guard<std::mutex> lock(sensorsMutex);
+        cachedVersion = configCache ? configCache->getRemoteVersion() : "";
+    }
+    if (!current) return streamSensors();
+
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "PID config unchanged (version " + version + ")");
+    if (!Firebase.RTDB.beginStream(&stream2, configVersionPath.c_str())) {
+        LogHandler::writeMessage(LogHandler::DebugType::ERROR, "Failed to stream PID config version from Firebase: " + stream2.errorReason());
+        return false;
+    }
+    Firebase.RTDB.setStreamCallback(&stream2, versionCallback, streamTimeoutCallback2);
+    return true;
+}
+
+bool FirebaseHandler::streamSensors() {
+    // The stream starts with the whole list, so it does the fetch
+    Firebase.RTDB.endStream(&stream2);
+    if (!Firebase.RTDB.beginStream(&stream2, pidPath.c_str())) {
+        LogHandler::writeMessage(LogHandler::DebugType::ERROR, "Failed to stream CAN PID config from Firebase: " + stream2.errorReason());
+        return false;
+    }
+    Firebase.RTDB.setStreamCallback(&stream2, streamCallback2, streamTimeoutCallback2);
+    return true;
+}
+
+String FirebaseHandler::fetchConfigVersion() {
+    if (!Firebase.RTDB.get(&fbdo, configVersionPath.c_str()) || fbdo.dataTypeEnum() == fb_esp_rtdb_data_type_null) return "";
+    // Cut like the cache stores it
+    return String(fbdo.payload().c_str()).substring(0, PIDConfigCache::MAX_VERSION);
+}
+
+void FirebaseHandler::applySensorsEvents() {
+    std::vector<SensorsEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(sensorsMutex);
+        events.swap(sensorsEvents);
+    }
+    bool changed = false;
+    for (const SensorsEvent& event : events) {
+        if (onSensorsEvent(event.path, event.raw, event.patch)) changed = true;
+    }
+    // One table per batch of events; read the version after the changes so
+    // the cache is never newer than the version it is saved under
+    if (changed) publishSensors(configCache ? fetchConfigVersion() : String());
+}
+
+// Stream paths: "/" is the whole list (put on connect, or a patch of some
+// entries), "/<index>" one entry and "/<index>/<field>" one of its fields
+bool FirebaseHandler::onSensorsEvent(const String& path, const String& raw, bool patch) {
+    if (path == "/") {
+        // A put is the whole list, first thing after the stream connects
+        applySensors(raw, !patch);
+        if (!patch) LogHandler::writeMessage(LogHandler::DebugType::INFO, "Fetched " + String((unsigned)sensors.size()) + " CAN PID entries from Firebase config.");
+        return true;
+    }
+    if (!applySensorPath(path.substring(1), raw, patch)) {
+        LogHandler::writeMessage(LogHandler::DebugType::WARNING, "PID config change ignored: " + path);
+        return false;
+    }
+    return true;
+}
+
+void FirebaseHandler::applySensors(const String& raw, bool replace) {
+    if (replace) sensors.clear();
+    if (raw.startsWith("[")) {
+        FirebaseJsonArray arr;
+        FirebaseJsonData result;
+        arr.setJsonArrayData(raw);
+        for (size_t i = 0; i < arr.size() && i < SensorConfig::MAX_SENSORS; i++) {
+            if (arr.get(result, i)) applySensor(i, result.stringValue, false);
+        }
+    } else if (raw.startsWith("{")) {
+        // A list with gaps comes keyed by index, a patch by "<index>" or
+        // "<index>/<field>"; each key replaces what it names
+        FirebaseJson json;
+        json.setJsonData(raw);
+        size_t count = json.iteratorBegin();
+        for (size_t i = 0; i < count; i++) {
+            FirebaseJson::IteratorValue child = json.valueAt(i);
+            if (child.depth != 0) continue;
+            String key = child.key.c_str();
+            String value = child.value.c_str();
+            if (child.type == FirebaseJson::JSON_STRING && !value.startsWith("\"")) value = "\"" + value + "\"";
+            if (!applySensorPath(key, value, false)) {
+                LogHandler::writeMessage(LogHandler::DebugType::WARNING, "PID config key ignored: " + key);
+            }
+        }
+        json.iteratorEnd();
+    }
+}
+
+bool FirebaseHandler::applySensorPath(const String& path, const String& raw, bool merge) {
+    int fieldStart = path.indexOf('/');
+    uint16_t index;
+    if (!parseSensorIndex(fieldStart < 0 ? path : path.substring(0, fieldStart), index)) return false;
+    if (fieldStart < 0) {
+        applySensor(index, raw, merge);
+        return true;
+    }
+
+    // Only the fields parseSensorFields() reads; the name goes into JSON as is
+    String field = path.substring(fieldStart + 1);
+    if (!isSensorField(field)) return false;
+    // Entries added in the dashboard may arrive one field at a time
+    SensorConfig::Entry* entry = sensors.find(index);
+    if (!entry) {
+        sensors.set(index, SensorConfig::Entry());
+        entry = sensors.find(index);
+    }
+    FirebaseJson json;
+    json.setJsonData("{\"" + field + "\":" + raw + "}");
+    parseSensorFields(json, *entry);
+    return true;
+}
+
+bool FirebaseHandler::isSensorField(const String& field) {
+    static const char* const FIELDS[] = {"enabled", "pid", "id", "formula", "unit", "rate", "priority"};
+    for (const char* known : FIELDS) {
+        if (field == known) return true;
+    }
+    return false;
+}
+
+bool FirebaseHandler::parseSensorIndex(const String& key, uint16_t& index) {
+    if (key.isEmpty() || key.length() > 3) return false;
+    for (size_t i = 0; i < key.length(); i++) {
+        if (key[i] < '0' || key[i] > '9') return false;
+    }
+    index = key.toInt();
+    return index < SensorConfig::MAX_SENSORS;
+}
+
+void FirebaseHandler::applySensor(uint16_t index, const String& raw, bool merge) {
+    if (raw == "null") {
+        sensors.remove(index);
+        return;
+    }
+    SensorConfig::Entry entry;
+    SensorConfig::Entry* existing = sensors.find(index);
+    if (merge && existing) entry = *existing;
+
+    FirebaseJson json;
+    json.setJsonData(raw);
+    parseSensorFields(json, entry);
+    sensors.set(index, entry);
+}
+
+void FirebaseHandler::parseSensorFields(FirebaseJson& json, SensorConfig::Entry& entry) {
+    FirebaseJsonData result;
+    if (json.get(result, "enabled")) entry.enabled = result.boolValue;
+    // "0x.." or decimal
+    if (json.get(result, "pid")) entry.pid = strtol(result.stringValue.c_str(), nullptr, 0);
+    if (json.get(result, "id")) entry.label = result.stringValue;
+    if (json.get(result, "formula")) entry.formula = result.stringValue;
+    if (json.get(result, "unit")) entry.unit = result.stringValue;
+    // Polling rate (Hz) and priority, both optional
+    if (json.get(result, "rate")) entry.rate = result.stringValue.toFloat();
+    if (json.get(result, "priority")) entry.priority = result.stringValue.toInt();
+}
+
+void FirebaseHandler::publishSensors(const String& version) {
+    std::shared_ptr<const PIDTable> active = pidTables.load();
+    std::shared_ptr<const PIDTable> next = sensors.buildTable(*active);
+    if (next) {
+        // CANHandler picks the table up on its next pass and keeps the
+        // deadlines of PIDs it already polls
+        pidTables.publish(next);
+        active = next;
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "PID config updated: " + String((unsigned)active->size()) + " active CAN PIDs");
+    } else {
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, String("PID config unchanged"));
+    }
+    if (!configCache) return;
+
+    if (next || PIDConfigCache::hashOf(*active) != configCache->getHash() || version != configCache->getRemoteVersion()) {
+        configCache->save(*active, version.c_str());
+    }
+}
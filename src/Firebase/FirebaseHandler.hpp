@@ -1,61 +1,87 @@
-#ifndef FIREBASE_HANDLER_HPP
-#define FIREBASE_HANDLER_HPP
-
-#include <Firebase_ESP_Client.h>
-#include <FirebaseJson.h>
-#include <map>
-#include <Arduino.h>
-#include <queue>
-#include <vector>
-
-#include "FirebaseConfig.hpp"
-#include "../SETTINGS/SettingsHandler.hpp"
-#include "../LOG/LogHandler.hpp"
-#include "../UTILS/CANResponse.hpp"
-#include "../UTILS/PIDConfig.hpp"
-
-struct LogEntry {
-    String path;
-    String message;
-};
-
-class FirebaseHandler {
-public:
-    FirebaseHandler(const String& apiKey, const String& userEmail, const String& userPassword, const String& databaseUrl, std::map<byte, PIDConfig>& pidMapRef);
-    void begin();
-    void addData(const String& key, const String& value); // Add key-value pair to the dictionary
-    void addData(std::vector<CANResponse>& results);
-    bool sendData(bool dataWasReceived, unsigned long timestamp);              // Send all data in the dictionary
-    static void streamCallback(FirebaseStream data);
-    static void streamCallback2(FirebaseStream data);
-    static void streamTimeoutCallback(bool timeout);
-    static void streamTimeoutCallback2(bool timeout);
-    void readData();
-    void sendQueuedLogMessages();
-    bool setJSONWithRetry(FirebaseData* fbdo, const String& path, FirebaseJson* json, int maxRetries, int delayMs);
-    bool fetchCANPIDs();
-    bool firebaseConfigured = false;
-
-private:
-    static FirebaseHandler* instance;
-    FirebaseData fbdo;
-    FirebaseAuth auth;
-    FirebaseConfig config;
-    FirebaseJson json;
-    FirebaseData stream;
-    FirebaseData stream2;
-
-    String sensorsPath;
-    String logsPath;
-    String pidPath;
-    std::queue<LogEntry> logQueue;
-
-    std::map<byte, PIDConfig>& pidMap;
-
-    unsigned long sendDataPrevMillis = 0;
-    const unsigned long timerDelay = 5000; // Fixed interval (5 seconds)
-
-    std::map<String, String> dataMap; // Dictionary to store key-value pairs
-};
-
+#ifndef FIREBASE_HANDLER_HPP
+#define FIREBASE_HANDLER_HPP
+
+#include <Firebase_ESP_Client.h>
+#include <FirebaseJson.h>
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "FirebaseConfig.hpp"
+#include "../CAN/SensorConfig.hpp"
+#include "../SETTINGS/SettingsHandler.hpp"
+#include "../HAL/Uplink.hpp"
+#include "../LOG/LogHandler.hpp"
+#include "../STORAGE/PIDConfigCache.hpp"
+#include "../UTILS/PIDTable.hpp"
+
+class FirebaseHandler : public Uplink {
+public:
+    FirebaseHandler(const String& apiKey, const String& userEmail, const String& userPassword, const String& databaseUrl, SharedPIDTable& pidTables);
+    void begin();         // Starts authentication without waiting for it
+    bool completeSetup(); // Sets paths and streams once the user UID is known, false until then
+    // Uplink: update() merges JSON into /data/<uid>/<node>
+    bool isReady() override;
+    bool update(const char* node, const String& json) override;
+    static void streamCallback(FirebaseStream data);
+    static void streamCallback2(FirebaseStream data);
+    static void versionCallback(FirebaseStream data);
+    static void streamTimeoutCallback(bool timeout);
+    static void streamTimeoutCallback2(bool timeout);
+    void readData();
+    bool setJSONWithRetry(FirebaseData* fbdo, const String& path, FirebaseJson* json, int maxRetries, int delayMs);
+    bool updateNodeWithRetry(FirebaseData* fbdo, const String& path, FirebaseJson* json, int maxRetries, int delayMs);
+    // config/version is set to a new token (e.g. a server timestamp) by
+    // whatever writes config/sensors, with every change. When it matches
+    // the cached config only config/version is streamed; config/sensors,
+    // whose first event is the whole list, is streamed after a mismatch.
+    bool fetchCANPIDs();
+    void setConfigCache(PIDConfigCache* cache) { configCache = cache; }
+    bool firebaseConfigured = false;
+
+private:
+    static FirebaseHandler* instance;
+    FirebaseData fbdo;
+    FirebaseAuth auth;
+    FirebaseConfig config;
+    FirebaseJson json;
+    FirebaseData stream;
+    FirebaseData stream2;
+
+    // config/sensors: the first stream event loads sensors, later ones only
+    // re-parse the entries they touch. Stream callbacks only queue events,
+    // readData() applies them on the uplink task.
+    struct SensorsEvent {
+        String path;
+        String raw;
+        bool patch;
+    };
+    bool streamSensors();
+    String fetchConfigVersion(); // "" if config/version is not set
+    void applySensorsEvents();
+    bool onSensorsEvent(const String& path, const String& raw, bool patch);
+    void applySensors(const String& raw, bool replace);
+    // path is "<index>" or "<index>/<field>"; false if it names no entry
+    bool applySensorPath(const String& path, const String& raw, bool merge);
+    void applySensor(uint16_t index, const String& raw, bool merge);
+    static bool parseSensorIndex(const String& key, uint16_t& index);
+    static bool isSensorField(const String& field);
+    static void parseSensorFields(FirebaseJson& json, SensorConfig::Entry& entry);
+    // Publishes the sensors table if it changed and caches it under version
+    void publishSensors(const String& version);
+
+    String userPath;
+    String pidPath;
+    String configVersionPath;
+
+    SharedPIDTable& pidTables; // The fetched and streamed config is published here
+    PIDConfigCache* configCache = nullptr;
+    SensorConfig sensors;      // Uplink task only
+    std::atomic<bool> versionChanged{false};
+    std::mutex sensorsMutex;   // Guards the fields below, shared with the stream task
+    std::vector<SensorsEvent> sensorsEvents;
+    String cachedVersion;      // config/version of the cached config
+};
+
 #endif // FIREBASE_HANDLER_HPP
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef CAN_CONTROLLER_HPP
+#define CAN_CONTROLLER_HPP
+
+#include <stdint.h>
+
+#include "../CAN/CANFrame.hpp"
+
+// CAN controller as seen by CANHandler. Masks and filters take plain 11-bit
+// standard IDs; any chip specific register layout stays in the implementation.
+class CANController {
+public:
+    static constexpr uint8_t MASK_COUNT = 2;
+    static constexpr uint8_t FILTER_COUNT = 6;
+
+    // Controller error counters and flags (ISO 11898 fault confinement)
+    struct ErrorState {
+        uint8_t txErrors;   // TEC
+        uint8_t rxErrors;   // REC
+        bool errorWarning;  // A counter reached 96
+        bool errorPassive;  // A counter reached 128
+        bool busOff;        // TEC passed 255, the controller stopped sending
+        bool rxOverflow;    // Frames were lost since the last read, receive buffers full
+    };
+
+    virtual ~CANController() = default;
+
+    virtual bool begin() = 0; // 500 kbit/s, acceptance filtering enabled, normal mode
+    virtual bool setMask(uint8_t index, uint32_t mask) = 0;
+    virtual bool setFilter(uint8_t index, uint32_t id) = 0;
+    virtual bool send(uint32_t id, const uint8_t* data, uint8_t len) = 0;
+    // Fills id, len and data of the next received frame, false if none is waiting
+    virtual bool receive(CANFrame& frame) = 0;
+    // Reads and clears the overflow flag; false if the controller cannot report errors
+    virtual bool readErrorState(ErrorState& /*state*/) { return false; }
+};
+
+#endif // CAN_CONTROLLER_HPP
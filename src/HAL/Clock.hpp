@@ -0,0 +1,16 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <stdint.h>
+
+// Monotonic and wall clock time
+class Clock {
+public:
+    virtual ~Clock() = default;
+
+    virtual unsigned long millis() = 0;
+    virtual unsigned long micros() = 0;
+    virtual uint64_t epochMs() = 0; // 0 while the wall clock is not set
+};
+
+#endif // CLOCK_HPP
@@ -0,0 +1,15 @@
+#ifndef LOG_SINK_HPP
+#define LOG_SINK_HPP
+
+#include <Arduino.h>
+
+// Destination for formatted log lines ("[TYPE] [time] message"). The line
+// is only valid during the call, a sink that keeps it copies it.
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+
+    virtual void write(const char* line, size_t length) = 0;
+};
+
+#endif // LOG_SINK_HPP
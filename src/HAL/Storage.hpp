@@ -0,0 +1,23 @@
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+#include <functional>
+#include <stddef.h>
+
+// Flat namespace of small binary files on persistent storage
+class Storage {
+public:
+    virtual ~Storage() = default;
+
+    virtual bool begin() = 0;
+    virtual long size(const char* name) = 0; // -1 if the file does not exist
+    virtual size_t read(const char* name, size_t offset, void* data, size_t size) = 0;
+    virtual bool append(const char* name, const void* data, size_t size) = 0;
+    // Replaces the whole file; a power cut leaves either the old or the new content
+    virtual bool write(const char* name, const void* data, size_t size) = 0;
+    virtual bool truncate(const char* name, size_t size) = 0;
+    virtual bool remove(const char* name) = 0;
+    virtual void list(const std::function<void(const char* name)>& onFile) = 0;
+};
+
+#endif // STORAGE_HPP
@@ -0,0 +1,17 @@
+#ifndef UPLINK_HPP
+#define UPLINK_HPP
+
+#include <Arduino.h>
+
+// Network connection samples are uploaded over
+class Uplink {
+public:
+    virtual ~Uplink() = default;
+
+    virtual bool isReady() = 0;
+    // Merges a JSON object into node (relative to the device's data path),
+    // like an RTDB multi-path update. Returns true once the server accepted it.
+    virtual bool update(const char* node, const String& json) = 0;
+};
+
+#endif // UPLINK_HPP
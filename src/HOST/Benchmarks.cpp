@@ -0,0 +1,732 @@
+#include "Benchmarks.hpp"
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <new>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../CAN/CANHandler.hpp"
+#include "../CAN/IsoTpSession.hpp"
+#include "../CAN/PIDFormula.hpp"
+#include "../CAN/SensorConfig.hpp"
+#include "../CODEC/LogCodec.hpp"
+#include "../CODEC/SampleCodec.hpp"
+#include "../LOG/LogHandler.hpp"
+#include "../PROFILE/LoopProfiler.hpp"
+#include "../SETTINGS/SettingsHandler.hpp"
+#include "../STORAGE/FileStorage.hpp"
+#include "../STORAGE/JournalHandler.hpp"
+#include "../STORAGE/PIDConfigCache.hpp"
+#include "../UPLOAD/LogUploadHandler.hpp"
+#include "../UPLOAD/UploadHandler.hpp"
+#include "../UTILS/LineBuffer.hpp"
+#include "../UTILS/SPSCRing.hpp"
+#include "FakeCANController.hpp"
+#include "HostClock.hpp"
+#include "MemoryStorage.hpp"
+
+// Every heap allocation of the process goes through here. The host String
+// is std::string based (short strings stay inline), so counts for String
+// heavy paths are a lower bound of what the device does.
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+// Not inlined, or GCC pairs the free() with the builtin new and warns
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+size_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+namespace {
+
+constexpr double CALIBRATION_NS = 20e6;
+constexpr double TARGET_NS = 200e6;
+constexpr size_t MAX_ITERATIONS = 200000;
+constexpr size_t BATCH = 100; // Samples per upload / journal benchmark op
+
+struct Result {
+    std::string name;
+    size_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp; // Output size where the path produces a payload
+    std::vector<std::pair<std::string, double>> metrics; // Extra figures of the path
+};
+
+// Uplink that accepts everything without keeping it
+class NullUplink : public Uplink {
+public:
+    bool isReady() override { return online; }
+    bool update(const char*, const String&) override { return true; }
+    bool online = true;
+};
+
+volatile uint32_t blackHole; // Keeps results alive
+
+// The substitution evaluator formulas went through before they were compiled:
+// byte values replaced into the text, then matched against sscanf patterns.
+// Kept as the baseline for formula_evaluate.
+String legacyEvaluate(const String& text, const uint8_t* rxBuf) {
+    String formula = text;
+    formula.replace("B3", String(rxBuf[3]));
+    formula.replace("B4", String(rxBuf[4]));
+    formula.replace("B5", String(rxBuf[5]));
+    formula.replace("B6", String(rxBuf[6]));
+    formula.replace("B7", String(rxBuf[7]));
+    formula.replace("A", String(rxBuf[3]));
+    formula.replace("B", String(rxBuf[4]));
+    formula.replace("C", String(rxBuf[5]));
+    formula.replace("D", String(rxBuf[6]));
+
+    double result = 0.0;
+    bool evalOk = false;
+    if (formula.indexOf('*') != -1 && formula.indexOf('/') != -1 && formula.indexOf("100") != -1 && formula.indexOf("255") != -1) {
+        int a;
+        if (sscanf(formula.c_str(), "(%d * 100) / 255", &a) == 1) {
+            result = (a * 100.0) / 255.0;
+            evalOk = true;
+        }
+    } else if (formula.indexOf('*') != -1 && formula.indexOf('+') != -1 && formula.indexOf('/') != -1) {
+        int a, b, c;
+        if (sscanf(formula.c_str(), "((%d * 256) + %d) / %d", &a, &b, &c) == 3) {
+            result = ((a * 256) + b) / (double)c;
+            evalOk = true;
+        }
+    } else if (formula.indexOf('-') != -1) {
+        int a, b;
+        if (sscanf(formula.c_str(), "%d - %d", &a, &b) == 2) {
+            result = a - b;
+            evalOk = true;
+        }
+    } else if (formula.indexOf('/') != -1) {
+        int a, b;
+        if (sscanf(formula.c_str(), "%d / %d", &a, &b) == 2 && b != 0) {
+            result = a / (double)b;
+            evalOk = true;
+        }
+    } else if (formula.indexOf('+') != -1) {
+        int a, b;
+        if (sscanf(formula.c_str(), "%d + %d", &a, &b) == 2) {
+            result = a + b;
+            evalOk = true;
+        }
+    } else if (formula.indexOf('*') != -1) {
+        int a, b;
+        if (sscanf(formula.c_str(), "%d * %d", &a, &b) == 2) {
+            result = a * b;
+            evalOk = true;
+        }
+    } else {
+        result = atof(formula.c_str());
+        evalOk = true;
+    }
+    return evalOk ? String(result) : "Eval error: " + formula;
+}
+
+class NullLogSink : public LogSink {
+public:
+    void write(const char*, size_t length) override { blackHole = length; }
+};
+
+double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+class Runner {
+public:
+    explicit Runner(const char* filter) : filter(filter) {}
+
+    // body(n) runs the path n times; after() runs untimed after each call.
+    // Returns false if the filter skipped it.
+    bool run(const char* name, const std::function<void(size_t)>& body, double bytesPerOp = 0, const std::function<void()>& after = nullptr) {
+        if (filter && !strstr(name, filter)) return false;
+
+        body(1);
+        if (after) after();
+
+        // Grow the batch until it takes long enough to time reliably
+        size_t iterations = 1;
+        double ns = 0;
+        while (iterations < MAX_ITERATIONS) {
+            excludedNs = 0;
+            auto start = std::chrono::steady_clock::now();
+            body(iterations);
+            ns = elapsedNs(start) - excludedNs;
+            if (after) after();
+            if (ns >= CALIBRATION_NS) break;
+            iterations *= 2;
+        }
+        if (ns > 0 && ns < TARGET_NS) {
+            size_t scaled = (size_t)(iterations * (TARGET_NS / ns));
+            iterations = scaled < MAX_ITERATIONS ? scaled : MAX_ITERATIONS;
+        }
+        if (iterations == 0) iterations = 1;
+
+        excludedNs = 0;
+        excludedAllocations = 0;
+        size_t allocationsBefore = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        ns = elapsedNs(start) - excludedNs;
+        size_t allocated = allocationCount() - allocationsBefore - excludedAllocations;
+        if (after) after();
+
+        Result result = {name, iterations, ns / iterations, (double)allocated / iterations, bytesPerOp, {}};
+        printf("%-32s %10.1f ns/op %8.2f allocs/op", name, result.nsPerOp, result.allocsPerOp);
+        if (bytesPerOp > 0) printf(" %8.1f bytes/op", bytesPerOp);
+        printf("\n");
+        results.push_back(result);
+        return true;
+    }
+
+    // Runs setup inside a body without counting its time or allocations
+    void untimed(const std::function<void()>& setup) {
+        size_t allocationsBefore = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+        setup();
+        excludedNs += elapsedNs(start);
+        excludedAllocations += allocationCount() - allocationsBefore;
+    }
+
+    double lastAllocsPerOp() const { return results.empty() ? 0 : results.back().allocsPerOp; }
+    double lastNsPerOp() const { return results.empty() ? 0 : results.back().nsPerOp; }
+
+    // Attaches a figure to the result of the last run()
+    void metric(const char* key, double value) {
+        if (results.empty()) return;
+        printf("%-32s %10.2f %s\n", "", value, key);
+        results.back().metrics.emplace_back(key, value);
+    }
+
+    bool write(const char* path) const {
+        FILE* file = fopen(path, "w");
+        if (!file) return false;
+        fprintf(file, "{\n  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            fprintf(file, "    {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f",
+                    r.name.c_str(), r.iterations, r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+            for (const auto& metric : r.metrics) fprintf(file, ", \"%s\": %.3f", metric.first.c_str(), metric.second);
+            fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        fprintf(file, "  ]\n}\n");
+        return fclose(file) == 0;
+    }
+
+private:
+    const char* filter;
+    std::vector<Result> results;
+    double excludedNs = 0;
+    size_t excludedAllocations = 0;
+};
+
+uint32_t steadyMicros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct BurstStats {
+    size_t frames;
+    size_t dropped;
+    uint64_t latencyTotalUs; // Push -> pop
+    uint32_t latencyMaxUs;
+};
+
+// The receive path of CANHandler with an INT pin: a producer thread stands
+// in for the RX task and pushes bursts of frames at 500 kbit/s line rate,
+// the calling thread drains the ring like loop(), every drainPeriodUs
+// (0 = spinning). One op is one burst.
+BurstStats runRxBurst(size_t bursts, uint32_t drainPeriodUs) {
+    constexpr size_t BURST_FRAMES = 128;
+    constexpr uint32_t FRAME_US = 250;       // 8 byte frame at 500 kbit/s
+    constexpr uint32_t BURST_GAP_US = 10000; // Bus idle between bursts
+
+    SPSCRing<CANFrame, 64> ring; // CANHandler::RX_RING_SIZE
+    BurstStats stats = {bursts * BURST_FRAMES, 0, 0, 0};
+    std::atomic<bool> done{false};
+    std::thread producer([&]() {
+        CANFrame frame = {0x7E8, 0, 8, {0}};
+        uint32_t due = steadyMicros();
+        for (size_t i = 0; i < stats.frames; i++) {
+            while ((int32_t)(steadyMicros() - due) < 0) std::this_thread::yield();
+            frame.timestampUs = steadyMicros();
+            if (!ring.push(frame)) stats.dropped++;
+            due += (i + 1) % BURST_FRAMES == 0 ? BURST_GAP_US : FRAME_US;
+        }
+        done = true;
+    });
+
+    CANFrame frame;
+    size_t received = 0;
+    while (!done || !ring.empty()) {
+        while (ring.pop(frame)) {
+            uint32_t latency = steadyMicros() - frame.timestampUs;
+            stats.latencyTotalUs += latency;
+            if (latency > stats.latencyMaxUs) stats.latencyMaxUs = latency;
+            received++;
+        }
+        if (drainPeriodUs) {
+            std::this_thread::sleep_for(std::chrono::microseconds(drainPeriodUs));
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    blackHole = received;
+    return stats;
+}
+
+void addPID(PIDTable& pids, byte pid, const char* label, const char* formula) {
+    PIDConfig& config = pids.add(pid);
+    config.label = label;
+    config.formula = formula;
+    config.program.compile(formula);
+}
+
+// Answers the supported-PID discovery begin() starts: no VIN, PIDs 01 - 1F supported
+void completeDiscovery(CANHandler& canHandler, FakeCANController& controller, HostClock& clock) {
+    const uint8_t noVin[8] = {0x03, 0x7F, 0x09, 0x11, 0, 0, 0, 0};
+    const uint8_t bitmap[8] = {0x06, 0x41, 0x00, 0xFF, 0xFF, 0xFF, 0xFE, 0};
+    std::vector<SampleRecord> samples;
+    canHandler.sendRequests();
+    controller.inject(0x7E8, noVin, 8);
+    canHandler.handleResponses(samples);
+    clock.advance(100);
+    canHandler.sendRequests();
+    controller.inject(0x7E8, bitmap, 8);
+    canHandler.handleResponses(samples);
+    controller.takeSent();
+}
+
+// BATCH samples over four PIDs, 10 ms apart like a busy poll loop
+std::vector<TimedSample> makeBatch() {
+    static const uint8_t pids[] = {0x0C, 0x0D, 0x05, 0x10};
+    std::vector<TimedSample> batch(BATCH);
+    for (size_t i = 0; i < BATCH; i++) {
+        TimedSample& sample = batch[i];
+        sample = {};
+        sample.epochMs = 1700000000000ULL + i * 10;
+        sample.sample.timestampMs = i * 10;
+        sample.sample.ecuId = 0x7E8;
+        sample.sample.pid = pids[i % 4];
+        sample.sample.len = OBDPids::dataLength(sample.sample.pid);
+        sample.sample.data[0] = (uint8_t)(0x10 + i / 8);
+        sample.sample.data[1] = (uint8_t)(i * 7);
+    }
+    return batch;
+}
+
+} // namespace
+
+int runBenchmarks(const char* outputPath, const char* filter) {
+    HostClock& clock = HostClock::instance();
+    clock.setManual(1700000000000ULL);
+    clock.advance(1000);
+    SettingsHandler::setCanRequestInterval(100);
+    Runner runner(filter);
+
+    std::shared_ptr<PIDTable> pidTable = std::make_shared<PIDTable>();
+    addPID(*pidTable, 0x05, "Coolant", "A-40");
+    addPID(*pidTable, 0x0C, "RPM", "((A*256)+B)/4");
+    addPID(*pidTable, 0x0D, "Speed", "A");
+    addPID(*pidTable, 0x10, "MAF", "((A*256)+B)/100");
+    SharedPIDTable pidTables;
+    pidTables.publish(pidTable);
+
+    FakeCANController controller;
+    controller.setRxQueueSize(64);
+    CANHandler canHandler(controller, pidTables);
+    canHandler.begin();
+    completeDiscovery(canHandler, controller, clock);
+
+    const uint8_t rpmData[2] = {0x1A, 0xF8};
+    const uint8_t response[8] = {0x06, 0x41, 0x0C, 0x1A, 0xF8, 0x0D, 0x32, 0x00};
+    std::vector<SampleRecord> samples;
+    samples.reserve(64);
+
+    // Acquisition
+    PIDFormula formula;
+    formula.compile("((A*256)+B)/4");
+    runner.run("formula_evaluate", [&](size_t n) {
+        double value = 0;
+        for (size_t i = 0; i < n; i++) formula.evaluate(rpmData, 2, value);
+        blackHole = (uint32_t)value;
+    });
+    // Same formula and bytes through the old substitution path (full frame, A = rxBuf[3])
+    const String legacyFormula = "((A * 256) + B) / 4";
+    const uint8_t legacyFrame[8] = {0x04, 0x41, 0x0C, 0x1A, 0xF8, 0x00, 0x00, 0x00};
+    runner.run("formula_evaluate_legacy", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) blackHole = legacyEvaluate(legacyFormula, legacyFrame).length();
+    });
+    runner.run("convert_to_human_readable", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) blackHole = canHandler.convertToHumanReadable(0x0C, rpmData, 2).length();
+    });
+    runner.run("get_label_for_pid", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) blackHole = strlen(canHandler.getLabelForPID(0x0C));
+    });
+    runner.run("pid_table_find", [&](size_t n) {
+        static const uint8_t lookups[] = {0x05, 0x0C, 0x0D, 0x10, 0x42};
+        for (size_t i = 0; i < n; i++) blackHole += pidTable->find(lookups[i % 5]) != nullptr;
+    });
+
+    SPSCRing<CANFrame, 64> ring;
+    runner.run("spsc_ring_push_pop", [&](size_t n) {
+        CANFrame frame = {0x7E8, 0, 8, {0}};
+        for (size_t i = 0; i < n; i++) {
+            ring.push(frame);
+            ring.pop(frame);
+        }
+        blackHole = frame.id;
+    });
+
+    // Receive bursts through the RX ring: frames lost to a full ring and how
+    // long they waited, with loop() draining continuously, at a 10 ms tick
+    // and stalled for 25 ms (e.g. by an upload)
+    for (uint32_t drainPeriodUs : {0u, 10000u, 25000u}) {
+        BurstStats burst = {};
+        std::string name = "rx_ring_burst_drain_" + (drainPeriodUs ? std::to_string(drainPeriodUs / 1000) + "ms" : std::string("spin"));
+        if (runner.run(name.c_str(), [&](size_t n) { burst = runRxBurst(n, drainPeriodUs); })) {
+            size_t received = burst.frames - burst.dropped;
+            runner.metric("drop_rate", (double)burst.dropped / burst.frames);
+            runner.metric("latency_avg_us", received ? (double)burst.latencyTotalUs / received : 0);
+            runner.metric("latency_max_us", burst.latencyMaxUs);
+        }
+    }
+
+    // Cost of one instrumented stage: two clock reads and a bucket update
+    runner.run("profiler_scope", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            PROFILE_SCOPE(TELNET);
+        }
+    });
+
+    // Telnet client output: one log line in, drained in socket sized chunks
+    static LineBuffer<4096> lineBuffer;
+    const char* line = "[CAN] [2024-01-01 12:00:00] Request sent for PIDs: c, d";
+    size_t lineLength = strlen(line);
+    runner.run("line_buffer_push_drain", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            lineBuffer.push(line, lineLength);
+            const char* data;
+            size_t len;
+            while ((len = lineBuffer.peek(data)) > 0) lineBuffer.consume(len < 32 ? len : 32);
+        }
+    }, lineLength + 2);
+
+    // VIN response: First Frame + two Consecutive Frames
+    const uint8_t vinFrames[3][8] = {
+        {0x10, 0x14, 0x49, 0x02, 0x01, 'W', 'V', 'W'},
+        {0x21, 'Z', 'Z', 'Z', '1', 'J', 'Z', 'X'},
+        {0x22, 'W', '0', '0', '0', '0', '0', '1'},
+    };
+    IsoTpSession session;
+    session.configure(0, 0);
+    runner.run("isotp_reassemble_20_bytes", [&](size_t n) {
+        uint8_t flowControl[8];
+        for (size_t i = 0; i < n; i++) {
+            for (const auto& frame : vinFrames) session.onFrame(frame, 8, 0, flowControl);
+        }
+        blackHole = session.payloadLength();
+    });
+
+    if (runner.run("handle_response_2_pids", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                controller.inject(0x7E8, response, 8);
+                canHandler.handleResponses(samples);
+                samples.clear();
+            }
+        })) {
+        runner.metric("allocs_per_sample", runner.lastAllocsPerOp() / 2);
+    }
+    // Baseline: the same frames, then what the String based path did per
+    // sample before raw records (label, decoded value, log line, String pair)
+    struct StringResponse {
+        String pid;
+        String value;
+    };
+    std::vector<StringResponse> stringResults;
+    stringResults.reserve(64);
+    if (runner.run("handle_response_2_pids_strings", [&](size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                controller.inject(0x7E8, response, 8);
+                canHandler.handleResponses(samples);
+                for (const SampleRecord& sample : samples) {
+                    String label = canHandler.getLabelForPID(sample.pid);
+                    String value = canHandler.convertToHumanReadable(sample.pid, sample.data, sample.len);
+                    String line = String("Received Response: ") + label + " -> " + value;
+                    blackHole = line.length();
+                    stringResults.push_back({label, value});
+                }
+                samples.clear();
+                stringResults.clear();
+            }
+        })) {
+        runner.metric("allocs_per_sample", runner.lastAllocsPerOp() / 2);
+    }
+    runner.run("request_response_cycle", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            clock.advance(100);
+            canHandler.sendRequests();
+            controller.inject(0x7E8, response, 8);
+            canHandler.handleResponses(samples);
+            samples.clear();
+        }
+    }, 0, [&]() { controller.takeSent(); });
+
+    // Upload
+    NullUplink uplink;
+    UploadHandler uploadHandler(uplink, clock, pidTables);
+    SettingsHandler::setUploadBatchSize(BATCH);
+    std::vector<SampleRecord> one(1, makeBatch()[0].sample);
+    runner.run("upload_add_data_and_send", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            uploadHandler.addData(one);
+            if (uploadHandler.getPendingSamples() >= BATCH) uploadHandler.sendData();
+        }
+    });
+
+    NullUplink offline;
+    offline.online = false;
+    UploadHandler offlineHandler(offline, clock, pidTables);
+    runner.run("upload_add_data_offline_full", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) offlineHandler.addData(one);
+    });
+
+    std::vector<TimedSample> batch = makeBatch();
+    String json;
+    uploadHandler.buildJson(batch.data(), batch.size(), json);
+    runner.run("upload_build_json_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) uploadHandler.buildJson(batch.data(), batch.size(), json);
+    }, json.length());
+    uploadHandler.buildCompact(batch.data(), batch.size(), json);
+    runner.run("upload_build_compact_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) uploadHandler.buildCompact(batch.data(), batch.size(), json);
+    }, json.length());
+
+    std::vector<uint8_t> encoded(4096);
+    size_t encodedSize = SampleCodec::encode(batch.data(), batch.size(), encoded.data(), encoded.size());
+    runner.run("codec_encode_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) blackHole = SampleCodec::encode(batch.data(), batch.size(), encoded.data(), encoded.size());
+    }, encodedSize);
+    runner.run("codec_decode_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            SampleCodec::decode(encoded.data(), encodedSize, [](const TimedSample& sample) { blackHole = sample.sample.pid; });
+        }
+    });
+
+    // Logging: the drain task's share is included by flushing every
+    // OUTPUT_QUEUE_SIZE messages
+    static NullLogSink sink;
+    LogHandler::addSink(&sink);
+    String message = "Request sent for PIDs: c (RPM), d (Speed)";
+    SettingsHandler::setEnableLogs(false);
+    runner.run("log_write_and_drain", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            LogHandler::writeMessage(LogHandler::DebugType::CAN, message);
+            if (i % LogHandler::OUTPUT_QUEUE_SIZE == LogHandler::OUTPUT_QUEUE_SIZE - 1) LogHandler::flush();
+        }
+    }, 0, []() { LogHandler::flush(); });
+    SettingsHandler::setEnableLogs(true);
+    runner.run("log_write_upload_enabled", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            LogHandler::writeMessage(LogHandler::DebugType::CAN, message);
+            if (i % LogHandler::OUTPUT_QUEUE_SIZE == LogHandler::OUTPUT_QUEUE_SIZE - 1) {
+                LogHandler::flush();
+                LogHandler::getAndClearLogs();
+            }
+        }
+    }, 0, []() {
+        LogHandler::flush();
+        LogHandler::getAndClearLogs();
+    });
+    SettingsHandler::setEnableLogs(false);
+
+    // Level filtered: the message is never built
+    String label = "RPM";
+    SettingsHandler::setLogLevel(SettingsHandler::LOG_LEVEL_INFO);
+    runner.run("log_message_filtered", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            LOG_MESSAGE(LogHandler::DebugType::CAN, String("Request sent for PIDs: ") + String(0x0C, HEX) + " (" + label + ")");
+        }
+    });
+    SettingsHandler::setLogLevel(SettingsHandler::DEFAULT_LOG_LEVEL);
+
+    // Request sent message as text (built like describePendingPids()) vs
+    // binary record. The write is what the CAN task pays, the drain runs
+    // on the log task; each is timed without the other. bytes/op is the
+    // queue entry.
+    const byte pids[] = {0x0C, 0x0D};
+    auto writeRequestText = [&]() {
+        String description;
+        for (byte p = 0; p < 2; p++) {
+            if (p > 0) description += ", ";
+            description += String(pids[p], HEX) + " (" + canHandler.getLabelForPID(pids[p]) + ")";
+        }
+        LOG_MESSAGE(LogHandler::DebugType::CAN, String("Request sent for PIDs: ") + description);
+    };
+    auto writeRequestBinary = [&]() {
+        uint32_t first, second;
+        LogHandler::packPids(pids, 2, first, second);
+        LogHandler::writeBinary(LogFormat::CAN_REQUEST_SENT, first, second);
+    };
+    // The queue is drained untimed before it fills, so no write is a drop
+    auto writeOnly = [&](size_t n, size_t queueSize, const std::function<void()>& write) {
+        for (size_t i = 0; i < n; i++) {
+            write();
+            if (i % queueSize == queueSize - 1) runner.untimed([]() { LogHandler::flush(); });
+        }
+    };
+    // Fills the queue untimed, times the flush; ns/op is per drained message
+    auto drainOnly = [&](size_t n, size_t queueSize, const std::function<void()>& write) {
+        for (size_t done = 0; done < n; done += queueSize) {
+            size_t count = n - done < queueSize ? n - done : queueSize;
+            runner.untimed([&]() {
+                for (size_t i = 0; i < count; i++) write();
+            });
+            LogHandler::flush();
+        }
+    };
+    runner.run("log_request_text_write", [&](size_t n) {
+        writeOnly(n, LogHandler::OUTPUT_QUEUE_SIZE, writeRequestText);
+    }, sizeof(LogHandler::LogRecord), []() { LogHandler::flush(); });
+    double textWriteNs = runner.lastNsPerOp();
+    if (runner.run("log_request_binary_write", [&](size_t n) {
+        writeOnly(n, LogHandler::BINARY_QUEUE_SIZE, writeRequestBinary);
+    }, sizeof(BinaryLogRecord), []() { LogHandler::flush(); }) && textWriteNs > 0) {
+        runner.metric("x_faster_than_text_write", textWriteNs / runner.lastNsPerOp());
+    }
+    runner.run("log_request_text_drain", [&](size_t n) {
+        drainOnly(n, LogHandler::OUTPUT_QUEUE_SIZE, writeRequestText);
+    });
+    runner.run("log_request_binary_drain", [&](size_t n) {
+        drainOnly(n, LogHandler::BINARY_QUEUE_SIZE, writeRequestBinary);
+    });
+
+    std::vector<BinaryLogRecord> records(LogHandler::BINARY_QUEUE_SIZE);
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i] = {(uint32_t)(60000 + i * 100), (uint16_t)LogFormat::CAN_REQUEST_SENT, 2, {0x0D0C02, 0, 0, 0}};
+    }
+    std::vector<uint8_t> packedLogs(2048);
+    size_t packedLogSize = LogCodec::encode(records.data(), records.size(), 1700000000000ULL, packedLogs.data(), packedLogs.size());
+    runner.run("logcodec_encode_64", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) blackHole = LogCodec::encode(records.data(), records.size(), 1700000000000ULL, packedLogs.data(), packedLogs.size());
+    }, packedLogSize);
+
+    std::vector<LogHandler::LogEntry> entries;
+    for (size_t i = 0; i < BATCH; i++) {
+        entries.push_back({i % 2 ? "can" : "", (long)(1700000000 + i / 10), message});
+    }
+    runner.run("log_group_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            std::map<String, std::map<long, String>> grouped;
+            LogHandler::groupLogs(entries, grouped);
+            blackHole = grouped.size();
+        }
+    });
+
+    // One log flush: the upload queue full of text messages, grouped and
+    // serialized into a single update
+    LogUploadHandler logUploader(uplink, clock);
+    SettingsHandler::setEnableLogs(true);
+    runner.run("log_flush_64", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t m = 0; m < LogHandler::UPLOAD_QUEUE_SIZE; m++) LogHandler::writeMessage(LogHandler::DebugType::CAN, message);
+            LogHandler::flush();
+            clock.advance(LogUploadHandler::FLUSH_INTERVAL_MS);
+            logUploader.flush();
+        }
+    }, 0);
+    SettingsHandler::setEnableLogs(false);
+
+    // Journal on files in a temporary directory, the host stand-in for the
+    // LittleFS partition
+    char journalDir[] = "/tmp/obd-journal-XXXXXX";
+    if (!mkdtemp(journalDir)) {
+        fprintf(stderr, "Cannot create a journal directory\n");
+        return 1;
+    }
+    FileStorage storage(journalDir);
+    storage.begin();
+    JournalHandler journal(storage, 16);
+    journal.begin();
+    std::vector<TimedSample> readBack(BATCH);
+    runner.run("journal_append_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) journal.append(batch.data(), batch.size());
+    }, BATCH * sizeof(TimedSample));
+    runner.run("journal_append_replay_100", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            journal.append(batch.data(), batch.size());
+            size_t remaining = BATCH;
+            while (remaining > 0) {
+                size_t count = journal.read(readBack.data(), remaining);
+                if (count == 0) break;
+                journal.acknowledge(count);
+                remaining -= count;
+            }
+        }
+    }, BATCH * sizeof(TimedSample));
+    std::vector<std::string> journalFiles;
+    storage.list([&](const char* name) { journalFiles.push_back(name); });
+    for (const std::string& name : journalFiles) storage.remove(name.c_str());
+    rmdir(journalDir);
+
+    // Warm boot: the cached config decoded and its formulas compiled
+    PIDTable bootTable;
+    for (uint8_t pid = 0x04; pid < 0x04 + 20; pid++) addPID(bootTable, pid, "Sensor", "((A*256)+B)/4");
+    MemoryStorage configStorage;
+    PIDConfigCache configCache(configStorage);
+    configCache.save(bootTable, "1");
+    runner.run("pid_config_cache_load_20", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            PIDTable table;
+            configCache.load(table);
+            blackHole = table.size();
+        }
+    });
+
+    // One streamed field change against a 20 entry config, swapped in
+    SensorConfig sensors;
+    for (uint16_t i = 0; i < SensorConfig::MAX_SENSORS; i++) {
+        SensorConfig::Entry entry;
+        entry.enabled = true;
+        entry.pid = 0x04 + i;
+        entry.label = "Sensor";
+        entry.formula = "((A*256)+B)/4";
+        sensors.set(i, entry);
+    }
+    std::shared_ptr<const PIDTable> activeTable = sensors.buildTable(PIDTable());
+    runner.run("sensor_config_delta_20", [&](size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            sensors.find(5)->rate = (i & 1) ? 10 : 5;
+            std::shared_ptr<const PIDTable> next = sensors.buildTable(*activeTable);
+            if (next) activeTable = next;
+            blackHole = activeTable->size();
+        }
+    });
+
+    if (!runner.write(outputPath)) {
+        fprintf(stderr, "Cannot write %s\n", outputPath);
+        return 1;
+    }
+    printf("Results written to %s\n", outputPath);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include <stddef.h>
+
+// Microbenchmarks of the hot paths on the host: ns/op and heap
+// allocations/op, written as JSON to outputPath. Only benchmarks whose name
+// contains filter run (nullptr = all).
+int runBenchmarks(const char* outputPath, const char* filter);
+
+// Heap allocations made by this process so far (counted by the replaced
+// global operator new)
+size_t allocationCount();
+
+#endif // BENCHMARKS_HPP
@@ -0,0 +1,115 @@
+#include "FakeCANController.hpp"
+
+#include <string.h>
+
+bool FakeCANController::begin() {
+    std::lock_guard<std::mutex> lock(mutex);
+    rxQueue.clear();
+    sentFrames.clear();
+    return true;
+}
+
+bool FakeCANController::setMask(uint8_t index, uint32_t mask) {
+    if (index >= MASK_COUNT) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    masks[index] = mask & 0x7FF;
+    return true;
+}
+
+bool FakeCANController::setFilter(uint8_t index, uint32_t id) {
+    if (index >= FILTER_COUNT) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    filters[index] = id & 0x7FF;
+    return true;
+}
+
+bool FakeCANController::send(uint32_t id, const uint8_t* data, uint8_t len) {
+    if (len > 8) return false;
+    CANFrame frame = {};
+    frame.id = id;
+    frame.len = len;
+    memcpy(frame.data, data, len);
+    std::function<void(const CANFrame&)> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sentFrames.push_back(frame);
+        stats.sent++;
+        callback = transmitCallback;
+    }
+    // Outside the lock, the callback usually injects the answer
+    if (callback) callback(frame);
+    return true;
+}
+
+bool FakeCANController::receive(CANFrame& frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (rxQueue.empty()) return false;
+    frame = rxQueue.front();
+    rxQueue.pop_front();
+    return true;
+}
+
+bool FakeCANController::inject(uint32_t id, const uint8_t* data, uint8_t len) {
+    if (len > 8) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.injected++;
+    if (!accepts(id)) {
+        stats.filtered++;
+        return false;
+    }
+    if (rxQueue.size() >= rxQueueSize) {
+        stats.overflows++;
+        return false;
+    }
+    CANFrame frame = {};
+    frame.id = id;
+    frame.len = len;
+    memcpy(frame.data, data, len);
+    rxQueue.push_back(frame);
+    return true;
+}
+
+std::vector<CANFrame> FakeCANController::takeSent() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<CANFrame> frames;
+    frames.swap(sentFrames);
+    return frames;
+}
+
+size_t FakeCANController::rxPending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rxQueue.size();
+}
+
+bool FakeCANController::readErrorState(ErrorState& state) {
+    std::lock_guard<std::mutex> lock(mutex);
+    state.txErrors = txErrors;
+    state.rxErrors = rxErrors;
+    state.errorWarning = txErrors >= 96 || rxErrors >= 96;
+    state.errorPassive = txErrors >= 128 || rxErrors >= 128;
+    state.busOff = false;
+    state.rxOverflow = stats.overflows != reportedOverflows;
+    reportedOverflows = stats.overflows;
+    return true;
+}
+
+void FakeCANController::setErrorCounters(uint8_t tec, uint8_t rec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    txErrors = tec;
+    rxErrors = rec;
+}
+
+FakeCANController::Stats FakeCANController::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+bool FakeCANController::accepts(uint32_t id) const {
+    // MCP2515: RXB0 uses mask 0 with filters 0-1, RXB1 mask 1 with filters 2-5
+    if (masks[0] == 0 || masks[1] == 0) return true;
+    for (uint8_t i = 0; i < FILTER_COUNT; i++) {
+        uint32_t mask = i < 2 ? masks[0] : masks[1];
+        if ((id & mask) == (filters[i] & mask)) return true;
+    }
+    return false;
+}
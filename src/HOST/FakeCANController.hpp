@@ -0,0 +1,61 @@
+#ifndef FAKE_CAN_CONTROLLER_HPP
+#define FAKE_CAN_CONTROLLER_HPP
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "../HAL/CANController.hpp"
+
+// In-memory CAN controller. Sent frames are recorded (and passed to the
+// transmit callback, where a simulated ECU can answer), injected frames go
+// through the same mask/filter match as the MCP2515 before they can be
+// received.
+class FakeCANController : public CANController {
+public:
+    struct Stats {
+        unsigned long sent;
+        unsigned long injected;
+        unsigned long filtered; // Injected frames rejected by the acceptance filters
+        unsigned long overflows; // Injected frames lost because the RX queue was full
+    };
+
+    static constexpr size_t RX_QUEUE_SIZE = 2; // Receive buffers of the MCP2515
+
+    bool begin() override;
+    bool setMask(uint8_t index, uint32_t mask) override;
+    bool setFilter(uint8_t index, uint32_t id) override;
+    bool send(uint32_t id, const uint8_t* data, uint8_t len) override;
+    bool receive(CANFrame& frame) override;
+    bool readErrorState(ErrorState& state) override; // Overflow like the MCP2515, counters from setErrorCounters()
+
+    // Queues a frame as if it arrived on the bus; false if filtered or dropped
+    bool inject(uint32_t id, const uint8_t* data, uint8_t len);
+    void setTransmitCallback(std::function<void(const CANFrame&)> callback) { transmitCallback = callback; }
+    // Allows more buffered frames than the real controller, e.g. when the
+    // receiving side is not polled while frames are injected
+    void setRxQueueSize(size_t size) { rxQueueSize = size; }
+
+    std::vector<CANFrame> takeSent();
+    void setErrorCounters(uint8_t tec, uint8_t rec);
+    size_t rxPending();
+    Stats getStats();
+
+private:
+    bool accepts(uint32_t id) const;
+
+    std::mutex mutex;
+    std::deque<CANFrame> rxQueue;
+    std::vector<CANFrame> sentFrames;
+    std::function<void(const CANFrame&)> transmitCallback;
+    size_t rxQueueSize = RX_QUEUE_SIZE;
+    uint32_t masks[MASK_COUNT] = {0, 0};
+    uint32_t filters[FILTER_COUNT] = {0};
+    Stats stats = {};
+    unsigned long reportedOverflows = 0;
+    uint8_t txErrors = 0;
+    uint8_t rxErrors = 0;
+};
+
+#endif // FAKE_CAN_CONTROLLER_HPP
@@ -0,0 +1,10 @@
+#include "FakeUplink.hpp"
+
+bool FakeUplink::update(const char* node, const String& json) {
+    if (!online || failing) {
+        rejected++;
+        return false;
+    }
+    updates.push_back({node, json.c_str()});
+    return true;
+}
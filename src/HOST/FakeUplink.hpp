@@ -0,0 +1,34 @@
+#ifndef FAKE_UPLINK_HPP
+#define FAKE_UPLINK_HPP
+
+#include <string>
+#include <vector>
+
+#include "../HAL/Uplink.hpp"
+
+// Uplink that keeps every accepted update in memory
+class FakeUplink : public Uplink {
+public:
+    struct Update {
+        std::string node;
+        std::string json;
+    };
+
+    bool isReady() override { return online; }
+    bool update(const char* node, const String& json) override;
+
+    void setOnline(bool value) { online = value; }
+    void setFailing(bool value) { failing = value; } // Ready, but every update is rejected
+
+    const std::vector<Update>& getUpdates() const { return updates; }
+    void clear() { updates.clear(); }
+    unsigned long getRejected() const { return rejected; }
+
+private:
+    bool online = true;
+    bool failing = false;
+    std::vector<Update> updates;
+    unsigned long rejected = 0;
+};
+
+#endif // FAKE_UPLINK_HPP
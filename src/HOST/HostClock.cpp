@@ -0,0 +1,50 @@
+#include "HostClock.hpp"
+
+#include <thread>
+
+HostClock::HostClock() : start(std::chrono::steady_clock::now()) {}
+
+HostClock& HostClock::instance() {
+    static HostClock clock;
+    return clock;
+}
+
+unsigned long HostClock::millis() {
+    return (unsigned long)(micros64() / 1000);
+}
+
+unsigned long HostClock::micros() {
+    return (unsigned long)micros64();
+}
+
+uint64_t HostClock::epochMs() {
+    if (manual) return manualEpochMs ? manualEpochMs + manualUs / 1000 : 0;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void HostClock::setManual(uint64_t epochStartMs) {
+    manualUs = micros64();
+    manualEpochMs = epochStartMs ? epochStartMs - manualUs / 1000 : 0;
+    manual = true;
+}
+
+void HostClock::advance(unsigned long ms) {
+    manualUs += (uint64_t)ms * 1000;
+}
+
+void HostClock::advanceUs(unsigned long us) {
+    manualUs += us;
+}
+
+void HostClock::sleep(unsigned long ms) {
+    if (manual) {
+        advance(ms);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+uint64_t HostClock::micros64() {
+    if (manual) return manualUs;
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,37 @@
+#ifndef HOST_CLOCK_HPP
+#define HOST_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+
+#include "../HAL/Clock.hpp"
+
+// Clock for the native build. In real mode it follows the host clocks, in
+// manual mode time only moves through advance() (and delay()), so runs are
+// reproducible. millis()/micros() of the Arduino shim read this instance.
+class HostClock : public Clock {
+public:
+    static HostClock& instance();
+
+    unsigned long millis() override;
+    unsigned long micros() override;
+    uint64_t epochMs() override;
+
+    // Switches to manual time starting at the given wall clock (0 = not set)
+    void setManual(uint64_t epochStartMs);
+    bool isManual() const { return manual; }
+    void advance(unsigned long ms);
+    void advanceUs(unsigned long us);
+    void sleep(unsigned long ms); // Advances manual time, sleeps in real mode
+
+private:
+    HostClock();
+    uint64_t micros64();
+
+    std::chrono::steady_clock::time_point start;
+    std::atomic<bool> manual{false};
+    std::atomic<uint64_t> manualUs{0};
+    uint64_t manualEpochMs = 0;
+};
+
+#endif // HOST_CLOCK_HPP
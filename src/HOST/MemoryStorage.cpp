@@ -0,0 +1,62 @@
+#include "MemoryStorage.hpp"
+
+#include <string.h>
+
+long MemoryStorage::size(const char* name) {
+    auto it = files.find(name);
+    return it == files.end() ? -1 : (long)it->second.size();
+}
+
+size_t MemoryStorage::read(const char* name, size_t offset, void* data, size_t size) {
+    auto it = files.find(name);
+    if (it == files.end() || offset >= it->second.size()) return 0;
+    size_t count = it->second.size() - offset;
+    if (count > size) count = size;
+    memcpy(data, it->second.data() + offset, count);
+    return count;
+}
+
+bool MemoryStorage::append(const char* name, const void* data, size_t size) {
+    size_t count = size;
+    if (writeBudget >= 0 && (long)count > writeBudget) count = writeBudget;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    std::vector<uint8_t>& file = files[name];
+    file.insert(file.end(), bytes, bytes + count);
+    if (writeBudget >= 0) writeBudget -= count;
+    return count == size;
+}
+
+bool MemoryStorage::write(const char* name, const void* data, size_t size) {
+    // Atomic: either the whole new content or the old one
+    if (writeBudget >= 0) {
+        if ((long)size > writeBudget) return false;
+        writeBudget -= size;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    files[name].assign(bytes, bytes + size);
+    return true;
+}
+
+bool MemoryStorage::truncate(const char* name, size_t size) {
+    auto it = files.find(name);
+    if (it == files.end()) return false;
+    if (size < it->second.size()) it->second.resize(size);
+    return true;
+}
+
+bool MemoryStorage::remove(const char* name) {
+    return files.erase(name) > 0;
+}
+
+void MemoryStorage::list(const std::function<void(const char* name)>& onFile) {
+    // Copy the names, the callback may remove files
+    std::vector<std::string> names;
+    for (const auto& file : files) names.push_back(file.first);
+    for (const std::string& name : names) onFile(name.c_str());
+}
+
+size_t MemoryStorage::totalBytes() const {
+    size_t total = 0;
+    for (const auto& file : files) total += file.second.size();
+    return total;
+}
@@ -0,0 +1,32 @@
+#ifndef MEMORY_STORAGE_HPP
+#define MEMORY_STORAGE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../HAL/Storage.hpp"
+
+// Storage kept in RAM. failAfter() makes writes fail once a byte budget is
+// used up, appending only the part that still fits, like a power cut or a
+// full partition in the middle of a write.
+class MemoryStorage : public Storage {
+public:
+    bool begin() override { return true; }
+    long size(const char* name) override;
+    size_t read(const char* name, size_t offset, void* data, size_t size) override;
+    bool append(const char* name, const void* data, size_t size) override;
+    bool write(const char* name, const void* data, size_t size) override;
+    bool truncate(const char* name, size_t size) override;
+    bool remove(const char* name) override;
+    void list(const std::function<void(const char* name)>& onFile) override;
+
+    void failAfter(long bytes) { writeBudget = bytes; } // -1 disables failures
+    size_t totalBytes() const;
+
+private:
+    std::map<std::string, std::vector<uint8_t>> files;
+    long writeBudget = -1;
+};
+
+#endif // MEMORY_STORAGE_HPP
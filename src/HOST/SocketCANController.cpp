@@ -0,0 +1,113 @@
+#include "SocketCANController.hpp"
+
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+SocketCANController::SocketCANController(const char* interfaceName) : interfaceName(interfaceName) {}
+
+#ifdef __linux__
+
+SocketCANController::~SocketCANController() {
+    if (socketFd >= 0) close(socketFd);
+}
+
+bool SocketCANController::begin() {
+    if (socketFd >= 0) close(socketFd);
+    socketFd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (socketFd < 0) return false;
+
+    struct ifreq ifr = {};
+    strncpy(ifr.ifr_name, interfaceName, IFNAMSIZ - 1);
+    if (ioctl(socketFd, SIOCGIFINDEX, &ifr) < 0) {
+        close(socketFd);
+        socketFd = -1;
+        return false;
+    }
+
+    struct sockaddr_can address = {};
+    address.can_family = AF_CAN;
+    address.can_ifindex = ifr.ifr_ifindex;
+    if (bind(socketFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(socketFd);
+        socketFd = -1;
+        return false;
+    }
+
+    fcntl(socketFd, F_SETFL, O_NONBLOCK);
+    return applyFilters();
+}
+
+bool SocketCANController::setMask(uint8_t index, uint32_t mask) {
+    if (index >= MASK_COUNT) return false;
+    masks[index] = mask & CAN_SFF_MASK;
+    return applyFilters();
+}
+
+bool SocketCANController::setFilter(uint8_t index, uint32_t id) {
+    if (index >= FILTER_COUNT) return false;
+    filters[index] = id & CAN_SFF_MASK;
+    return applyFilters();
+}
+
+bool SocketCANController::applyFilters() {
+    if (socketFd < 0) return true; // Applied by begin()
+
+    // Same acceptance as the MCP2515: a cleared mask lets everything through
+    struct can_filter rules[FILTER_COUNT];
+    size_t count = 0;
+    if (masks[0] != 0 && masks[1] != 0) {
+        for (uint8_t i = 0; i < FILTER_COUNT; i++) {
+            rules[count].can_id = filters[i];
+            rules[count].can_mask = (i < 2 ? masks[0] : masks[1]) | CAN_EFF_FLAG | CAN_RTR_FLAG;
+            count++;
+        }
+    } else {
+        rules[count].can_id = 0;
+        rules[count].can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG;
+        count++;
+    }
+    return setsockopt(socketFd, SOL_CAN_RAW, CAN_RAW_FILTER, rules, count * sizeof(rules[0])) == 0;
+}
+
+bool SocketCANController::send(uint32_t id, const uint8_t* data, uint8_t len) {
+    if (socketFd < 0 || len > 8) return false;
+    struct can_frame frame = {};
+    frame.can_id = id & CAN_SFF_MASK;
+    frame.can_dlc = len;
+    memcpy(frame.data, data, len);
+    return write(socketFd, &frame, sizeof(frame)) == sizeof(frame);
+}
+
+bool SocketCANController::receive(CANFrame& frame) {
+    if (socketFd < 0) return false;
+    struct can_frame raw;
+    while (read(socketFd, &raw, sizeof(raw)) == sizeof(raw)) {
+        if (raw.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) continue;
+        frame.id = raw.can_id & CAN_SFF_MASK;
+        frame.len = raw.can_dlc > 8 ? 8 : raw.can_dlc;
+        memcpy(frame.data, raw.data, frame.len);
+        return true;
+    }
+    return false;
+}
+
+#else
+
+SocketCANController::~SocketCANController() {}
+bool SocketCANController::begin() { return false; }
+bool SocketCANController::setMask(uint8_t, uint32_t) { return false; }
+bool SocketCANController::setFilter(uint8_t, uint32_t) { return false; }
+bool SocketCANController::applyFilters() { return false; }
+bool SocketCANController::send(uint32_t, const uint8_t*, uint8_t) { return false; }
+bool SocketCANController::receive(CANFrame&) { return false; }
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SOCKET_CAN_CONTROLLER_HPP
+#define SOCKET_CAN_CONTROLLER_HPP
+
+#include "../HAL/CANController.hpp"
+
+// CAN controller on a Linux SocketCAN interface (e.g. a vcan device), so the
+// handler and the simulated ECUs can run in separate processes or against
+// a USB CAN adapter. Masks and filters are mirrored into CAN_RAW_FILTER.
+// Other hosts get a controller whose begin() fails.
+class SocketCANController : public CANController {
+public:
+    explicit SocketCANController(const char* interfaceName);
+    ~SocketCANController() override;
+
+    bool begin() override;
+    bool setMask(uint8_t index, uint32_t mask) override;
+    bool setFilter(uint8_t index, uint32_t id) override;
+    bool send(uint32_t id, const uint8_t* data, uint8_t len) override;
+    bool receive(CANFrame& frame) override;
+
+private:
+    bool applyFilters();
+
+    const char* interfaceName;
+    int socketFd = -1;
+    uint32_t masks[MASK_COUNT] = {0, 0};
+    uint32_t filters[FILTER_COUNT] = {0};
+};
+
+#endif // SOCKET_CAN_CONTROLLER_HPP
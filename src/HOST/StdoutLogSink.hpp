@@ -0,0 +1,13 @@
+#ifndef STDOUT_LOG_SINK_HPP
+#define STDOUT_LOG_SINK_HPP
+
+#include <stdio.h>
+
+#include "../HAL/LogSink.hpp"
+
+class StdoutLogSink : public LogSink {
+public:
+    void write(const char* line, size_t) override { puts(line); }
+};
+
+#endif // STDOUT_LOG_SINK_HPP
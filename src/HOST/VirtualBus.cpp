@@ -0,0 +1,38 @@
+#include "VirtualBus.hpp"
+
+VirtualBus::VirtualBus(FakeCANController& controller) : controller(controller) {
+    // Requests from the handler reach every ECU once they are on the wire
+    controller.setTransmitCallback([this](const CANFrame& frame) {
+        uint64_t doneUs = (busFreeUs > this->nowUs ? busFreeUs : this->nowUs) + FRAME_TIME_US;
+        busFreeUs = doneUs;
+        for (VirtualECU& ecu : ecus) ecu.onFrame(frame, doneUs);
+    });
+}
+
+VirtualECU& VirtualBus::addECU(const VirtualECU::Config& config) {
+    ecus.emplace_back(config, [this](const CANFrame& frame) { schedule(frame, nowUs); });
+    return ecus.back();
+}
+
+void VirtualBus::update(uint64_t nowUs) {
+    this->nowUs = nowUs;
+    for (VirtualECU& ecu : ecus) ecu.update(nowUs);
+
+    while (!inFlight.empty() && inFlight.front().doneUs <= nowUs) {
+        const CANFrame& frame = inFlight.front().frame;
+        if (!controller.inject(frame.id, frame.data, frame.len)) lostFrames++;
+        inFlight.pop_front();
+    }
+}
+
+std::vector<VirtualECU*> VirtualBus::getECUs() {
+    std::vector<VirtualECU*> result;
+    for (VirtualECU& ecu : ecus) result.push_back(&ecu);
+    return result;
+}
+
+void VirtualBus::schedule(const CANFrame& frame, uint64_t nowUs) {
+    uint64_t doneUs = (busFreeUs > nowUs ? busFreeUs : nowUs) + FRAME_TIME_US;
+    busFreeUs = doneUs;
+    inFlight.push_back({doneUs, frame});
+}
@@ -0,0 +1,44 @@
+#ifndef VIRTUAL_BUS_HPP
+#define VIRTUAL_BUS_HPP
+
+#include <deque>
+#include <vector>
+
+#include "FakeCANController.hpp"
+#include "VirtualECU.hpp"
+
+// Connects a FakeCANController to simulated ECUs. Frames are delivered in
+// transmit order and occupy the bus for the time an 8 byte standard frame
+// takes at 500 kbit/s, so bursts of consecutive frames reach the controller
+// at a realistic rate.
+class VirtualBus {
+public:
+    static constexpr unsigned long FRAME_TIME_US = 222; // 111 bits incl. stuffing at 500 kbit/s
+
+    explicit VirtualBus(FakeCANController& controller);
+
+    // Creates an ECU on the bus; the bus owns it
+    VirtualECU& addECU(const VirtualECU::Config& config);
+    // Runs the ECUs and delivers the frames that finished transmitting by nowUs
+    void update(uint64_t nowUs);
+
+    std::vector<VirtualECU*> getECUs();
+    unsigned long getLostFrames() const { return lostFrames; } // Rejected by the controller (filtered or RX overflow)
+
+private:
+    struct InFlight {
+        uint64_t doneUs;
+        CANFrame frame;
+    };
+
+    void schedule(const CANFrame& frame, uint64_t nowUs);
+
+    FakeCANController& controller;
+    std::deque<VirtualECU> ecus;
+    std::deque<InFlight> inFlight;
+    uint64_t nowUs = 0;
+    uint64_t busFreeUs = 0;
+    unsigned long lostFrames = 0;
+};
+
+#endif // VIRTUAL_BUS_HPP
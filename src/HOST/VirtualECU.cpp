@@ -0,0 +1,247 @@
+#include "VirtualECU.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "../CAN/OBDPids.hpp"
+
+namespace {
+
+// ISO-TP STmin to microseconds; reserved values mean the maximum (127 ms)
+unsigned long separationTimeUs(uint8_t stMin) {
+    if (stMin <= 0x7F) return stMin * 1000UL;
+    if (stMin >= 0xF1 && stMin <= 0xF9) return (stMin - 0xF0) * 100UL;
+    return 127000UL;
+}
+
+bool isBitmapPid(uint8_t pid) {
+    return pid % 0x20 == 0;
+}
+
+} // namespace
+
+VirtualECU::VirtualECU(const Config& config, Transmit transmit)
+    : config(config), transmit(transmit), random(config.seed) {}
+
+void VirtualECU::addSignal(const Signal& signal) {
+    signals[signal.pid] = signal;
+    walkValues[signal.pid] = signal.min + (signal.max - signal.min) / 2;
+}
+
+void VirtualECU::onFrame(const CANFrame& frame, uint64_t nowUs) {
+    if (frame.len < 1) return;
+    uint8_t frameType = frame.data[0] >> 4;
+
+    if (frame.id == requestId() && frameType == 3) {
+        handleFlowControl(frame.data, frame.len, nowUs);
+    } else if ((frame.id == FUNCTIONAL_REQUEST_ID || frame.id == requestId()) && frameType == 0) {
+        uint8_t length = frame.data[0] & 0x0F;
+        if (length >= 1 && length < frame.len) handleRequest(&frame.data[1], length, nowUs);
+    }
+}
+
+void VirtualECU::handleRequest(const uint8_t* data, uint8_t len, uint64_t nowUs) {
+    stats.requests++;
+    if (segmenting) {
+        // A new request cancels the segmented response still in progress
+        segmenting = waitingForFlowControl = false;
+        outbox.clear();
+        stats.aborted++;
+    }
+
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    if (config.dropProbability > 0 && chance(random) < config.dropProbability) {
+        stats.dropped++;
+        return;
+    }
+
+    std::vector<uint8_t> payload;
+    uint8_t service = data[0];
+    if (service == OBDPids::SERVICE_CURRENT_DATA) {
+        if (!buildCurrentData(&data[1], len - 1, nowUs, payload)) {
+            stats.unsupported++;
+            return;
+        }
+    } else if (service == OBDPids::SERVICE_STORED_DTCS) {
+        payload.push_back(OBDPids::SERVICE_STORED_DTCS + OBDPids::POSITIVE_RESPONSE_OFFSET);
+        payload.push_back((uint8_t)dtcs.size());
+        for (uint16_t code : dtcs) {
+            payload.push_back(code >> 8);
+            payload.push_back(code & 0xFF);
+        }
+    } else if (service == OBDPids::SERVICE_VEHICLE_INFO && len >= 2 && data[1] == OBDPids::VEHICLE_INFO_VIN && !vin.empty()) {
+        payload.push_back(OBDPids::SERVICE_VEHICLE_INFO + OBDPids::POSITIVE_RESPONSE_OFFSET);
+        payload.push_back(OBDPids::VEHICLE_INFO_VIN);
+        payload.push_back(1); // One data item
+        payload.insert(payload.end(), vin.begin(), vin.end());
+    } else {
+        stats.unsupported++;
+        return;
+    }
+
+    respond(payload, nowUs);
+}
+
+bool VirtualECU::buildCurrentData(const uint8_t* pids, uint8_t count, uint64_t nowUs, std::vector<uint8_t>& payload) {
+    payload.push_back(OBDPids::SERVICE_CURRENT_DATA + OBDPids::POSITIVE_RESPONSE_OFFSET);
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t pid = pids[i];
+        uint32_t value;
+        uint8_t len;
+        if (isBitmapPid(pid)) {
+            // A bitmap is only supported if the previous one announced it
+            if (pid != 0 && !(supportedBitmap(pid - 0x20) & 1)) continue;
+            value = supportedBitmap(pid);
+            len = 4;
+        } else {
+            auto it = signals.find(pid);
+            if (it == signals.end()) continue;
+            value = sampleSignal(it->second, nowUs);
+            len = it->second.len;
+        }
+
+        payload.push_back(pid);
+        for (uint8_t b = len; b > 0; b--) {
+            payload.push_back(b > 4 ? 0 : (uint8_t)(value >> (8 * (b - 1))));
+        }
+    }
+    return payload.size() > 1;
+}
+
+uint32_t VirtualECU::sampleSignal(const Signal& signal, uint64_t nowUs) {
+    double range = (double)signal.max - signal.min;
+    double phase = signal.periodMs ? (double)(nowUs / 1000 % signal.periodMs) / signal.periodMs : 0.0;
+    double value = signal.min;
+    switch (signal.trace) {
+        case Trace::CONSTANT:
+            break;
+        case Trace::SINE:
+            value = signal.min + range * (0.5 - 0.5 * cos(2 * M_PI * phase));
+            break;
+        case Trace::SAWTOOTH:
+            value = signal.min + range * phase;
+            break;
+        case Trace::RANDOM_WALK: {
+            long maxStep = (long)(range / 20) + 1;
+            std::uniform_int_distribution<long> step(-maxStep, maxStep);
+            long next = (long)walkValues[signal.pid] + step(random);
+            next = std::max<long>(signal.min, std::min<long>(signal.max, next));
+            walkValues[signal.pid] = (uint32_t)next;
+            value = next;
+            break;
+        }
+    }
+    uint32_t raw = (uint32_t)lround(value);
+    if (signal.len < 4) raw &= (1UL << (8 * signal.len)) - 1;
+    return raw;
+}
+
+uint32_t VirtualECU::supportedBitmap(uint8_t base) const {
+    // Bit 31 is PID base + 1, bit 0 is base + 0x20 (the next bitmap)
+    uint32_t bitmap = 0;
+    for (const auto& entry : signals) {
+        uint8_t pid = entry.first;
+        if (pid > base && pid <= base + 0x20) bitmap |= 1UL << (31 - (pid - base - 1));
+        if (pid > base + 0x20) bitmap |= 1;
+    }
+    return bitmap;
+}
+
+void VirtualECU::respond(const std::vector<uint8_t>& payload, uint64_t nowUs) {
+    stats.responses++;
+    uint64_t dueUs = nowUs + latencyUs();
+    uint8_t data[8] = {0};
+
+    if (payload.size() <= 7) {
+        data[0] = (uint8_t)payload.size();
+        memcpy(&data[1], payload.data(), payload.size());
+        queue(dueUs, data);
+        return;
+    }
+
+    // First Frame, the rest follows once the tester sent Flow Control
+    stats.multiFrame++;
+    data[0] = 0x10 | ((payload.size() >> 8) & 0x0F);
+    data[1] = payload.size() & 0xFF;
+    memcpy(&data[2], payload.data(), 6);
+    queue(dueUs, data);
+
+    message = payload;
+    messageOffset = 6;
+    sequence = 1;
+    segmenting = waitingForFlowControl = true;
+    flowControlDeadlineUs = dueUs + config.flowControlTimeoutUs;
+}
+
+void VirtualECU::handleFlowControl(const uint8_t* data, uint8_t len, uint64_t nowUs) {
+    if (!waitingForFlowControl || len < 3) return;
+
+    switch (data[0] & 0x0F) {
+        case 0: // Continue to send
+            blockRemaining = data[1];
+            separationUs = std::max(separationTimeUs(data[2]), separationTimeUs(config.stMin));
+            waitingForFlowControl = false;
+            queueConsecutiveFrames(nowUs);
+            break;
+        case 1: // Wait
+            flowControlDeadlineUs = nowUs + config.flowControlTimeoutUs;
+            break;
+        default: // Overflow or invalid
+            segmenting = waitingForFlowControl = false;
+            stats.aborted++;
+            break;
+    }
+}
+
+void VirtualECU::queueConsecutiveFrames(uint64_t nowUs) {
+    uint64_t dueUs = nowUs;
+    uint8_t blockSize = blockRemaining;
+    uint8_t sent = 0;
+    while (messageOffset < message.size()) {
+        uint8_t data[8] = {0};
+        data[0] = 0x20 | (sequence++ & 0x0F);
+        size_t chunk = std::min<size_t>(7, message.size() - messageOffset);
+        memcpy(&data[1], &message[messageOffset], chunk);
+        messageOffset += chunk;
+        queue(dueUs, data);
+        dueUs += separationUs;
+
+        if (blockSize && ++sent == blockSize && messageOffset < message.size()) {
+            waitingForFlowControl = true;
+            flowControlDeadlineUs = dueUs + config.flowControlTimeoutUs;
+            return;
+        }
+    }
+    segmenting = false;
+}
+
+void VirtualECU::update(uint64_t nowUs) {
+    while (!outbox.empty() && outbox.front().dueUs <= nowUs) {
+        CANFrame frame = outbox.front().frame;
+        outbox.pop_front();
+        stats.framesSent++;
+        transmit(frame);
+    }
+
+    if (waitingForFlowControl && nowUs >= flowControlDeadlineUs) {
+        segmenting = waitingForFlowControl = false;
+        stats.aborted++;
+    }
+}
+
+unsigned long VirtualECU::latencyUs() {
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    if (config.tailProbability > 0 && chance(random) < config.tailProbability) return config.tailLatencyUs;
+    std::uniform_int_distribution<unsigned long> latency(config.latencyMinUs, std::max(config.latencyMinUs, config.latencyMaxUs));
+    return latency(random);
+}
+
+void VirtualECU::queue(uint64_t dueUs, const uint8_t* data) {
+    Outgoing outgoing = {dueUs, {}};
+    outgoing.frame.id = config.responseId;
+    outgoing.frame.len = 8;
+    memcpy(outgoing.frame.data, data, 8);
+    auto position = std::upper_bound(outbox.begin(), outbox.end(), dueUs, [](uint64_t due, const Outgoing& entry) { return due < entry.dueUs; });
+    outbox.insert(position, outgoing);
+}
@@ -0,0 +1,122 @@
+#ifndef VIRTUAL_ECU_HPP
+#define VIRTUAL_ECU_HPP
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../CAN/CANFrame.hpp"
+
+// Simulated OBD-II ECU for the native build. Answers functional (0x7DF) and
+// physical (0x7E0 + n) requests for service 01 from a PID table with value
+// traces, service 03 from a DTC list and service 09 PID 02 with a VIN.
+// Responses longer than a single frame are segmented over ISO-TP and wait
+// for the tester's Flow Control. Latency, jitter and dropped responses come
+// from Config; PIDs missing from the table are left out of the response
+// (no response at all if none of the requested PIDs is supported), and the
+// supported PID bitmaps (0x00, 0x20, ...) are generated from the table.
+class VirtualECU {
+public:
+    using Transmit = std::function<void(const CANFrame& frame)>;
+
+    enum class Trace {
+        CONSTANT,    // min
+        SINE,        // min..max over periodMs
+        SAWTOOTH,    // min -> max over periodMs, then back to min
+        RANDOM_WALK  // Steps of up to (max - min) / 20 per request, clamped to min..max
+    };
+
+    // Raw values are the integers sent on the bus, big-endian in len bytes
+    struct Signal {
+        uint8_t pid;
+        uint8_t len;
+        Trace trace;
+        uint32_t min;
+        uint32_t max;
+        unsigned long periodMs;
+    };
+
+    struct Config {
+        uint16_t responseId = 0x7E8;
+        unsigned long latencyMinUs = 5000;  // Request -> first response frame, uniform
+        unsigned long latencyMaxUs = 15000;
+        float tailProbability = 0.0f;       // Share of responses that take tailLatencyUs instead
+        unsigned long tailLatencyUs = 0;
+        float dropProbability = 0.0f;       // Requests left unanswered
+        uint8_t stMin = 0;                  // Minimum gap between our consecutive frames, ISO-TP encoding
+        unsigned long flowControlTimeoutUs = 1000000; // N_Bs
+        uint32_t seed = 1;
+    };
+
+    struct Stats {
+        unsigned long requests;
+        unsigned long responses;
+        unsigned long dropped;      // Left unanswered on purpose
+        unsigned long unsupported;  // No requested PID was in the table
+        unsigned long multiFrame;   // Responses sent over ISO-TP segmentation
+        unsigned long aborted;      // Segmented responses the tester never sent Flow Control for
+        unsigned long framesSent;
+    };
+
+    VirtualECU(const Config& config, Transmit transmit);
+
+    void addSignal(const Signal& signal);
+    void setVIN(const char* text) { vin = text; }
+    void addDTC(uint16_t code) { dtcs.push_back(code); }
+
+    // Frame seen on the bus at nowUs (simulation time)
+    void onFrame(const CANFrame& frame, uint64_t nowUs);
+    // Transmits frames that are due at nowUs
+    void update(uint64_t nowUs);
+    bool isIdle() const { return outbox.empty() && !segmenting; }
+
+    const Config& getConfig() const { return config; }
+    const Stats& getStats() const { return stats; }
+
+private:
+    static constexpr uint16_t FUNCTIONAL_REQUEST_ID = 0x7DF;
+
+    struct Outgoing {
+        uint64_t dueUs;
+        CANFrame frame;
+    };
+
+    uint16_t requestId() const { return config.responseId - 8; }
+    void handleRequest(const uint8_t* data, uint8_t len, uint64_t nowUs);
+    void handleFlowControl(const uint8_t* data, uint8_t len, uint64_t nowUs);
+    bool buildCurrentData(const uint8_t* pids, uint8_t count, uint64_t nowUs, std::vector<uint8_t>& payload);
+    uint32_t sampleSignal(const Signal& signal, uint64_t nowUs);
+    uint32_t supportedBitmap(uint8_t base) const;
+    void respond(const std::vector<uint8_t>& payload, uint64_t nowUs);
+    void queueConsecutiveFrames(uint64_t nowUs);
+    unsigned long latencyUs();
+    void queue(uint64_t dueUs, const uint8_t* data);
+
+    Config config;
+    Transmit transmit;
+    std::mt19937 random;
+
+    std::map<uint8_t, Signal> signals;
+    std::map<uint8_t, uint32_t> walkValues;
+    std::string vin;
+    std::vector<uint16_t> dtcs;
+
+    std::deque<Outgoing> outbox; // Due times ascending
+
+    // Segmented response in progress
+    bool segmenting = false;
+    bool waitingForFlowControl = false;
+    std::vector<uint8_t> message;
+    size_t messageOffset = 0;
+    uint8_t sequence = 0;
+    uint8_t blockRemaining = 0;  // 0 = no limit
+    unsigned long separationUs = 0;
+    uint64_t flowControlDeadlineUs = 0;
+
+    Stats stats = {};
+};
+
+#endif // VIRTUAL_ECU_HPP
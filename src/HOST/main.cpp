@@ -0,0 +1,403 @@
+// Native entry point: runs the portable handlers against the host fakes.
+//
+//   program decode <base64>         Prints a compact upload batch as CSV
+//   program logdecode <base64>      Formats a packed binary log stream
+//   program simulate [options]      CANHandler against simulated ECUs, prints
+//                                   sweep time and sample rates as key=value
+//   program ecu <interface> [opts]  Simulated ECUs on a SocketCAN interface
+//   program bench [--out=<file>] [--filter=<text>]
+//                                   Hot path microbenchmarks, JSON results
+//                                   (default bench.json)
+//
+// Simulation options:
+//   --duration=<s>        Simulated time (default 60)
+//   --interval=<ms>       CAN_REQUEST_INTERVAL (default 100)
+//   --threshold=<ms>      CAN_RESPONSE_THRESHOLD (default 200)
+//   --latency=<min>:<max> ECU response latency in us (default 5000:15000)
+//   --tail=<p>:<us>       Share of slow responses and their latency
+//   --drop=<p>            Share of unanswered requests
+//   --ecus=<n>            1 = engine only, 2 = engine + transmission
+//   --seed=<n>
+//   --can=<interface>     Use a SocketCAN interface in real time instead
+//                         of the in-process bus (run "ecu" on the other end)
+//
+// Unit tests live in test/test_native_* and replace this entry point:
+//   pio test -e native
+
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../CAN/CANHandler.hpp"
+#include "../CODEC/LogCodec.hpp"
+#include "../CODEC/SampleCodec.hpp"
+#include "../LOG/LogHandler.hpp"
+#include "../PROFILE/LoopProfiler.hpp"
+#include "../SETTINGS/SettingsHandler.hpp"
+#include "Benchmarks.hpp"
+#include "FakeCANController.hpp"
+#include "HostClock.hpp"
+#include "SocketCANController.hpp"
+#include "StdoutLogSink.hpp"
+#include "VirtualBus.hpp"
+#include "VirtualECU.hpp"
+
+namespace {
+
+StdoutLogSink stdoutSink;
+
+void addPID(PIDTable& pids, byte pid, const char* label, const char* formula) {
+    PIDConfig& config = pids.add(pid);
+    config.label = label;
+    config.formula = formula;
+    config.program.compile(formula);
+}
+
+int decode(const char* text) {
+    size_t length = strlen(text);
+    std::vector<uint8_t> data(length / 4 * 3 + 3);
+    size_t size = SampleCodec::base64Decode(text, length, data.data(), data.size());
+    if (size == 0) {
+        fprintf(stderr, "Invalid base64\n");
+        return 1;
+    }
+
+    printf("epoch_ms,ecu,pid,data\n");
+    bool ok = SampleCodec::decode(data.data(), size, [](const TimedSample& sample) {
+        printf("%llu,%03X,%02X,", (unsigned long long)sample.epochMs, sample.sample.ecuId, sample.sample.pid);
+        for (uint8_t i = 0; i < sample.sample.len; i++) printf("%02X", sample.sample.data[i]);
+        printf("\n");
+    });
+    if (!ok) {
+        fprintf(stderr, "Malformed batch\n");
+        return 1;
+    }
+    return 0;
+}
+
+int logDecode(const char* text) {
+    size_t length = strlen(text);
+    std::vector<uint8_t> data(length / 4 * 3 + 3);
+    size_t size = SampleCodec::base64Decode(text, length, data.data(), data.size());
+    if (size == 0) {
+        fprintf(stderr, "Invalid base64\n");
+        return 1;
+    }
+
+    bool ok = LogCodec::decode(data.data(), size, [](uint64_t bootEpochMs, const BinaryLogRecord& record) {
+        char message[LogHandler::LogRecord::MAX_MESSAGE];
+        LogHandler::formatBinary(record, message, sizeof(message));
+        if (bootEpochMs) {
+            printf("%llu ", (unsigned long long)(bootEpochMs + record.uptimeMs));
+        } else {
+            printf("+%lu ", (unsigned long)record.uptimeMs);
+        }
+        printf("[%s] %s\n", LogHandler::typeName(LogHandler::binaryType(record.format)), message);
+    });
+    if (!ok) {
+        fprintf(stderr, "Malformed log stream\n");
+        return 1;
+    }
+    return 0;
+}
+
+struct SimulationOptions {
+    unsigned long durationS = 60;
+    int intervalMs = 100;
+    int thresholdMs = 200;
+    VirtualECU::Config ecu;
+    int ecuCount = 1;
+    const char* canInterface = nullptr;
+};
+
+bool parseOption(const char* arg, SimulationOptions& options) {
+    const char* value = strchr(arg, '=');
+    if (strncmp(arg, "--", 2) != 0 || !value) return false;
+    value++;
+    std::string name(arg + 2, value - arg - 3);
+
+    if (name == "duration") options.durationS = strtoul(value, nullptr, 10);
+    else if (name == "interval") options.intervalMs = atoi(value);
+    else if (name == "threshold") options.thresholdMs = atoi(value);
+    else if (name == "latency") {
+        char* end;
+        options.ecu.latencyMinUs = strtoul(value, &end, 10);
+        options.ecu.latencyMaxUs = *end == ':' ? strtoul(end + 1, nullptr, 10) : options.ecu.latencyMinUs;
+    } else if (name == "tail") {
+        char* end;
+        options.ecu.tailProbability = strtof(value, &end);
+        if (*end != ':') return false;
+        options.ecu.tailLatencyUs = strtoul(end + 1, nullptr, 10);
+    } else if (name == "drop") options.ecu.dropProbability = strtof(value, nullptr);
+    else if (name == "ecus") options.ecuCount = atoi(value);
+    else if (name == "seed") options.ecu.seed = strtoul(value, nullptr, 10);
+    else if (name == "can") options.canInterface = value;
+    else return false;
+    return true;
+}
+
+// Engine ECU with the PIDs the default config polls, except 0x46 (ambient
+// temperature) which stays unsupported. A second ECU answers like a
+// transmission controller with a few overlapping PIDs.
+void addSimulatedECUs(const SimulationOptions& options, const std::function<VirtualECU&(const VirtualECU::Config&)>& addECU) {
+    using Trace = VirtualECU::Trace;
+    VirtualECU& engine = addECU(options.ecu);
+    engine.addSignal({0x05, 1, Trace::SINE, 60, 130, 120000});          // Coolant 20 - 90 C
+    engine.addSignal({0x0C, 2, Trace::SINE, 3200, 16000, 10000});       // RPM 800 - 4000
+    engine.addSignal({0x0D, 1, Trace::SAWTOOTH, 0, 120, 30000});        // Speed
+    engine.addSignal({0x0F, 1, Trace::RANDOM_WALK, 50, 90, 0});         // Intake air temperature
+    engine.addSignal({0x10, 2, Trace::SINE, 200, 4000, 10000});         // MAF
+    engine.addSignal({0x11, 1, Trace::RANDOM_WALK, 30, 230, 0});        // Throttle
+    engine.addSignal({0x2F, 1, Trace::CONSTANT, 160, 160, 0});          // Fuel level
+    engine.addSignal({0x42, 2, Trace::RANDOM_WALK, 13500, 14400, 0});   // Module voltage
+    engine.setVIN("WVWZZZ1JZXW000001");
+    engine.addDTC(0x0301);
+
+    if (options.ecuCount > 1) {
+        VirtualECU::Config config = options.ecu;
+        config.responseId = 0x7E9;
+        config.seed = options.ecu.seed + 1;
+        VirtualECU& transmission = addECU(config);
+        transmission.addSignal({0x05, 1, Trace::SINE, 60, 130, 120000});
+        transmission.addSignal({0x0D, 1, Trace::SAWTOOTH, 0, 120, 30000});
+        transmission.addSignal({0x42, 2, Trace::RANDOM_WALK, 13500, 14400, 0});
+    }
+}
+
+void addSimulatedPIDs(PIDTable& pids) {
+    addPID(pids, 0x05, "Coolant", "A-40");
+    addPID(pids, 0x0C, "RPM", "((A*256)+B)/4");
+    addPID(pids, 0x0D, "Speed", "A");
+    addPID(pids, 0x0F, "IntakeTemp", "A-40");
+    addPID(pids, 0x10, "MAF", "((A*256)+B)/100");
+    addPID(pids, 0x11, "Throttle", "A*100/255");
+    addPID(pids, 0x2F, "FuelLevel", "A*100/255");
+    addPID(pids, 0x42, "ModuleVoltage", "((A*256)+B)/1000");
+    addPID(pids, 0x46, "AmbientTemp", "A-40");
+}
+
+int simulate(const SimulationOptions& options) {
+    static constexpr unsigned long STEP_US = 250;
+
+    HostClock& clock = HostClock::instance();
+    if (!options.canInterface) clock.setManual(1700000000000ULL);
+    SettingsHandler::setEnableLogs(false);
+    SettingsHandler::setCanRequestInterval(options.intervalMs);
+    SettingsHandler::setCanResponseThreshold(options.thresholdMs);
+
+    std::shared_ptr<PIDTable> pidTable = std::make_shared<PIDTable>();
+    addSimulatedPIDs(*pidTable);
+    SharedPIDTable pidTables;
+    pidTables.publish(pidTable);
+
+    FakeCANController fakeController;
+    SocketCANController socketController(options.canInterface ? options.canInterface : "");
+    VirtualBus bus(fakeController);
+    CANController* controller = &fakeController;
+    if (options.canInterface) {
+        controller = &socketController;
+    } else {
+        addSimulatedECUs(options, [&bus](const VirtualECU::Config& config) -> VirtualECU& { return bus.addECU(config); });
+    }
+
+    CANHandler canHandler(*controller, pidTables);
+    if (!canHandler.begin()) {
+        fprintf(stderr, "CAN controller failed to start\n");
+        return 1;
+    }
+
+    std::map<byte, unsigned long> samplesPerPid;
+    std::set<byte> sweepPids;         // PIDs seen since the last complete sweep
+    std::set<byte> answeredPids;      // PIDs the ECUs answered at all
+    unsigned long sweeps = 0, sweepTotalMs = 0, sweepMaxMs = 0;
+    unsigned long requests = 0, responseTotalUs = 0, responseMaxUs = 0, responses = 0;
+    unsigned long sweepStart = 0, lastRequestUs = 0;
+    bool awaitingFirstSample = false;
+    std::vector<SampleRecord> samples;
+
+    unsigned long start = clock.millis();
+    while (clock.millis() - start < options.durationS * 1000) {
+        if (clock.isManual()) clock.advanceUs(STEP_US);
+        else clock.sleep(1);
+        unsigned long nowUs = clock.micros();
+
+        bus.update(nowUs);
+        LogHandler::flush();
+        {
+            PROFILE_SCOPE(CAN_SEND);
+            canHandler.sendRequests();
+        }
+        // Requests are only visible on the in-process bus
+        for (const CANFrame& frame : fakeController.takeSent()) {
+            if (frame.id != 0x7DF || frame.data[1] != OBDPids::SERVICE_CURRENT_DATA) continue;
+            requests++;
+            lastRequestUs = nowUs;
+            awaitingFirstSample = true;
+        }
+
+        bool received;
+        {
+            PROFILE_SCOPE(CAN_RECEIVE);
+            received = canHandler.handleResponses(samples);
+        }
+        if (!received) continue;
+        if (awaitingFirstSample) {
+            unsigned long elapsed = nowUs - lastRequestUs;
+            responseTotalUs += elapsed;
+            if (elapsed > responseMaxUs) responseMaxUs = elapsed;
+            responses++;
+            awaitingFirstSample = false;
+        }
+        for (const SampleRecord& sample : samples) {
+            samplesPerPid[sample.pid]++;
+            answeredPids.insert(sample.pid);
+            sweepPids.insert(sample.pid);
+        }
+        samples.clear();
+
+        // A sweep is complete once every PID the ECUs answer was refreshed
+        if (sweepPids.size() == answeredPids.size() && clock.millis() - start > 1000) {
+            unsigned long now = clock.millis();
+            if (sweepStart != 0) {
+                unsigned long duration = now - sweepStart;
+                sweeps++;
+                sweepTotalMs += duration;
+                if (duration > sweepMaxMs) sweepMaxMs = duration;
+            }
+            sweepStart = now;
+            sweepPids.clear();
+        }
+    }
+
+    double seconds = (clock.millis() - start) / 1000.0;
+    unsigned long totalSamples = 0;
+    for (const auto& entry : samplesPerPid) totalSamples += entry.second;
+
+    printf("sim_seconds=%.1f\n", seconds);
+    printf("interval_ms=%d\nthreshold_ms=%d\n", options.intervalMs, options.thresholdMs);
+    printf("requests=%lu\nrequests_per_s=%.2f\n", requests, requests / seconds);
+    printf("responses=%lu\n", responses);
+    printf("response_ms_avg=%.2f\nresponse_ms_max=%.2f\n", responses ? responseTotalUs / 1000.0 / responses : 0.0, responseMaxUs / 1000.0);
+    printf("samples=%lu\nsamples_per_s=%.2f\n", totalSamples, totalSamples / seconds);
+    printf("sweeps=%lu\nsweep_ms_avg=%.1f\nsweep_ms_max=%lu\n", sweeps, sweeps ? (double)sweepTotalMs / sweeps : 0.0, sweepMaxMs);
+    for (const PIDConfig& config : *pidTable) {
+        auto found = samplesPerPid.find(config.pid);
+        unsigned long count = found == samplesPerPid.end() ? 0 : found->second;
+        printf("pid_%02X_hz=%.2f\n", config.pid, count / seconds);
+    }
+    // Host CPU time per call, not ESP32 cycles
+    for (LoopProfiler::Stage stage : {LoopProfiler::Stage::CAN_SEND, LoopProfiler::Stage::CAN_RECEIVE}) {
+        LoopProfiler::Summary summary = LoopProfiler::summarize(stage);
+        const char* name = LoopProfiler::stageName(stage);
+        printf("%s_us_p50=%lu\n%s_us_p99=%lu\n%s_us_max=%lu\n", name, (unsigned long)summary.p50Us, name, (unsigned long)summary.p99Us, name, (unsigned long)summary.maxUs);
+    }
+    CANMetrics::Snapshot health;
+    canHandler.getHealth(health);
+    for (uint8_t i = 0; i < health.pidCount; i++) {
+        const CANMetrics::PIDMetrics& pid = health.pids[i];
+        printf("pid_%02X_timeouts=%lu\npid_%02X_unanswered=%lu\n", pid.pid, (unsigned long)pid.timeouts, pid.pid, (unsigned long)pid.unanswered);
+        printf("pid_%02X_latency_ms_p50=%lu\npid_%02X_latency_ms_p99=%lu\n", pid.pid, (unsigned long)CANMetrics::latencyPercentileMs(pid, 500), pid.pid, (unsigned long)CANMetrics::latencyPercentileMs(pid, 990));
+    }
+    CANHandler::PIDSupport support;
+    canHandler.getPIDSupport(support);
+    printf("pids_discovered=%d\npids_unsupported=", support.discovered);
+    for (uint8_t i = 0; i < support.unsupportedCount; i++) printf("%s%02X", i ? "," : "", support.unsupported[i]);
+    printf("\n");
+    printf("rx_overflows=%lu\n", (unsigned long)health.bus.rxOverflows);
+    printf("rx_dropped_frames=%lu\n", canHandler.getRxStats().droppedFrames);
+    printf("bus_lost_frames=%lu\n", bus.getLostFrames());
+    for (VirtualECU* ecu : bus.getECUs()) {
+        const VirtualECU::Stats& stats = ecu->getStats();
+        unsigned id = ecu->getConfig().responseId;
+        printf("ecu_%03X_requests=%lu\necu_%03X_dropped=%lu\necu_%03X_unsupported=%lu\n", id, stats.requests, id, stats.dropped, id, stats.unsupported);
+        printf("ecu_%03X_multi_frame=%lu\necu_%03X_aborted=%lu\n", id, stats.multiFrame, id, stats.aborted);
+    }
+    return 0;
+}
+
+// Serves the simulated ECUs on a SocketCAN interface until killed
+int runECU(const SimulationOptions& options) {
+    SocketCANController controller(options.canInterface);
+    if (!controller.begin()) {
+        fprintf(stderr, "Cannot open CAN interface %s\n", options.canInterface);
+        return 1;
+    }
+
+    HostClock& clock = HostClock::instance();
+    std::deque<VirtualECU> ecus;
+    addSimulatedECUs(options, [&](const VirtualECU::Config& config) -> VirtualECU& {
+        ecus.emplace_back(config, [&controller](const CANFrame& frame) { controller.send(frame.id, frame.data, frame.len); });
+        return ecus.back();
+    });
+
+    while (true) {
+        unsigned long nowUs = clock.micros();
+        CANFrame frame;
+        while (controller.receive(frame)) {
+            for (VirtualECU& ecu : ecus) ecu.onFrame(frame, nowUs);
+        }
+        for (VirtualECU& ecu : ecus) ecu.update(nowUs);
+        LogHandler::flush();
+        clock.sleep(1);
+    }
+}
+
+int usage() {
+    fprintf(stderr, "usage: program decode <base64>\n"
+                    "       program logdecode <base64>\n"
+                    "       program simulate [--duration=s] [--interval=ms] [--threshold=ms] [--latency=us:us]\n"
+                    "                        [--tail=p:us] [--drop=p] [--ecus=n] [--seed=n] [--can=interface]\n"
+                    "       program ecu <interface> [options]\n"
+                    "       program bench [--out=file] [--filter=text]\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+
+    LogHandler::setClock(&HostClock::instance());
+    // Log lines are flushed synchronously by the commands, no drain task
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) LogHandler::addSink(&stdoutSink);
+    }
+
+    if (strcmp(argv[1], "decode") == 0 && argc == 3) return decode(argv[2]);
+    if (strcmp(argv[1], "logdecode") == 0 && argc == 3) return logDecode(argv[2]);
+
+    if (strcmp(argv[1], "bench") == 0) {
+        const char* output = "bench.json";
+        const char* filter = nullptr;
+        for (int i = 2; i < argc; i++) {
+            if (strncmp(argv[i], "--out=", 6) == 0) output = argv[i] + 6;
+            else if (strncmp(argv[i], "--filter=", 9) == 0) filter = argv[i] + 9;
+            else return usage();
+        }
+        return runBenchmarks(output, filter);
+    }
+
+    if (strcmp(argv[1], "simulate") == 0 || strcmp(argv[1], "ecu") == 0) {
+        SimulationOptions options;
+        bool ecu = strcmp(argv[1], "ecu") == 0;
+        int first = 2;
+        if (ecu) {
+            if (argc < 3) return usage();
+            options.canInterface = argv[2];
+            first = 3;
+        }
+        for (int i = first; i < argc; i++) {
+            if (strcmp(argv[i], "-v") != 0 && !parseOption(argv[i], options)) return usage();
+        }
+        return ecu ? runECU(options) : simulate(options);
+    }
+    return usage();
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,81 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../HostClock.hpp"
+
+HostSerial Serial;
+
+unsigned long millis() {
+    return HostClock::instance().millis();
+}
+
+unsigned long micros() {
+    return HostClock::instance().micros();
+}
+
+void delay(unsigned long ms) {
+    HostClock::instance().sleep(ms);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new std::recursive_mutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t) {
+    static_cast<std::recursive_mutex*>(semaphore)->lock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    static_cast<std::recursive_mutex*>(semaphore)->unlock();
+    return pdTRUE;
+}
+
+struct HostTask {
+    std::mutex mutex;
+    std::condition_variable wake;
+    uint32_t notifications = 0;
+};
+
+static thread_local HostTask* currentTask = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t, void* param, int, TaskHandle_t* handle, int) {
+    HostTask* hostTask = new HostTask();
+    if (handle) *handle = hostTask;
+    std::thread([task, param, hostTask]() {
+        currentTask = hostTask;
+        task(param);
+    }).detach();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    if (!currentTask) {
+        vTaskDelay(ticks);
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(currentTask->mutex);
+    currentTask->wake.wait_for(lock, std::chrono::milliseconds(ticks), []() { return currentTask->notifications > 0; });
+    uint32_t count = currentTask->notifications;
+    currentTask->notifications = clearOnExit ? 0 : (count > 0 ? count - 1 : 0);
+    return count;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    HostTask* hostTask = static_cast<HostTask*>(task);
+    if (!hostTask) return;
+    {
+        std::lock_guard<std::mutex> lock(hostTask->mutex);
+        hostTask->notifications++;
+    }
+    hostTask->wake.notify_one();
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
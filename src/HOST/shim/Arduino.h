@@ -0,0 +1,128 @@
+#pragma once
+// Minimal Arduino / FreeRTOS API for the native build. Only what the
+// portable handlers use; timing comes from HostClock.
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HEX 16
+#define DEC 10
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define IRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// GPIO does nothing on the host
+inline void pinMode(int, int) {}
+inline int digitalRead(int) { return HIGH; }
+inline void digitalWrite(int, int) {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+
+class String {
+public:
+    String() {}
+    String(const char* text) : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+    explicit String(char c) : value(1, c) {}
+    String(int number, unsigned char base = DEC) { format(base == HEX ? "%x" : "%d", number); }
+    String(unsigned int number, unsigned char base = DEC) { format(base == HEX ? "%x" : "%u", number); }
+    String(long number, unsigned char base = DEC) { format(base == HEX ? "%lx" : "%ld", number); }
+    String(unsigned long number, unsigned char base = DEC) { format(base == HEX ? "%lx" : "%lu", number); }
+    String(unsigned char number, unsigned char base = DEC) : String((unsigned int)number, base) {}
+    String(float number, unsigned char decimals = 2) : String((double)number, decimals) {}
+    String(double number, unsigned char decimals = 2) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, number);
+        value = buffer;
+    }
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.size(); }
+    bool isEmpty() const { return value.empty(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    long toInt() const { return atol(value.c_str()); }
+    float toFloat() const { return atof(value.c_str()); }
+    int indexOf(char c) const { size_t p = value.find(c); return p == std::string::npos ? -1 : (int)p; }
+    int indexOf(const String& text) const { size_t p = value.find(text.value); return p == std::string::npos ? -1 : (int)p; }
+    void replace(const String& find, const String& with) {
+        if (find.value.empty()) return;
+        for (size_t p = value.find(find.value); p != std::string::npos; p = value.find(find.value, p + with.value.size())) {
+            value.replace(p, find.value.size(), with.value);
+        }
+    }
+    String substring(unsigned int from) const { return from < value.size() ? String(value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < value.size() ? String(value.substr(from, to - from)) : String(); }
+    bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    char operator[](unsigned int index) const { return index < value.size() ? value[index] : 0; }
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(const char* other) { value += other; return *this; }
+    String& operator+=(char other) { value += other; return *this; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* other) const { return value == other; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    bool operator<(const String& other) const { return value < other.value; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.value + b.value); }
+    friend String operator+(const String& a, const char* b) { return String(a.value + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.value); }
+
+private:
+    template <typename T>
+    void format(const char* pattern, T number) {
+        char buffer[34];
+        snprintf(buffer, sizeof(buffer), pattern, number);
+        value = buffer;
+    }
+
+    std::string value;
+};
+
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    void println(const String& line) { puts(line.c_str()); }
+    void print(const String& text) { fputs(text.c_str(), stdout); }
+};
+extern HostSerial Serial;
+
+// FreeRTOS subset backed by std::thread / std::mutex
+typedef void* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_PERIOD_MS 1
+#define configMAX_PRIORITIES 25
+#define pdMS_TO_TICKS(ms) (ms)
+#define portYIELD_FROM_ISR() do {} while (0)
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackSize, void* param, int priority, TaskHandle_t* handle, int core);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+void vTaskDelay(TickType_t ticks);
+inline int xPortGetCoreID() { return 0; }
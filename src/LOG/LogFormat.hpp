@@ -0,0 +1,32 @@
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include <stdint.h>
+
+// IDs of the fixed message templates logged in binary form. The IDs end up
+// in uploaded logs, so existing values must never change; new templates are
+// appended before COUNT. Texts live in LogHandler.cpp.
+enum class LogFormat : uint16_t {
+    CAN_REQUEST_SENT = 1,
+    CAN_REQUEST_FAILED = 2,
+    CAN_RESPONSE_TIMEOUT = 3,
+    CAN_NEGATIVE_RESPONSE = 4,
+    ISOTP_ERROR = 5,
+    ISOTP_TIMEOUT = 6,
+    UPLOAD_SENT = 7,
+    UPLOAD_REPLAYED = 8,
+    COUNT
+};
+
+// A log message as recorded on the hot path: template ID plus raw
+// arguments, formatted only when the log is drained or decoded
+struct BinaryLogRecord {
+    static constexpr uint8_t MAX_ARGS = 4;
+
+    uint32_t uptimeMs;
+    uint16_t format;    // LogFormat
+    uint8_t argCount;
+    uint32_t args[MAX_ARGS];
+};
+
+#endif // LOG_FORMAT_HPP
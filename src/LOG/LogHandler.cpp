@@ -1,56 +1,270 @@
 #include "LogHandler.hpp"
 
-#include "../SETTINGS/SettingsHandler.hpp"
+#include <stdio.h>
+#include <string.h>
 
-std::queue<LogHandler::LogEntry> LogHandler::logQueue;
+Clock* LogHandler::clock = nullptr;
+LogSink* LogHandler::sinks[LogHandler::MAX_SINKS] = {nullptr};
+size_t LogHandler::sinkCount = 0;
+BoundedQueue<LogHandler::LogRecord, LogHandler::OUTPUT_QUEUE_SIZE> LogHandler::outputQueue;
+BoundedQueue<LogHandler::LogRecord, LogHandler::UPLOAD_QUEUE_SIZE> LogHandler::uploadQueue;
+BoundedQueue<BinaryLogRecord, LogHandler::BINARY_QUEUE_SIZE> LogHandler::binaryQueue;
+BoundedQueue<BinaryLogRecord, LogHandler::BINARY_QUEUE_SIZE> LogHandler::binaryUploadQueue;
+std::atomic<unsigned long> LogHandler::written{0};
+std::atomic<unsigned long> LogHandler::truncated{0};
+unsigned long LogHandler::reportedDrops = 0;
 
-unsigned long LogHandler::getTime() {
-    time_t now;
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo) || timeinfo.tm_year < (2020 - 1900)) {
-        // Time not set or invalid
-        return 0;
+namespace {
+
+struct BinaryFormat {
+    LogHandler::DebugType type;
+    bool upload;        // Also queued for the log upload (when ENABLE_LOGS is set)
+    const char* text;   // %u %d %x take one argument, %L a PID list packed by packPids()
+};
+
+// Indexed by LogFormat
+const BinaryFormat BINARY_FORMATS[] = {
+    {LogHandler::DebugType::INFO, false, nullptr},
+    {LogHandler::DebugType::CAN, true, "Request sent for PIDs: %L"},
+    {LogHandler::DebugType::CAN, true, "Error sending request for PIDs: %L"},
+    {LogHandler::DebugType::CAN, true, "Timeout waiting for response for PIDs: %L"},
+    {LogHandler::DebugType::CAN, true, "Negative response (NRC %x) for service %x"},
+    {LogHandler::DebugType::CAN, true, "ISO-TP error from ECU %x"},
+    {LogHandler::DebugType::CAN, true, "ISO-TP timeout waiting for consecutive frame from ECU %x"},
+    {LogHandler::DebugType::INFO, false, "Uploaded %u samples in one update"},
+    {LogHandler::DebugType::INFO, false, "Replayed %u journaled samples, %u left"},
+};
+static_assert(sizeof(BINARY_FORMATS) / sizeof(BINARY_FORMATS[0]) == (size_t)LogFormat::COUNT, "Every LogFormat needs a template");
+
+} // namespace
+
+void LogHandler::setClock(Clock* clock) {
+    LogHandler::clock = clock;
+}
+
+void LogHandler::addSink(LogSink* sink) {
+    if (sinkCount < MAX_SINKS) sinks[sinkCount++] = sink;
+}
+
+void LogHandler::begin() {
+    // Below the CAN and uplink tasks, a slow sink only delays the log output
+    xTaskCreatePinnedToCore(drainTask, "log_drain", 4096, nullptr, 1, nullptr, 0);
+}
+
+void LogHandler::drainTask(void*) {
+    while (true) {
+        flush();
+        vTaskDelay(pdMS_TO_TICKS(DRAIN_INTERVAL_MS));
     }
-    time(&now);
-    return now;
+}
+
+unsigned long LogHandler::getTime() {
+    return getTimeMs() / 1000;
+}
+
+uint64_t LogHandler::getTimeMs() {
+    return clock ? clock->epochMs() : 0;
 }
 
 void LogHandler::writeMessage(LogHandler::DebugType type, const String& message, bool sendToFirebase) {
-    String typeStr;
-    switch (type) {
-        case DebugType::INFO: typeStr = "INFO"; break;
-        case DebugType::WARNING: typeStr = "WARNING"; break;
-        case DebugType::ERROR: typeStr = "ERROR"; break;
-        case DebugType::BLE: typeStr = "BLE"; break;
-        case DebugType::CAN: typeStr = "CAN"; break;
-        default: typeStr = "INFO"; break;
-    }
-    if (sendToFirebase && SettingsHandler::getEnableLogs()) {
-        long time = getTime();
-        if (time == 0)
-        {
-            time = -millis();
+    writeMessage(type, message.c_str(), sendToFirebase);
+}
+
+void LogHandler::writeMessage(LogHandler::DebugType type, const char* message, bool sendToFirebase) {
+    if (!isEnabled(type)) return;
+
+    bool upload = sendToFirebase && SettingsHandler::getEnableLogs();
+    if (sinkCount == 0 && !upload) return;
+
+    LogRecord record;
+    record.epochMs = getTimeMs();
+    record.uptimeMs = millis();
+    record.type = type;
+    size_t length = strlen(message);
+    if (length >= LogRecord::MAX_MESSAGE) {
+        length = LogRecord::MAX_MESSAGE - 1;
+        truncated++;
+    }
+    memcpy(record.message, message, length);
+    record.message[length] = '\0';
+    written++;
+
+    if (sinkCount > 0) outputQueue.push(record);
+    if (upload) uploadQueue.push(record);
+}
+
+void LogHandler::writeBinary(LogFormat format, uint8_t argCount, const uint32_t* args) {
+    uint16_t id = (uint16_t)format;
+    if (id == 0 || id >= (uint16_t)LogFormat::COUNT || !isEnabled(BINARY_FORMATS[id].type)) return;
+
+    bool upload = BINARY_FORMATS[id].upload && SettingsHandler::getEnableLogs();
+    if (sinkCount == 0 && !upload) return;
+
+    BinaryLogRecord record;
+    record.uptimeMs = millis();
+    record.format = id;
+    record.argCount = argCount < BinaryLogRecord::MAX_ARGS ? argCount : BinaryLogRecord::MAX_ARGS;
+    memcpy(record.args, args, record.argCount * sizeof(uint32_t));
+    written++;
+
+    if (sinkCount > 0) binaryQueue.push(record);
+    if (upload) binaryUploadQueue.push(record);
+}
+
+void LogHandler::packPids(const uint8_t* pids, uint8_t count, uint32_t& first, uint32_t& second) {
+    uint8_t bytes[8] = {0};
+    bytes[0] = count < 6 ? count : 6;
+    memcpy(&bytes[1], pids, bytes[0]);
+    first = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    second = bytes[4] | (bytes[5] << 8) | (bytes[6] << 16);
+}
+
+bool LogHandler::formatBinary(const BinaryLogRecord& record, char* out, size_t size) {
+    if (size == 0) return false;
+    out[0] = '\0';
+    if (record.format == 0 || record.format >= (uint16_t)LogFormat::COUNT) {
+        snprintf(out, size, "Unknown log format %u", (unsigned)record.format);
+        return false;
+    }
+
+    size_t pos = 0;
+    uint8_t arg = 0;
+    auto next = [&]() -> uint32_t { return arg < record.argCount ? record.args[arg++] : 0; };
+    for (const char* c = BINARY_FORMATS[record.format].text; *c && pos + 1 < size; c++) {
+        if (*c != '%' || !c[1]) {
+            out[pos++] = *c;
+            continue;
         }
-        logQueue.push({typeStr, time, message});
+        c++;
+        int written = 0;
+        switch (*c) {
+            case 'u': written = snprintf(&out[pos], size - pos, "%lu", (unsigned long)next()); break;
+            case 'd': written = snprintf(&out[pos], size - pos, "%ld", (long)(int32_t)next()); break;
+            case 'x': written = snprintf(&out[pos], size - pos, "%lx", (unsigned long)next()); break;
+            case 'L': {
+                uint32_t first = next();
+                uint32_t second = next();
+                uint8_t pids[6] = {(uint8_t)(first >> 8), (uint8_t)(first >> 16), (uint8_t)(first >> 24),
+                                   (uint8_t)second, (uint8_t)(second >> 8), (uint8_t)(second >> 16)};
+                uint8_t count = (first & 0xFF) < 6 ? (first & 0xFF) : 6;
+                for (uint8_t i = 0; i < count && pos + written + 1 < size; i++) {
+                    written += snprintf(&out[pos + written], size - pos - written, i ? ", %x" : "%x", pids[i]);
+                }
+                break;
+            }
+            default: out[pos++] = *c; break;
+        }
+        if (written > 0) pos += written;
+        if (pos >= size) pos = size - 1;
+    }
+    out[pos] = '\0';
+    return true;
+}
+
+LogHandler::DebugType LogHandler::binaryType(uint16_t format) {
+    return format < (uint16_t)LogFormat::COUNT ? BINARY_FORMATS[format].type : DebugType::INFO;
+}
+
+void LogHandler::expandBinary(const BinaryLogRecord& binary, LogRecord& record) {
+    // Binary records only carry uptime, anchor them to the current wall clock
+    uint64_t nowMs = getTimeMs();
+    uint32_t age = millis() - binary.uptimeMs;
+    record.epochMs = nowMs > age ? nowMs - age : 0;
+    record.uptimeMs = binary.uptimeMs;
+    record.type = binaryType(binary.format);
+    formatBinary(binary, record.message, sizeof(record.message));
+}
+
+template <size_t N>
+bool LogHandler::popOldest(BoundedQueue<LogRecord, N>& text, BoundedQueue<BinaryLogRecord, BINARY_QUEUE_SIZE>& binary, LogRecord& record) {
+    BinaryLogRecord nextBinary;
+    bool hasBinary = binary.peek(nextBinary);
+    bool hasText = text.peek(record);
+    if (!hasBinary && !hasText) return false;
+
+    // Signed difference keeps the order across a millis() wrap
+    if (hasText && (!hasBinary || (int32_t)(record.uptimeMs - nextBinary.uptimeMs) <= 0)) {
+        return text.pop(record);
+    }
+    if (!binary.pop(nextBinary)) return false;
+    expandBinary(nextBinary, record);
+    return true;
+}
+
+void LogHandler::flush() {
+    // Formatted on the stack: draining allocates nothing per line
+    LogRecord record;
+    char line[LogRecord::MAX_MESSAGE + 48];
+    while (popOldest(outputQueue, binaryQueue, record)) {
+        writeSinks(line, formatLine(record, line, sizeof(line)));
+    }
+
+    unsigned long dropped = outputQueue.getDropped() + binaryQueue.getDropped();
+    if (dropped != reportedDrops) {
+        int length = snprintf(line, sizeof(line), "[WARNING] %lu log messages dropped, output too slow", dropped - reportedDrops);
+        reportedDrops = dropped;
+        writeSinks(line, length > 0 ? (size_t)length : 0);
     }
+}
+
+void LogHandler::writeSinks(const char* line, size_t length) {
+    for (size_t i = 0; i < sinkCount; i++) {
+        sinks[i]->write(line, length);
+    }
+}
+
+const char* LogHandler::typeName(DebugType type) {
+    switch (type) {
+        case DebugType::INFO: return "INFO";
+        case DebugType::WARNING: return "WARNING";
+        case DebugType::ERROR: return "ERROR";
+        case DebugType::BLE: return "BLE";
+        case DebugType::CAN: return "CAN";
+        default: return "INFO";
+    }
+}
+
+size_t LogHandler::formatLine(const LogRecord& record, char* out, size_t size) {
     // Print timestamp in human-readable format
     char timeStr[32] = {0};
-    time_t now = getTime();
-    if (now != 0) {
+    time_t seconds = record.epochMs / 1000;
+    if (seconds != 0) {
         struct tm timeinfo;
-        localtime_r(&now, &timeinfo);
+        localtime_r(&seconds, &timeinfo);
         strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
-        Serial.println("[" + typeStr + "] [" + String(timeStr) + "] " + message);
     } else {
-        Serial.println("[" + typeStr + "] [NO TIME] " + message);
+        strcpy(timeStr, "NO TIME");
     }
+    int length = snprintf(out, size, "[%s] [%s] %s", typeName(record.type), timeStr, record.message);
+    if (length < 0) return 0;
+    return (size_t)length < size ? (size_t)length : size - 1;
 }
 
 std::vector<LogHandler::LogEntry> LogHandler::getAndClearLogs() {
     std::vector<LogEntry> logs;
-    while (!logQueue.empty()) {
-        logs.push_back(logQueue.front());
-        logQueue.pop();
+    LogRecord record;
+    while (popOldest(uploadQueue, binaryUploadQueue, record)) {
+        // Before NTP sync the entry carries -millis(), fixed up by groupLogs()
+        long timestamp = record.epochMs ? (long)(record.epochMs / 1000) : -(long)record.uptimeMs;
+        logs.push_back({typeName(record.type), timestamp, record.message});
     }
     return logs;
 }
+
+LogHandler::Stats LogHandler::getStats() {
+    return {written, outputQueue.getDropped() + binaryQueue.getDropped(), uploadQueue.getDropped() + binaryUploadQueue.getDropped(), truncated};
+}
+
+void LogHandler::groupLogs(std::vector<LogHandler::LogEntry>& entries, std::map<String, std::map<long, String>>& grouped) {
+    unsigned long nowSeconds = getTime();
+    unsigned long nowMillis = millis();
+    for (auto& entry : entries) {
+        if (entry.timestamp <= 0) {
+            // Queued before NTP sync with -millis(), convert to epoch seconds
+            entry.timestamp = nowSeconds - ((nowMillis + entry.timestamp) / 1000);
+        }
+        String& combined = grouped[entry.path.isEmpty() ? "default" : entry.path][entry.timestamp];
+        if (!combined.isEmpty()) combined += "; ";
+        combined += entry.message;
+    }
+}
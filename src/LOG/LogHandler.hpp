@@ -2,9 +2,29 @@
 #define DEBUG_HANDLER_HPP
 
 #include <Arduino.h>
-#include <queue>
+#include <atomic>
+#include <map>
 #include <vector>
 
+#include "../HAL/Clock.hpp"
+#include "../HAL/LogSink.hpp"
+#include "LogFormat.hpp"
+#include "../SETTINGS/SettingsHandler.hpp"
+#include "../UTILS/BoundedQueue.hpp"
+
+// Lowest level compiled in, e.g. -DLOG_LEVEL=1 (SettingsHandler::LOG_LEVEL_INFO)
+// drops all CAN/BLE traffic messages from the build
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 0
+#endif
+
+// Builds the message only if its type passes the compile-time and runtime
+// level; use on hot paths instead of calling writeMessage() directly
+#define LOG_MESSAGE(type, ...) \
+    do { \
+        if (LogHandler::isEnabled(type)) LogHandler::writeMessage(type, __VA_ARGS__); \
+    } while (0)
+
 class LogHandler {
 public:
     enum class DebugType {
@@ -21,11 +41,94 @@ public:
         String message;
     };
 
+    // Fixed-size queue entry, messages longer than MAX_MESSAGE are truncated
+    struct LogRecord {
+        static constexpr size_t MAX_MESSAGE = 120;
+
+        uint64_t epochMs;   // 0 before NTP sync
+        uint32_t uptimeMs;
+        DebugType type;
+        char message[MAX_MESSAGE];
+    };
+
+    struct Stats {
+        unsigned long written;        // Messages that passed the level filter
+        unsigned long dropped;        // Lost because the output queue was full
+        unsigned long uploadDropped;  // Lost because the upload queue was full
+        unsigned long truncated;
+    };
+
+    static constexpr size_t OUTPUT_QUEUE_SIZE = 32;
+    static constexpr size_t UPLOAD_QUEUE_SIZE = 64;
+    static constexpr size_t BINARY_QUEUE_SIZE = 64; // Binary records are 24 bytes instead of ~140
+
+    static void setClock(Clock* clock);
+    static void addSink(LogSink* sink);
+    // Starts the low priority task that writes queued messages to the sinks
+    static void begin();
+    // Writes all queued messages to the sinks on the calling task
+    static void flush();
+
+    static constexpr int levelOf(DebugType type) {
+        return type == DebugType::ERROR ? SettingsHandler::LOG_LEVEL_ERROR
+             : type == DebugType::WARNING ? SettingsHandler::LOG_LEVEL_WARNING
+             : type == DebugType::INFO ? SettingsHandler::LOG_LEVEL_INFO
+             : SettingsHandler::LOG_LEVEL_DEBUG;
+    }
+    static bool isEnabled(DebugType type) {
+        return levelOf(type) >= LOG_LEVEL && levelOf(type) >= SettingsHandler::getLogLevel();
+    }
+
     static unsigned long getTime();
+    static uint64_t getTimeMs(); // Epoch milliseconds, 0 until NTP sync
+    // Never blocks on output: the message is copied into the queues and
+    // written by the drain task
     static void writeMessage(LogHandler::DebugType type, const String& message, bool sendToFirebase = true);
-    static void sendLogMessage(const String& path, const String& message);
+    static void writeMessage(LogHandler::DebugType type, const char* message, bool sendToFirebase = true);
+    // Records a fixed template with raw arguments; nothing is formatted
+    // until the record is drained
+    static void writeBinary(LogFormat format, uint8_t argCount, const uint32_t* args);
+    template <typename... Args>
+    static void writeBinary(LogFormat format, Args... args) {
+        const uint32_t values[] = {(uint32_t)args...};
+        writeBinary(format, (uint8_t)sizeof...(Args), values);
+    }
+    // Packs up to six PIDs into the two arguments a %L placeholder takes
+    static void packPids(const uint8_t* pids, uint8_t count, uint32_t& first, uint32_t& second);
+    // Message text of a binary record, false for an unknown format ID
+    static bool formatBinary(const BinaryLogRecord& record, char* out, size_t size);
+    static DebugType binaryType(uint16_t format);
+    static const char* typeName(DebugType type);
+
     static std::vector<LogHandler::LogEntry> getAndClearLogs();
-    static std::queue<LogHandler::LogEntry> logQueue;
+    // Fixes the timestamps of entries queued before NTP sync, then joins the
+    // messages per path and second: grouped[path][timestamp] = "a; b"
+    static void groupLogs(std::vector<LogHandler::LogEntry>& entries, std::map<String, std::map<long, String>>& grouped);
+    static Stats getStats();
+
+private:
+    static constexpr size_t MAX_SINKS = 4;
+    static constexpr unsigned long DRAIN_INTERVAL_MS = 20;
+
+    static void drainTask(void*);
+    // "[TYPE] [time] message" into out, returns its length
+    static size_t formatLine(const LogRecord& record, char* out, size_t size);
+    static void writeSinks(const char* line, size_t length);
+    // Takes the older of the next text and binary record, binary ones formatted
+    template <size_t N>
+    static bool popOldest(BoundedQueue<LogRecord, N>& text, BoundedQueue<BinaryLogRecord, BINARY_QUEUE_SIZE>& binary, LogRecord& record);
+    static void expandBinary(const BinaryLogRecord& binary, LogRecord& record);
+
+    static Clock* clock;
+    static LogSink* sinks[MAX_SINKS];
+    static size_t sinkCount;
+    static BoundedQueue<LogRecord, OUTPUT_QUEUE_SIZE> outputQueue;
+    static BoundedQueue<LogRecord, UPLOAD_QUEUE_SIZE> uploadQueue;
+    static BoundedQueue<BinaryLogRecord, BINARY_QUEUE_SIZE> binaryQueue;
+    static BoundedQueue<BinaryLogRecord, BINARY_QUEUE_SIZE> binaryUploadQueue;
+    static std::atomic<unsigned long> written;
+    static std::atomic<unsigned long> truncated;
+    static unsigned long reportedDrops; // Drain task only
 };
 
 #endif // DEBUG_HANDLER_HPP
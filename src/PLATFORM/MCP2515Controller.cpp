@@ -0,0 +1,56 @@
+#include "MCP2515Controller.hpp"
+
+MCP2515Controller::MCP2515Controller(int csPin) : can(csPin), csPin(csPin) {}
+
+bool MCP2515Controller::begin() {
+    // MCP_STDEXT enables the acceptance masks and filters
+    if (can.begin(MCP_STDEXT, CAN_500KBPS, MCP_8MHZ) != CAN_OK) return false;
+    can.setMode(MCP_NORMAL);
+    return true;
+}
+
+// Standard IDs sit in the upper 16 bits; the lower bits would match data bytes
+bool MCP2515Controller::setMask(uint8_t index, uint32_t mask) {
+    return can.init_Mask(index, 0, mask << 16) == CAN_OK;
+}
+
+bool MCP2515Controller::setFilter(uint8_t index, uint32_t id) {
+    return can.init_Filt(index, 0, id << 16) == CAN_OK;
+}
+
+bool MCP2515Controller::send(uint32_t id, const uint8_t* data, uint8_t len) {
+    return can.sendMsgBuf(id, 0, len, const_cast<uint8_t*>(data)) == CAN_OK;
+}
+
+bool MCP2515Controller::receive(CANFrame& frame) {
+    if (can.checkReceive() != CAN_MSGAVAIL) return false;
+    unsigned long rxId;
+    can.readMsgBuf(&rxId, &frame.len, frame.data);
+    frame.id = rxId;
+    return true;
+}
+
+bool MCP2515Controller::readErrorState(ErrorState& state) {
+    uint8_t flags = can.getError();
+    state.txErrors = can.errorCountTX();
+    state.rxErrors = can.errorCountRX();
+    state.errorWarning = flags & MCP_EFLG_EWARN;
+    state.errorPassive = flags & (MCP_EFLG_TXEP | MCP_EFLG_RXEP);
+    state.busOff = flags & MCP_EFLG_TXBO;
+    state.rxOverflow = flags & (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR);
+    if (state.rxOverflow) clearOverflowFlags();
+    return true;
+}
+
+// The overflow bits stay set until cleared and mcp_can has no call for it:
+// BIT MODIFY (0x05) on EFLG (0x2D)
+void MCP2515Controller::clearOverflowFlags() {
+    SPI.beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(csPin, LOW);
+    SPI.transfer(0x05);
+    SPI.transfer(0x2D);
+    SPI.transfer(MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR);
+    SPI.transfer(0x00);
+    digitalWrite(csPin, HIGH);
+    SPI.endTransaction();
+}
@@ -0,0 +1,28 @@
+#ifndef MCP2515_CONTROLLER_HPP
+#define MCP2515_CONTROLLER_HPP
+
+#include <SPI.h>
+#include <mcp_can.h>
+
+#include "../HAL/CANController.hpp"
+
+// MCP2515 on SPI with an 8 MHz crystal
+class MCP2515Controller : public CANController {
+public:
+    explicit MCP2515Controller(int csPin);
+
+    bool begin() override;
+    bool setMask(uint8_t index, uint32_t mask) override;
+    bool setFilter(uint8_t index, uint32_t id) override;
+    bool send(uint32_t id, const uint8_t* data, uint8_t len) override;
+    bool receive(CANFrame& frame) override;
+    bool readErrorState(ErrorState& state) override;
+
+private:
+    void clearOverflowFlags();
+
+    MCP_CAN can;
+    int csPin;
+};
+
+#endif // MCP2515_CONTROLLER_HPP
@@ -0,0 +1,11 @@
+#ifndef SERIAL_LOG_SINK_HPP
+#define SERIAL_LOG_SINK_HPP
+
+#include "../HAL/LogSink.hpp"
+
+class SerialLogSink : public LogSink {
+public:
+    void write(const char* line, size_t) override { Serial.println(line); }
+};
+
+#endif // SERIAL_LOG_SINK_HPP
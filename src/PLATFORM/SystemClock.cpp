@@ -0,0 +1,25 @@
+#include "SystemClock.hpp"
+
+#include <Arduino.h>
+#include <sys/time.h>
+#include <time.h>
+
+unsigned long SystemClock::millis() {
+    return ::millis();
+}
+
+unsigned long SystemClock::micros() {
+    return ::micros();
+}
+
+uint64_t SystemClock::epochMs() {
+    struct tm timeinfo;
+    // Zero timeout: before NTP sync getLocalTime would otherwise block for 5 s
+    if (!getLocalTime(&timeinfo, 0) || timeinfo.tm_year < (2020 - 1900)) {
+        // Time not set or invalid
+        return 0;
+    }
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
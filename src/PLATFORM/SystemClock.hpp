@@ -0,0 +1,14 @@
+#ifndef SYSTEM_CLOCK_HPP
+#define SYSTEM_CLOCK_HPP
+
+#include "../HAL/Clock.hpp"
+
+// Arduino millis()/micros() and the NTP synced system time
+class SystemClock : public Clock {
+public:
+    unsigned long millis() override;
+    unsigned long micros() override;
+    uint64_t epochMs() override;
+};
+
+#endif // SYSTEM_CLOCK_HPP
@@ -0,0 +1,123 @@
+#include "TelnetLogSink.hpp"
+
+#include <errno.h>
+#include <lwip/sockets.h>
+
+void TelnetLogSink::begin() {
+    server.begin();
+    server.setNoDelay(true);
+}
+
+void TelnetLogSink::handle() {
+    std::lock_guard<std::mutex> lock(mutex);
+    accept();
+    for (Client& client : clients) {
+        if (!client.active) continue;
+        if (!client.socket.connected()) {
+            disconnect(client);
+            continue;
+        }
+        readCommands(client);
+        send(client);
+    }
+}
+
+void TelnetLogSink::accept() {
+    if (!server.hasClient()) return;
+    WiFiClient socket = server.available();
+    for (Client& client : clients) {
+        if (client.active) continue;
+        client.socket = socket;
+        client.output.clear();
+        client.commandLength = 0;
+        client.samples = false;
+        client.active = true;
+        stats.connections++;
+        const char* greeting = "Connected, type \"samples on\" for the live sample feed";
+        push(client, greeting, strlen(greeting));
+        return;
+    }
+    stats.rejected++;
+    socket.stop();
+}
+
+void TelnetLogSink::readCommands(Client& client) {
+    while (client.socket.available() > 0) {
+        int c = client.socket.read();
+        if (c < 0) break;
+        if (c != '\r' && c != '\n') {
+            if (client.commandLength < sizeof(client.command) - 1) client.command[client.commandLength++] = (char)c;
+            continue;
+        }
+        if (client.commandLength == 0) continue;
+        client.command[client.commandLength] = '\0';
+        client.commandLength = 0;
+
+        const char* reply;
+        if (strcmp(client.command, "samples on") == 0) {
+            client.samples = true;
+            reply = "Sample feed on";
+        } else if (strcmp(client.command, "samples off") == 0) {
+            client.samples = false;
+            reply = "Sample feed off";
+        } else {
+            reply = "Commands: samples on, samples off";
+        }
+        push(client, reply, strlen(reply));
+    }
+}
+
+void TelnetLogSink::send(Client& client) {
+    // MSG_DONTWAIT: take what fits the socket's send buffer, the rest
+    // waits for the next call
+    const char* data;
+    size_t len;
+    while ((len = client.output.peek(data)) > 0) {
+        int sent = ::send(client.socket.fd(), data, len, MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) disconnect(client);
+            return;
+        }
+        client.output.consume(sent);
+        stats.bytesSent += sent;
+        if ((size_t)sent < len) return;
+    }
+}
+
+void TelnetLogSink::disconnect(Client& client) {
+    client.socket.stop();
+    client.output.clear();
+    client.active = false;
+}
+
+void TelnetLogSink::push(Client& client, const char* line, size_t len) {
+    if (!client.output.push(line, len)) stats.droppedLines++;
+}
+
+void TelnetLogSink::write(const char* line, size_t length) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Client& client : clients) {
+        if (client.active) push(client, line, length);
+    }
+}
+
+void TelnetLogSink::writeSample(const char* line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t len = strlen(line);
+    for (Client& client : clients) {
+        if (client.active && client.samples) push(client, line, len);
+    }
+}
+
+bool TelnetLogSink::hasSampleClients() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Client& client : clients) {
+        if (client.active && client.samples) return true;
+    }
+    return false;
+}
+
+TelnetLogSink::Stats TelnetLogSink::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,56 @@
+#ifndef TELNET_LOG_SINK_HPP
+#define TELNET_LOG_SINK_HPP
+
+#include <WiFi.h>
+#include <mutex>
+
+#include "../HAL/LogSink.hpp"
+#include "../UTILS/LineBuffer.hpp"
+
+// Streams log lines, and the live sample feed to clients that typed
+// "samples on", over telnet. Lines go to a per-client buffer and handle()
+// sends what the socket takes without waiting; a client that falls behind
+// loses whole lines, it never stalls the caller.
+class TelnetLogSink : public LogSink {
+public:
+    struct Stats {
+        unsigned long connections;
+        unsigned long rejected;     // Clients over MAX_CLIENTS
+        unsigned long bytesSent;
+        unsigned long droppedLines; // Lines that did not fit a client buffer
+    };
+
+    static constexpr uint16_t PORT = 23;
+    static constexpr size_t MAX_CLIENTS = 2;
+    static constexpr size_t CLIENT_BUFFER_SIZE = 4096;
+
+    void begin();  // Starts listening; clients can connect once WiFi is up
+    void handle(); // Accepts clients, reads commands and sends buffered output
+    void write(const char* line, size_t length) override;
+    void writeSample(const char* line); // Only to clients with the sample feed on
+    bool hasSampleClients();
+    Stats getStats();
+
+private:
+    struct Client {
+        WiFiClient socket;
+        LineBuffer<CLIENT_BUFFER_SIZE> output;
+        char command[32];
+        size_t commandLength = 0;
+        bool samples = false;
+        bool active = false;
+    };
+
+    void accept();
+    void readCommands(Client& client);
+    void send(Client& client);
+    void disconnect(Client& client);
+    void push(Client& client, const char* line, size_t len);
+
+    WiFiServer server{PORT};
+    Client clients[MAX_CLIENTS];
+    std::mutex mutex; // write() runs on the log drain task
+    Stats stats = {};
+};
+
+#endif // TELNET_LOG_SINK_HPP
@@ -0,0 +1,113 @@
+#include "LoopProfiler.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef ESP32
+#include <chrono>
+#endif
+
+LoopProfiler::Histogram LoopProfiler::histograms[(size_t)Stage::COUNT];
+
+uint32_t LoopProfiler::ticks() {
+#ifdef ESP32
+    return ESP.getCycleCount();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void LoopProfiler::record(Stage stage, uint32_t elapsedTicks) {
+#ifdef ESP32
+    uint32_t us = elapsedTicks / ESP.getCpuFreqMHz();
+#else
+    uint32_t us = elapsedTicks / 1000;
+#endif
+    Histogram& histogram = histograms[(size_t)stage];
+    if (histogram.resetRequested.exchange(false)) clear(histogram);
+
+    histogram.buckets[bucketOf(us)]++;
+    if (histogram.count == 0 || us < histogram.minUs) histogram.minUs = us;
+    if (us > histogram.maxUs) histogram.maxUs = us;
+    histogram.count++;
+}
+
+size_t LoopProfiler::bucketOf(uint32_t us) {
+    if (us < 4) return us;
+    int octave = 31 - __builtin_clz(us);
+    size_t bucket = 4 + (octave - 2) * 4 + ((us >> (octave - 2)) & 3);
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint32_t LoopProfiler::bucketUpperBound(size_t bucket) {
+    if (bucket < 4) return bucket;
+    int shift = (bucket - 4) / 4;
+    uint32_t lower = (4 + (bucket - 4) % 4) << shift;
+    return lower + (1UL << shift) - 1;
+}
+
+uint32_t LoopProfiler::percentile(const Histogram& histogram, uint32_t count, uint32_t permille) {
+    uint32_t rank = (uint64_t)count * permille / 1000;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += histogram.buckets[i];
+        if (seen > rank) return bucketUpperBound(i) < histogram.maxUs ? bucketUpperBound(i) : histogram.maxUs;
+    }
+    return histogram.maxUs;
+}
+
+void LoopProfiler::clear(Histogram& histogram) {
+    memset(histogram.buckets, 0, sizeof(histogram.buckets));
+    histogram.count = histogram.minUs = histogram.maxUs = 0;
+}
+
+LoopProfiler::Summary LoopProfiler::summarize(Stage stage) {
+    const Histogram& histogram = histograms[(size_t)stage];
+    if (histogram.resetRequested) return {};
+    // Read while the owning task may record; off by a sample at most
+    uint32_t count = histogram.count;
+    return {count, histogram.minUs, histogram.maxUs, percentile(histogram, count, 500), percentile(histogram, count, 990)};
+}
+
+const char* LoopProfiler::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::CAN_SEND: return "can_send";
+        case Stage::CAN_RECEIVE: return "can_receive";
+        case Stage::ACQUISITION_LOOP: return "acquisition_loop";
+        case Stage::CONNECTION: return "connection";
+        case Stage::BLE: return "ble";
+        case Stage::TELNET: return "telnet";
+        case Stage::UPLOAD: return "upload";
+        case Stage::FIREBASE_READ: return "firebase_read";
+        case Stage::LOG_UPLOAD: return "log_upload";
+        case Stage::UPLINK_LOOP: return "uplink_loop";
+        default: return "unknown";
+    }
+}
+
+String LoopProfiler::toJson() {
+    String json = "{";
+    char entry[128];
+    for (size_t i = 0; i < (size_t)Stage::COUNT; i++) {
+        Summary summary = summarize((Stage)i);
+        if (summary.count == 0) continue;
+        snprintf(entry, sizeof(entry), "%s\"%s\":{\"count\":%lu,\"min_us\":%lu,\"max_us\":%lu,\"p50_us\":%lu,\"p99_us\":%lu}",
+                 json.length() > 1 ? "," : "", stageName((Stage)i), (unsigned long)summary.count, (unsigned long)summary.minUs,
+                 (unsigned long)summary.maxUs, (unsigned long)summary.p50Us, (unsigned long)summary.p99Us);
+        json += entry;
+    }
+    json += "}";
+    return json;
+}
+
+String LoopProfiler::describe(Stage stage) {
+    Summary summary = summarize(stage);
+    char line[96];
+    snprintf(line, sizeof(line), "%s: %lu, %lu/%lu/%lu/%lu us", stageName(stage), (unsigned long)summary.count, (unsigned long)summary.minUs,
+             (unsigned long)summary.p50Us, (unsigned long)summary.p99Us, (unsigned long)summary.maxUs);
+    return String(line);
+}
+
+void LoopProfiler::reset() {
+    for (Histogram& histogram : histograms) histogram.resetRequested = true;
+}
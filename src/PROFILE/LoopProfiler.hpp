@@ -0,0 +1,83 @@
+#ifndef LOOP_PROFILER_HPP
+#define LOOP_PROFILER_HPP
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdint.h>
+
+// Times the stages of the task loops into fixed size latency histograms.
+// Time is taken from the CPU cycle counter on the ESP32 and steady_clock on
+// the host. Each stage must only be recorded from one task; summaries can be
+// read from any task.
+#define PROFILE_SCOPE(stage) PROFILE_SCOPE_AT(stage, __LINE__)
+#define PROFILE_SCOPE_AT(stage, line) PROFILE_SCOPE_LINE(stage, line)
+#define PROFILE_SCOPE_LINE(stage, line) LoopProfiler::Scope profileScope##line(LoopProfiler::Stage::stage)
+
+class LoopProfiler {
+public:
+    enum class Stage : uint8_t {
+        CAN_SEND,          // canHandler.sendRequests()
+        CAN_RECEIVE,       // canHandler.handleResponses()
+        ACQUISITION_LOOP,  // One acquisition task iteration
+        CONNECTION,        // connectionHandler.handle()
+        BLE,
+        TELNET,
+        UPLOAD,            // Sample decoding and uploadHandler.sendData()
+        FIREBASE_READ,
+        LOG_UPLOAD,
+        UPLINK_LOOP,       // One uplink task iteration
+        COUNT
+    };
+
+    struct Summary {
+        uint32_t count; // Since the last reset
+        uint32_t minUs;
+        uint32_t maxUs;
+        uint32_t p50Us; // Percentiles are bucket upper bounds, within 25%
+        uint32_t p99Us;
+    };
+
+    class Scope {
+    public:
+        explicit Scope(Stage stage) : stage(stage), start(ticks()) {}
+        ~Scope() { record(stage, ticks() - start); }
+
+    private:
+        Stage stage;
+        uint32_t start;
+    };
+
+    static uint32_t ticks(); // Cycles on the ESP32, nanoseconds on the host
+    static void record(Stage stage, uint32_t elapsedTicks);
+
+    static Summary summarize(Stage stage);
+    static const char* stageName(Stage stage);
+    // {"<stage>": {"count": n, "min_us": .., "max_us": .., "p50_us": .., "p99_us": ..}, ...}
+    // for the stages recorded since the last reset
+    static String toJson();
+    // "<stage>: n, min/p50/p99/max us" for one stage
+    static String describe(Stage stage);
+    // Starts a new window; each stage clears itself on its next record()
+    static void reset();
+
+private:
+    // Four buckets per power of two microseconds, 0 us to ~16 s
+    static constexpr size_t BUCKETS = 92;
+
+    struct Histogram {
+        uint32_t buckets[BUCKETS];
+        uint32_t count;
+        uint32_t minUs;
+        uint32_t maxUs;
+        std::atomic<bool> resetRequested;
+    };
+
+    static size_t bucketOf(uint32_t us);
+    static uint32_t bucketUpperBound(size_t bucket);
+    static uint32_t percentile(const Histogram& histogram, uint32_t count, uint32_t permille);
+    static void clear(Histogram& histogram);
+
+    static Histogram histograms[(size_t)Stage::COUNT];
+};
+
+#endif // LOOP_PROFILER_HPP
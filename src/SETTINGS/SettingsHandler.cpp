@@ -4,6 +4,12 @@
 int SettingsHandler::canRequestInterval = SettingsHandler::DEFAULT_CAN_REQUEST_INTERVAL;
 int SettingsHandler::canResponseThreshold = SettingsHandler::DEFAULT_CAN_RESPONSE_THRESHOLD;
 bool SettingsHandler::enableLogs = SettingsHandler::DEFAULT_ENABLE_LOGS;
+int SettingsHandler::isoTpBlockSize = SettingsHandler::DEFAULT_ISOTP_BLOCK_SIZE;
+int SettingsHandler::isoTpStMin = SettingsHandler::DEFAULT_ISOTP_STMIN;
+int SettingsHandler::uploadBatchSize = SettingsHandler::DEFAULT_UPLOAD_BATCH_SIZE;
+int SettingsHandler::uploadBatchAge = SettingsHandler::DEFAULT_UPLOAD_BATCH_AGE;
+int SettingsHandler::uploadFormat = SettingsHandler::DEFAULT_UPLOAD_FORMAT;
+int SettingsHandler::logLevel = SettingsHandler::DEFAULT_LOG_LEVEL;
 
 int SettingsHandler::getCanRequestInterval() {
     return canRequestInterval;
@@ -17,6 +23,30 @@ bool SettingsHandler::getEnableLogs() {
     return enableLogs;
 }
 
+int SettingsHandler::getIsoTpBlockSize() {
+    return isoTpBlockSize;
+}
+
+int SettingsHandler::getIsoTpStMin() {
+    return isoTpStMin;
+}
+
+int SettingsHandler::getUploadBatchSize() {
+    return uploadBatchSize;
+}
+
+int SettingsHandler::getUploadBatchAge() {
+    return uploadBatchAge;
+}
+
+int SettingsHandler::getUploadFormat() {
+    return uploadFormat;
+}
+
+int SettingsHandler::getLogLevel() {
+    return logLevel;
+}
+
 void SettingsHandler::setCanRequestInterval(int value) {
     canRequestInterval = value;
 }
@@ -29,6 +59,30 @@ void SettingsHandler::setEnableLogs(bool value) {
     enableLogs = value;
 }
 
+void SettingsHandler::setIsoTpBlockSize(int value) {
+    isoTpBlockSize = constrain(value, 0, 255);
+}
+
+void SettingsHandler::setIsoTpStMin(int value) {
+    isoTpStMin = constrain(value, 0, 255);
+}
+
+void SettingsHandler::setUploadBatchSize(int value) {
+    uploadBatchSize = constrain(value, 1, MAX_UPLOAD_BATCH_SIZE);
+}
+
+void SettingsHandler::setUploadBatchAge(int value) {
+    uploadBatchAge = constrain(value, 100, 600000);
+}
+
+void SettingsHandler::setUploadFormat(int value) {
+    uploadFormat = constrain(value, UPLOAD_FORMAT_JSON, UPLOAD_FORMAT_COMPACT);
+}
+
+void SettingsHandler::setLogLevel(int value) {
+    logLevel = constrain(value, LOG_LEVEL_DEBUG, LOG_LEVEL_NONE);
+}
+
 void SettingsHandler::load() {
     // TODO: Implement loading from EEPROM, file, etc.
     // For now, just use defaults
@@ -43,4 +97,10 @@ void SettingsHandler::reset() {
     canRequestInterval = DEFAULT_CAN_REQUEST_INTERVAL;
     canResponseThreshold = DEFAULT_CAN_RESPONSE_THRESHOLD;
     enableLogs = DEFAULT_ENABLE_LOGS;
+    isoTpBlockSize = DEFAULT_ISOTP_BLOCK_SIZE;
+    isoTpStMin = DEFAULT_ISOTP_STMIN;
+    uploadBatchSize = DEFAULT_UPLOAD_BATCH_SIZE;
+    uploadBatchAge = DEFAULT_UPLOAD_BATCH_AGE;
+    uploadFormat = DEFAULT_UPLOAD_FORMAT;
+    logLevel = DEFAULT_LOG_LEVEL;
 }
\ No newline at end of file
@@ -8,16 +8,42 @@ public:
     static constexpr int DEFAULT_CAN_REQUEST_INTERVAL = 5000;
     static constexpr int DEFAULT_CAN_RESPONSE_THRESHOLD = 20000;
     static constexpr bool DEFAULT_ENABLE_LOGS = false;
+    static constexpr int DEFAULT_ISOTP_BLOCK_SIZE = 0; // 0 = ECU sends all consecutive frames at once
+    static constexpr int DEFAULT_ISOTP_STMIN = 0;      // Minimum gap between consecutive frames (ISO-TP encoding)
+    static constexpr int DEFAULT_UPLOAD_BATCH_SIZE = 100;  // Samples per upload
+    static constexpr int DEFAULT_UPLOAD_BATCH_AGE = 5000;  // Oldest sample age that forces an upload, ms
+    static constexpr int MAX_UPLOAD_BATCH_SIZE = 500;
+    static constexpr int UPLOAD_FORMAT_JSON = 0;     // readings/<ms>/<label> = value
+    static constexpr int UPLOAD_FORMAT_COMPACT = 1;  // batches/<ms> = base64 columnar batch
+    static constexpr int DEFAULT_UPLOAD_FORMAT = UPLOAD_FORMAT_JSON;
+    static constexpr int LOG_LEVEL_DEBUG = 0;   // Everything, including per request CAN/BLE traffic
+    static constexpr int LOG_LEVEL_INFO = 1;
+    static constexpr int LOG_LEVEL_WARNING = 2;
+    static constexpr int LOG_LEVEL_ERROR = 3;
+    static constexpr int LOG_LEVEL_NONE = 4;
+    static constexpr int DEFAULT_LOG_LEVEL = LOG_LEVEL_DEBUG;
 
     // Getters
     static int getCanRequestInterval();
     static int getCanResponseThreshold();
     static bool getEnableLogs();
+    static int getIsoTpBlockSize();
+    static int getIsoTpStMin();
+    static int getUploadBatchSize();
+    static int getUploadBatchAge();
+    static int getUploadFormat();
+    static int getLogLevel();
 
     // Setters
     static void setCanRequestInterval(int value);
     static void setCanResponseThreshold(int value);
     static void setEnableLogs(bool value);
+    static void setIsoTpBlockSize(int value);
+    static void setIsoTpStMin(int value);
+    static void setUploadBatchSize(int value);
+    static void setUploadBatchAge(int value);
+    static void setUploadFormat(int value);
+    static void setLogLevel(int value);
 
     // Persistence
     static void load();
@@ -28,6 +54,12 @@ private:
     static int canRequestInterval;
     static int canResponseThreshold;
     static bool enableLogs;
+    static int isoTpBlockSize;
+    static int isoTpStMin;
+    static int uploadBatchSize;
+    static int uploadBatchAge;
+    static int uploadFormat;
+    static int logLevel;
 };
 
 #endif // SETTINGS_HANDLER_HPP
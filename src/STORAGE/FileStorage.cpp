@@ -0,0 +1,115 @@
+#include "FileStorage.hpp"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static constexpr size_t PATH_SIZE = 64;
+
+FileStorage::FileStorage(const char* directory) : directory(directory) {}
+
+bool FileStorage::begin() {
+    mkdir(directory, 0755); // Fails harmlessly if it exists
+    DIR* dir = opendir(directory);
+    if (!dir) return false;
+    closedir(dir);
+    return true;
+}
+
+long FileStorage::size(const char* name) {
+    char filePath[PATH_SIZE];
+    path(name, filePath, sizeof(filePath));
+    struct stat info;
+    if (stat(filePath, &info) != 0) return -1;
+    return info.st_size;
+}
+
+size_t FileStorage::read(const char* name, size_t offset, void* data, size_t size) {
+    char filePath[PATH_SIZE];
+    path(name, filePath, sizeof(filePath));
+    FILE* file = fopen(filePath, "rb");
+    if (!file) return 0;
+    size_t result = 0;
+    if (fseek(file, (long)offset, SEEK_SET) == 0) {
+        result = fread(data, 1, size, file);
+    }
+    fclose(file);
+    return result;
+}
+
+bool FileStorage::append(const char* name, const void* data, size_t size) {
+    char filePath[PATH_SIZE];
+    path(name, filePath, sizeof(filePath));
+    FILE* file = fopen(filePath, "ab");
+    if (!file) return false;
+    size_t written = fwrite(data, 1, size, file);
+    fclose(file);
+    return written == size;
+}
+
+bool FileStorage::write(const char* name, const void* data, size_t size) {
+    char filePath[PATH_SIZE], tmpPath[PATH_SIZE + 4]; // + ".tmp"
+    path(name, filePath, sizeof(filePath));
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", filePath);
+
+    // Write and rename so a power cut never leaves a half written file
+    FILE* file = fopen(tmpPath, "wb");
+    if (!file) return false;
+    bool ok = fwrite(data, 1, size, file) == size;
+    fclose(file);
+    return ok && replace(tmpPath, filePath);
+}
+
+bool FileStorage::truncate(const char* name, size_t size) {
+    char filePath[PATH_SIZE], tmpPath[PATH_SIZE + 4]; // + ".tmp"
+    path(name, filePath, sizeof(filePath));
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", filePath);
+
+    // stdio has no truncate, copy the part that stays
+    FILE* in = fopen(filePath, "rb");
+    if (!in) return false;
+    FILE* out = fopen(tmpPath, "wb");
+    if (!out) {
+        fclose(in);
+        return false;
+    }
+    bool ok = true;
+    uint8_t buffer[128];
+    while (size > 0 && ok) {
+        size_t chunk = size < sizeof(buffer) ? size : sizeof(buffer);
+        ok = fread(buffer, 1, chunk, in) == chunk && fwrite(buffer, 1, chunk, out) == chunk;
+        size -= chunk;
+    }
+    fclose(in);
+    fclose(out);
+    return ok && replace(tmpPath, filePath);
+}
+
+bool FileStorage::remove(const char* name) {
+    char filePath[PATH_SIZE];
+    path(name, filePath, sizeof(filePath));
+    return ::remove(filePath) == 0;
+}
+
+void FileStorage::list(const std::function<void(const char* name)>& onFile) {
+    DIR* dir = opendir(directory);
+    if (!dir) return;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        onFile(entry->d_name);
+    }
+    closedir(dir);
+}
+
+void FileStorage::path(const char* name, char* out, size_t size) const {
+    snprintf(out, size, "%s/%s", directory, name);
+}
+
+bool FileStorage::replace(const char* tmpPath, const char* finalPath) {
+    if (rename(tmpPath, finalPath) == 0) return true;
+    // Some filesystems refuse to rename over an existing file
+    ::remove(finalPath);
+    return rename(tmpPath, finalPath) == 0;
+}
@@ -0,0 +1,29 @@
+#ifndef FILE_STORAGE_HPP
+#define FILE_STORAGE_HPP
+
+#include "../HAL/Storage.hpp"
+
+// Storage on a directory through stdio. On the device that directory sits on
+// the LittleFS VFS mount (mounted before begin()), on the host it is a plain
+// directory standing in for the flash partition.
+class FileStorage : public Storage {
+public:
+    explicit FileStorage(const char* directory);
+
+    bool begin() override; // Creates the directory
+    long size(const char* name) override;
+    size_t read(const char* name, size_t offset, void* data, size_t size) override;
+    bool append(const char* name, const void* data, size_t size) override;
+    bool write(const char* name, const void* data, size_t size) override;
+    bool truncate(const char* name, size_t size) override;
+    bool remove(const char* name) override;
+    void list(const std::function<void(const char* name)>& onFile) override;
+
+private:
+    void path(const char* name, char* out, size_t size) const;
+    bool replace(const char* tmpPath, const char* finalPath);
+
+    const char* directory;
+};
+
+#endif // FILE_STORAGE_HPP
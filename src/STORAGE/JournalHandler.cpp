@@ -0,0 +1,175 @@
+#include "JournalHandler.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../LOG/LogHandler.hpp"
+
+struct JournalCursor {
+    uint32_t segment;
+    uint32_t offset;
+};
+
+JournalHandler::JournalHandler(Storage& storage, uint32_t maxSegments)
+    : storage(storage), maxSegments(maxSegments < 2 ? 2 : maxSegments) {}
+
+bool JournalHandler::begin() {
+    if (!storage.begin()) {
+        LogHandler::writeMessage(LogHandler::DebugType::ERROR, String("Journal storage not available"));
+        return false;
+    }
+
+    // Segments are numbered consecutively, find the oldest and newest
+    bool found = false;
+    uint32_t minSegment = 0, maxSegment = 0;
+    storage.list([&](const char* name) {
+        const char* dot = strrchr(name, '.');
+        if (!dot || strcmp(dot, ".seg") != 0) return;
+        uint32_t segment = strtoul(name, nullptr, 10);
+        if (!found || segment < minSegment) minSegment = segment;
+        if (!found || segment > maxSegment) maxSegment = segment;
+        found = true;
+    });
+
+    firstSegment = lastSegment = minSegment;
+    readOffset = writeCount = 0;
+    if (found) {
+        lastSegment = maxSegment;
+        uint32_t segment, offset;
+        if (loadCursor(segment, offset) && segment >= minSegment && segment <= maxSegment) {
+            // Segments before the cursor were acknowledged but not yet deleted
+            while (firstSegment < segment) dropSegment();
+            readOffset = offset;
+        }
+        repairTail();
+        uint32_t firstCount = firstSegment == lastSegment ? writeCount : SEGMENT_RECORDS;
+        if (readOffset > firstCount) readOffset = firstCount;
+    }
+
+    ready = true;
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Journal ready, " + String((unsigned)pending()) + " records pending");
+    return true;
+}
+
+bool JournalHandler::append(const Record* records, size_t count) {
+    if (!ready) return false;
+
+    while (count > 0) {
+        if (writeCount == SEGMENT_RECORDS) {
+            lastSegment++;
+            writeCount = 0;
+            if (lastSegment - firstSegment + 1 > maxSegments) evictOldest();
+        }
+
+        size_t chunk = SEGMENT_RECORDS - writeCount;
+        if (chunk > count) chunk = count;
+
+        char name[16];
+        segmentName(lastSegment, name, sizeof(name));
+        if (!storage.append(name, records, chunk * sizeof(Record))) {
+            // Keep whatever whole records made it to flash before the failure
+            long size = storage.size(name);
+            uint32_t stored = size > 0 ? size / sizeof(Record) : 0;
+            if (size > 0 && size % sizeof(Record) != 0) storage.truncate(name, stored * sizeof(Record));
+            if (stored > writeCount) stats.appended += stored - writeCount;
+            writeCount = stored;
+            stats.writeErrors++;
+            return false;
+        }
+        writeCount += chunk;
+        stats.appended += chunk;
+        records += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+size_t JournalHandler::read(Record* out, size_t max) {
+    if (!ready || pending() == 0) return 0;
+
+    // Reads stay within the cursor's segment
+    uint32_t segmentEnd = firstSegment == lastSegment ? writeCount : SEGMENT_RECORDS;
+    size_t count = segmentEnd - readOffset;
+    if (count > max) count = max;
+
+    char name[16];
+    segmentName(firstSegment, name, sizeof(name));
+    return storage.read(name, readOffset * sizeof(Record), out, count * sizeof(Record)) / sizeof(Record);
+}
+
+void JournalHandler::acknowledge(size_t count) {
+    if (!ready || count == 0) return;
+    if (count > pending()) count = pending();
+    readOffset += count;
+    stats.acknowledged += count;
+
+    while (true) {
+        uint32_t segmentEnd = firstSegment == lastSegment ? writeCount : SEGMENT_RECORDS;
+        if (readOffset < segmentEnd) break;
+        if (firstSegment == lastSegment) {
+            // Drained completely, start the next append in a fresh segment
+            dropSegment();
+            lastSegment = firstSegment;
+            readOffset = writeCount = 0;
+            break;
+        }
+        dropSegment();
+        readOffset -= segmentEnd;
+    }
+    saveCursor();
+}
+
+size_t JournalHandler::pending() const {
+    if (firstSegment == lastSegment) return writeCount - readOffset;
+    return (size_t)(lastSegment - firstSegment) * SEGMENT_RECORDS - readOffset + writeCount;
+}
+
+void JournalHandler::segmentName(uint32_t segment, char* name, size_t size) const {
+    snprintf(name, size, "%08lu.seg", (unsigned long)segment);
+}
+
+bool JournalHandler::loadCursor(uint32_t& segment, uint32_t& offset) {
+    JournalCursor cursor;
+    if (storage.read("cursor", 0, &cursor, sizeof(cursor)) != sizeof(cursor)) return false;
+    segment = cursor.segment;
+    offset = cursor.offset;
+    return true;
+}
+
+void JournalHandler::saveCursor() {
+    JournalCursor cursor = {firstSegment, readOffset};
+    if (!storage.write("cursor", &cursor, sizeof(cursor))) stats.writeErrors++;
+}
+
+void JournalHandler::repairTail() {
+    char name[16];
+    segmentName(lastSegment, name, sizeof(name));
+    long size = storage.size(name);
+    if (size < 0) {
+        writeCount = 0;
+        return;
+    }
+
+    writeCount = size / sizeof(Record);
+    if (size % sizeof(Record) == 0) return;
+
+    // A power cut during append left a partial record, keep the whole ones
+    storage.truncate(name, writeCount * sizeof(Record));
+    LogHandler::writeMessage(LogHandler::DebugType::WARNING, "Journal: dropped a partial record at the end of segment " + String((unsigned long)lastSegment));
+}
+
+void JournalHandler::evictOldest() {
+    uint32_t segmentEnd = firstSegment == lastSegment ? writeCount : SEGMENT_RECORDS;
+    stats.evicted += segmentEnd - readOffset;
+    dropSegment();
+    readOffset = 0;
+    saveCursor();
+}
+
+void JournalHandler::dropSegment() {
+    char name[16];
+    segmentName(firstSegment, name, sizeof(name));
+    storage.remove(name);
+    firstSegment++;
+}
@@ -0,0 +1,62 @@
+#ifndef JOURNAL_HANDLER_HPP
+#define JOURNAL_HANDLER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../HAL/Storage.hpp"
+#include "../UTILS/SampleRecord.hpp"
+
+// Append-only store-and-forward journal for samples that could not be
+// uploaded. Records are fixed size and written to numbered segment files
+// (<n>.seg) on a Storage, on the device the LittleFS partition. A persisted
+// cursor marks the first record that was not acknowledged yet; fully
+// acknowledged segments are deleted, and when the journal is full the
+// oldest segment is evicted.
+class JournalHandler {
+public:
+    using Record = TimedSample;
+
+    struct Stats {
+        unsigned long appended;
+        unsigned long acknowledged;
+        unsigned long evicted;      // Records lost to oldest-first eviction
+        unsigned long writeErrors;
+    };
+
+    static constexpr size_t SEGMENT_RECORDS = 256;
+
+    JournalHandler(Storage& storage, uint32_t maxSegments = 64);
+    bool begin(); // Recovers segments and cursor
+
+    bool append(const Record* records, size_t count);
+    // Copies up to max records from the cursor without consuming them
+    size_t read(Record* out, size_t max);
+    // Consumes count records returned by read()
+    void acknowledge(size_t count);
+
+    size_t pending() const;
+    bool isReady() const { return ready; }
+    const Stats& getStats() const { return stats; }
+
+private:
+    void segmentName(uint32_t segment, char* name, size_t size) const;
+    bool loadCursor(uint32_t& segment, uint32_t& offset);
+    void saveCursor();
+    void repairTail();
+    void evictOldest();
+    void dropSegment();
+
+    Storage& storage;
+    uint32_t maxSegments;
+    bool ready = false;
+
+    uint32_t firstSegment = 0; // Segment the cursor is in
+    uint32_t lastSegment = 0;  // Segment appends go to
+    uint32_t readOffset = 0;   // Records acknowledged in firstSegment
+    uint32_t writeCount = 0;   // Records in lastSegment
+
+    Stats stats = {};
+};
+
+#endif // JOURNAL_HANDLER_HPP
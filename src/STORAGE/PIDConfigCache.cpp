@@ -0,0 +1,125 @@
+#include "PIDConfigCache.hpp"
+
+#include <string.h>
+
+#include "../CODEC/Varint.hpp"
+#include "../LOG/LogHandler.hpp"
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x43444950; // "PIDC"
+constexpr uint16_t CACHE_FORMAT = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint16_t format;
+    uint16_t count;
+    uint32_t hash;   // Over the entry bytes that follow
+    uint32_t length;
+    char remoteVersion[PIDConfigCache::MAX_VERSION + 1];
+};
+
+void writeString(VarintWriter& writer, const String& text) {
+    writer.varint(text.length());
+    for (size_t i = 0; i < text.length(); i++) writer.byte((uint8_t)text[i]);
+}
+
+bool readString(VarintReader& reader, String& text) {
+    size_t length = reader.varint();
+    if (reader.failed || length > reader.size - reader.pos) return false;
+    text = "";
+    text.reserve(length);
+    for (size_t i = 0; i < length; i++) text += (char)reader.data[reader.pos++];
+    return true;
+}
+
+} // namespace
+
+PIDConfigCache::PIDConfigCache(Storage& storage) : storage(storage) {}
+
+bool PIDConfigCache::encode(const PIDTable& table, std::vector<uint8_t>& out, size_t offset) {
+    // pid, priority and the period take at most 7 bytes, each string length 5
+    size_t capacity = 0;
+    for (const PIDConfig& config : table) {
+        capacity += 7 + 15 + config.label.length() + config.formula.length() + config.unit.length();
+    }
+    out.resize(offset + capacity);
+
+    VarintWriter writer = {out.data() + offset, capacity, 0, false};
+    for (const PIDConfig& config : table) {
+        writer.byte(config.pid);
+        writer.byte(config.priority);
+        writer.varint(config.periodMs);
+        writeString(writer, config.label);
+        writeString(writer, config.formula);
+        writeString(writer, config.unit);
+    }
+    out.resize(offset + writer.pos);
+    return !writer.failed;
+}
+
+uint32_t PIDConfigCache::fnv1a(const uint8_t* data, size_t length) {
+    uint32_t value = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        value ^= data[i];
+        value *= 16777619UL;
+    }
+    return value;
+}
+
+uint32_t PIDConfigCache::hashOf(const PIDTable& table) {
+    std::vector<uint8_t> entries;
+    encode(table, entries, 0);
+    return fnv1a(entries.data(), entries.size());
+}
+
+bool PIDConfigCache::save(const PIDTable& table, const char* version) {
+    std::vector<uint8_t> file;
+    if (!encode(table, file, sizeof(CacheHeader))) return false;
+
+    CacheHeader header = {};
+    header.magic = CACHE_MAGIC;
+    header.format = CACHE_FORMAT;
+    header.count = table.size();
+    header.length = file.size() - sizeof(CacheHeader);
+    header.hash = fnv1a(file.data() + sizeof(CacheHeader), header.length);
+    strncpy(header.remoteVersion, version ? version : "", MAX_VERSION);
+    memcpy(file.data(), &header, sizeof(header));
+
+    if (!storage.write(FILE_NAME, file.data(), file.size())) {
+        LogHandler::writeMessage(LogHandler::DebugType::WARNING, String("Could not write the PID config cache"));
+        return false;
+    }
+    hash = header.hash;
+    memcpy(remoteVersion, header.remoteVersion, sizeof(remoteVersion));
+    return true;
+}
+
+bool PIDConfigCache::load(PIDTable& table) {
+    CacheHeader header;
+    long size = storage.size(FILE_NAME);
+    if (size < (long)sizeof(header) || storage.read(FILE_NAME, 0, &header, sizeof(header)) != sizeof(header)) return false;
+    if (header.magic != CACHE_MAGIC || header.format != CACHE_FORMAT || size != (long)(sizeof(header) + header.length)) return false;
+
+    std::vector<uint8_t> entries(header.length);
+    if (storage.read(FILE_NAME, sizeof(header), entries.data(), entries.size()) != entries.size()) return false;
+    if (fnv1a(entries.data(), entries.size()) != header.hash) {
+        LogHandler::writeMessage(LogHandler::DebugType::WARNING, String("PID config cache damaged, ignored"));
+        return false;
+    }
+
+    VarintReader reader = {entries.data(), entries.size(), 0, false};
+    for (uint16_t i = 0; i < header.count; i++) {
+        PIDConfig& config = table.add(reader.byte());
+        config.priority = reader.byte();
+        config.periodMs = reader.varint();
+        if (!readString(reader, config.label) || !readString(reader, config.formula) || !readString(reader, config.unit)) return false;
+        if (!config.formula.isEmpty()) config.program.compile(config.formula.c_str());
+    }
+    if (reader.failed) return false;
+
+    hash = header.hash;
+    header.remoteVersion[MAX_VERSION] = '\0';
+    memcpy(remoteVersion, header.remoteVersion, sizeof(remoteVersion));
+    return true;
+}
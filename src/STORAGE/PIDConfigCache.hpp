@@ -0,0 +1,43 @@
+#ifndef PID_CONFIG_CACHE_HPP
+#define PID_CONFIG_CACHE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "../HAL/Storage.hpp"
+#include "../UTILS/PIDTable.hpp"
+
+// Last good PID config on persistent storage, so acquisition can start at
+// boot before the network is up. One file: a header with the content hash
+// and the remote config/version it was fetched at, then the descriptors as
+// varint length prefixed fields. Formulas are compiled again on load.
+class PIDConfigCache {
+public:
+    static constexpr size_t MAX_VERSION = 32; // Remote version tokens are cut to fit
+
+    explicit PIDConfigCache(Storage& storage);
+
+    // Fills table from the stored config; false if there is none or it is damaged
+    bool load(PIDTable& table);
+    bool save(const PIDTable& table, const char* remoteVersion);
+
+    // Content hash of the config last loaded or saved, 0 before that
+    uint32_t getHash() const { return hash; }
+    const char* getRemoteVersion() const { return remoteVersion; }
+
+    // FNV-1a over the encoded descriptors; equal configs hash alike
+    static uint32_t hashOf(const PIDTable& table);
+
+private:
+    static constexpr const char* FILE_NAME = "pids.bin";
+
+    static bool encode(const PIDTable& table, std::vector<uint8_t>& out, size_t offset);
+    static uint32_t fnv1a(const uint8_t* data, size_t length);
+
+    Storage& storage;
+    uint32_t hash = 0;
+    char remoteVersion[MAX_VERSION + 1] = "";
+};
+
+#endif // PID_CONFIG_CACHE_HPP
@@ -0,0 +1,88 @@
+#include "LogUploadHandler.hpp"
+
+#include <stdio.h>
+#include <vector>
+
+#include "../LOG/LogHandler.hpp"
+#include "../UTILS/JsonString.hpp"
+
+LogUploadHandler::LogUploadHandler(Uplink& uplink, Clock& clock) : uplink(uplink), clock(clock) {}
+
+bool LogUploadHandler::flush() {
+    unsigned long now = clock.millis();
+    if (now - lastFlushTime < FLUSH_INTERVAL_MS) return false;
+    // While offline the messages stay in LogHandler's bounded upload queue
+    if (!uplink.isReady()) return false;
+    lastFlushTime = now;
+
+    unsigned long start = clock.millis();
+    std::vector<LogHandler::LogEntry> entries = LogHandler::getAndClearLogs();
+    unsigned long queueDrops = LogHandler::getStats().uploadDropped;
+    unsigned long lostInQueue = queueDrops - reportedQueueDrops;
+    reportedQueueDrops = queueDrops;
+    if (entries.empty() && lostInQueue == 0) return false;
+
+    // Keep the newest entries that fit the budget
+    size_t budget = MAX_FLUSH_BYTES - SUMMARY_RESERVE;
+    size_t bytes = 0;
+    size_t keepFrom = entries.size();
+    while (keepFrom > 0) {
+        size_t size = entries[keepFrom - 1].message.length() + ENTRY_OVERHEAD;
+        if (bytes + size > budget) break;
+        bytes += size;
+        keepFrom--;
+    }
+    size_t overBudget = keepFrom;
+    entries.erase(entries.begin(), entries.begin() + keepFrom);
+
+    if (overBudget > 0 || lostInQueue > 0) {
+        char summary[LogHandler::LogRecord::MAX_MESSAGE];
+        snprintf(summary, sizeof(summary), "%u log entries over the %u byte flush budget and %lu lost in the queue were dropped",
+                 (unsigned)overBudget, (unsigned)MAX_FLUSH_BYTES, lostInQueue);
+        uint64_t epochMs = clock.epochMs();
+        long timestamp = epochMs ? (long)(epochMs / 1000) : -(long)now;
+        entries.push_back({"WARNING", timestamp, summary});
+        stats.dropped += overBudget + lostInQueue;
+    }
+
+    std::map<String, std::map<long, String>> grouped;
+    LogHandler::groupLogs(entries, grouped);
+    buildJson(grouped, payload);
+
+    bool sent = uplink.update("logs", payload);
+    stats.lastDurationMs = clock.millis() - start;
+    if (stats.lastDurationMs > stats.maxDurationMs) stats.maxDurationMs = stats.lastDurationMs;
+    if (!sent) {
+        stats.failures++;
+        stats.dropped += entries.size();
+        stats.lastEntries = 0;
+        return false;
+    }
+    stats.flushes++;
+    stats.entries += entries.size();
+    stats.lastEntries = entries.size();
+    stats.bytes += payload.length();
+    return true;
+}
+
+void LogUploadHandler::buildJson(const std::map<String, std::map<long, String>>& grouped, String& json) {
+    // {"<type>/<epoch s>": {"timestamp": "<epoch s>", "message": "a; b"}, ...}
+    json = "{";
+    char number[24];
+    for (const auto& pathPair : grouped) {
+        for (const auto& timePair : pathPair.second) {
+            if (json.length() > 1) json += ",";
+            snprintf(number, sizeof(number), "%ld", timePair.first);
+            json += "\"";
+            json += pathPair.first;
+            json += "/";
+            json += number;
+            json += "\":{\"timestamp\":\"";
+            json += number;
+            json += "\",\"message\":";
+            appendJsonString(json, timePair.second.c_str());
+            json += "}";
+        }
+    }
+    json += "}";
+}
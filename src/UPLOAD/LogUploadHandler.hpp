@@ -0,0 +1,53 @@
+#ifndef LOG_UPLOAD_HANDLER_HPP
+#define LOG_UPLOAD_HANDLER_HPP
+
+#include <Arduino.h>
+#include <map>
+
+#include "../HAL/Clock.hpp"
+#include "../HAL/Uplink.hpp"
+
+// Uploads the queued log messages once per FLUSH_INTERVAL_MS as a single
+// multi-path update of logs/<type>/<epoch s>. A flush never exceeds
+// MAX_FLUSH_BYTES: the oldest entries are dropped and replaced by a summary.
+class LogUploadHandler {
+public:
+    struct Stats {
+        unsigned long flushes;        // Successful updates
+        unsigned long failures;       // Rejected updates, their entries are lost
+        unsigned long entries;        // Log entries uploaded
+        unsigned long dropped;        // Entries over the byte budget or lost in the LogHandler queue
+        unsigned long bytes;          // Serialized update payload
+        unsigned long lastEntries;    // Entries in the last flush
+        unsigned long lastDurationMs; // Including the blocking update
+        unsigned long maxDurationMs;
+    };
+
+    static constexpr unsigned long FLUSH_INTERVAL_MS = 10000;
+    static constexpr size_t MAX_FLUSH_BYTES = 8192;
+
+    LogUploadHandler(Uplink& uplink, Clock& clock);
+
+    // Sends the logs queued since the last flush if the interval passed;
+    // returns true if an update was sent
+    bool flush();
+    // Serializes grouped[path][timestamp] = message as a multi-path update
+    static void buildJson(const std::map<String, std::map<long, String>>& grouped, String& json);
+
+    Stats getStats() const { return stats; }
+
+private:
+    // Key, timestamp and JSON syntax around each message (upper bound)
+    static constexpr size_t ENTRY_OVERHEAD = 64;
+    // Room kept for the drop summary
+    static constexpr size_t SUMMARY_RESERVE = 160;
+
+    Uplink& uplink;
+    Clock& clock;
+    String payload;
+    unsigned long lastFlushTime = 0;
+    unsigned long reportedQueueDrops = 0;
+    Stats stats = {};
+};
+
+#endif // LOG_UPLOAD_HANDLER_HPP
@@ -0,0 +1,217 @@
+#include "UploadHandler.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "../CODEC/SampleCodec.hpp"
+#include "../LOG/LogHandler.hpp"
+#include "../SETTINGS/SettingsHandler.hpp"
+#include "../UTILS/JsonString.hpp"
+
+UploadHandler::UploadHandler(Uplink& uplink, Clock& clock, SharedPIDTable& pidTables)
+    : uplink(uplink), clock(clock), pidTables(pidTables) {
+    batch.reserve(SettingsHandler::MAX_UPLOAD_BATCH_SIZE);
+}
+
+void UploadHandler::setJournal(JournalHandler* journal) {
+    this->journal = journal;
+}
+
+void UploadHandler::addData(const std::vector<SampleRecord>& samples) {
+    if (batch.empty() && !samples.empty()) batchStartedAt = clock.millis();
+    for (const auto& sample : samples) {
+        // Uploads keep failing: move the oldest samples to flash, or drop
+        // them when there is no journal. Either way a chunk at a time, so a
+        // long outage does not shift the whole batch for every new sample.
+        if (batch.size() >= (size_t)SettingsHandler::MAX_UPLOAD_BATCH_SIZE && !spillToJournal()) {
+            size_t count = batch.size() < JOURNAL_CHUNK ? batch.size() : JOURNAL_CHUNK;
+            batch.erase(batch.begin(), batch.begin() + count);
+            uploadStats.dropped += count;
+        }
+        batch.push_back(sample);
+    }
+}
+
+bool UploadHandler::spillToJournal() {
+    if (!journal || !journal->isReady()) return false;
+    // Journal records carry wall clock time, unknown before the first NTP sync
+    uint64_t epochMs = clock.epochMs();
+    if (epochMs == 0) return false;
+
+    unsigned long now = clock.millis();
+    size_t count = batch.size() < JOURNAL_CHUNK ? batch.size() : JOURNAL_CHUNK;
+    for (size_t i = 0; i < count; i++) {
+        journalBuffer[i].epochMs = epochMs - (uint32_t)(now - batch[i].timestampMs);
+        journalBuffer[i].sample = batch[i];
+    }
+    if (!journal->append(journalBuffer, count)) return false;
+
+    batch.erase(batch.begin(), batch.begin() + count);
+    uploadStats.journaled += count;
+    return true;
+}
+
+namespace {
+
+// A later sample of the same PID from the same ECU in the same millisecond
+// replaces this one; equal timestamps are adjacent
+bool supersededInGroup(const TimedSample* samples, size_t count, size_t index) {
+    const TimedSample& sample = samples[index];
+    for (size_t i = index + 1; i < count && samples[i].epochMs == sample.epochMs; i++) {
+        if (samples[i].sample.pid == sample.sample.pid && samples[i].sample.ecuId == sample.sample.ecuId) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+size_t UploadHandler::buildJson(const TimedSample* samples, size_t count, String& json) {
+    // One node per sample time: {"<epoch ms>": {"<label>": value, ...}, ...}.
+    // Samples arrive in time order, so equal timestamps are adjacent. Keys
+    // must be unique within a node (RTDB keeps only the last), so values
+    // from other ECUs than the engine are keyed "<label>@<ECU ID>".
+    json = "{";
+    size_t encoded = 0;
+    uint64_t groupMs = 0;
+    char number[32];
+    std::shared_ptr<const PIDTable> pids = pidTables.load();
+    for (size_t i = 0; i < count; i++) {
+        const SampleRecord& sample = samples[i].sample;
+        if (supersededInGroup(samples, count, i)) {
+            uploadStats.superseded++;
+            continue;
+        }
+        const PIDConfig* config = pids->find(sample.pid);
+        double value;
+        if (!config || !config->program.evaluate(sample.data, sample.len, value) || !isfinite(value)) {
+            // PID left the config while queued, or its formula does not apply
+            uploadStats.undecoded++;
+            continue;
+        }
+
+        if (encoded == 0 || samples[i].epochMs != groupMs) {
+            if (encoded > 0) json += "},";
+            groupMs = samples[i].epochMs;
+            snprintf(number, sizeof(number), "\"%llu\":{", (unsigned long long)groupMs);
+            json += number;
+        } else {
+            json += ",";
+        }
+        if (sample.ecuId == PRIMARY_ECU_ID) {
+            appendJsonString(json, config->label.c_str());
+        } else {
+            snprintf(number, sizeof(number), "@%03X", sample.ecuId);
+            appendJsonString(json, (config->label + number).c_str());
+        }
+        snprintf(number, sizeof(number), ":%.10g", value);
+        json += number;
+        encoded++;
+    }
+    if (encoded > 0) json += "}";
+    json += "}";
+    return encoded;
+}
+
+bool UploadHandler::buildCompact(const TimedSample* samples, size_t count, String& json) {
+    // Worst case is two 10 byte varints per sample; typical batches need far less
+    if (encodeBuffer.size() < COMPACT_BUFFER_SIZE) encodeBuffer.resize(COMPACT_BUFFER_SIZE);
+    size_t size = SampleCodec::encode(samples, count, encodeBuffer.data(), encodeBuffer.size());
+    if (size == 0) return false;
+
+    size_t textSize = SampleCodec::base64Length(size) + 1;
+    if (encodeText.size() < textSize) encodeText.resize(textSize);
+    SampleCodec::base64Encode(encodeBuffer.data(), size, encodeText.data(), encodeText.size());
+
+    // {"<first sample ms>": {"format": 1, "count": n, "data": "<base64>"}}
+    uint64_t first = samples[0].epochMs;
+    for (size_t i = 1; i < count; i++) {
+        if (samples[i].epochMs < first) first = samples[i].epochMs;
+    }
+    char header[80];
+    snprintf(header, sizeof(header), "{\"%llu\":{\"format\":%u,\"count\":%u,\"data\":\"", (unsigned long long)first, (unsigned)SampleCodec::VERSION, (unsigned)count);
+    json = header;
+    json += encodeText.data();
+    json += "\"}}";
+    return true;
+}
+
+bool UploadHandler::uploadSamples(const TimedSample* samples, size_t count, size_t& uploaded) {
+    uploaded = 0;
+    const char* node = "readings";
+    if (SettingsHandler::getUploadFormat() == SettingsHandler::UPLOAD_FORMAT_COMPACT && buildCompact(samples, count, payload)) {
+        node = "batches";
+        uploaded = count;
+    } else {
+        // JSON, also the fallback when a batch does not fit the compact buffer
+        uploaded = buildJson(samples, count, payload);
+        if (uploaded == 0) {
+            lastUploadFailed = false;
+            return true;
+        }
+    }
+
+    lastUploadAttempt = clock.millis();
+    lastUploadFailed = !uplink.update(node, payload);
+    if (lastUploadFailed) {
+        uploadStats.failures++;
+        return false;
+    }
+    uploadStats.batches++;
+    uploadStats.samples += uploaded;
+    uploadStats.bytes += payload.length();
+    if (uploadedCallback) uploadedCallback();
+    return true;
+}
+
+bool UploadHandler::sendData() {
+    if (!uplink.isReady()) return false;
+
+    unsigned long now = clock.millis();
+    // After a failed upload wait one batch age before trying again
+    if (lastUploadFailed && now - lastUploadAttempt < (unsigned long)SettingsHandler::getUploadBatchAge()) return false;
+
+    bool full = batch.size() >= (size_t)SettingsHandler::getUploadBatchSize();
+    bool old = !batch.empty() && now - batchStartedAt >= (unsigned long)SettingsHandler::getUploadBatchAge();
+    if (!full && !old) return replayJournal(now);
+
+    // Sample timestamps are millis(), anchor them to wall clock time
+    uint64_t epochMs = clock.epochMs();
+    if (epochMs == 0) return false;
+
+    size_t count = batch.size() < (size_t)SettingsHandler::getUploadBatchSize() ? batch.size() : (size_t)SettingsHandler::getUploadBatchSize();
+    uploadBuffer.clear();
+    for (size_t i = 0; i < count; i++) {
+        uploadBuffer.push_back({epochMs - (uint32_t)(now - batch[i].timestampMs), batch[i]});
+    }
+
+    size_t uploaded;
+    if (!uploadSamples(uploadBuffer.data(), count, uploaded)) return false;
+
+    batch.erase(batch.begin(), batch.begin() + count);
+    // The samples left behind keep their age
+    batchStartedAt = batch.empty() ? now : batch.front().timestampMs;
+    if (uploaded > 0) {
+        LogHandler::writeBinary(LogFormat::UPLOAD_SENT, uploaded);
+    }
+    return true;
+}
+
+bool UploadHandler::replayJournal(unsigned long now) {
+    // Paced so catching up after an outage leaves room for live data
+    if (!journal || journal->pending() == 0 || now - lastReplayTime < JOURNAL_REPLAY_INTERVAL_MS) return false;
+    lastReplayTime = now;
+
+    size_t max = (size_t)SettingsHandler::getUploadBatchSize();
+    if (max > JOURNAL_CHUNK) max = JOURNAL_CHUNK;
+    size_t count = journal->read(journalBuffer, max);
+    if (count == 0) return false;
+
+    size_t uploaded;
+    if (!uploadSamples(journalBuffer, count, uploaded)) return false;
+
+    // Only records the server accepted are removed from flash
+    journal->acknowledge(count);
+    uploadStats.replayed += uploaded;
+    LogHandler::writeBinary(LogFormat::UPLOAD_REPLAYED, uploaded, journal->pending());
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef UPLOAD_HANDLER_HPP
+#define UPLOAD_HANDLER_HPP
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+#include "../HAL/Clock.hpp"
+#include "../HAL/Uplink.hpp"
+#include "../STORAGE/JournalHandler.hpp"
+#include "../UTILS/PIDTable.hpp"
+#include "../UTILS/SampleRecord.hpp"
+
+// Batches raw samples from the acquisition task and uploads them over an
+// Uplink, as readings/<epoch ms>/<label>[@<ECU ID>] JSON or as compact
+// columnar batches. Samples that do not fit in RAM while offline go to the
+// journal and are replayed once the uplink is back.
+class UploadHandler {
+public:
+    struct UploadStats {
+        unsigned long batches;    // Successful multi-path updates
+        unsigned long samples;    // Samples uploaded
+        unsigned long failures;   // Failed update attempts
+        unsigned long dropped;    // Oldest samples discarded while the batch was full
+        unsigned long journaled;  // Samples moved to the flash journal while offline
+        unsigned long replayed;   // Journaled samples uploaded after reconnecting
+        unsigned long bytes;      // Serialized update payload
+        unsigned long undecoded;  // Samples of PIDs no longer in the config or failing their formula
+        unsigned long superseded; // Repeated PID of one ECU within a millisecond, only the last is sent as JSON
+    };
+
+    static constexpr uint16_t PRIMARY_ECU_ID = 0x7E8; // Engine ECU, its values are keyed by label alone
+
+    // Samples are decoded with the table last published to pidTables
+    UploadHandler(Uplink& uplink, Clock& clock, SharedPIDTable& pidTables);
+
+    void addData(const std::vector<SampleRecord>& samples); // Appends samples to the pending batch
+    // Uploads the pending batch as one multi-path update once it reached
+    // UPLOAD_BATCH_SIZE samples or UPLOAD_BATCH_AGE ms, otherwise replays
+    // journaled samples. Returns true if anything was sent.
+    bool sendData();
+    // Samples that do not fit in RAM while offline go to this journal
+    void setJournal(JournalHandler* journal);
+    void setUploadedCallback(std::function<void()> callback) { uploadedCallback = callback; }
+
+    UploadStats getUploadStats() const { return uploadStats; }
+    size_t getPendingSamples() const { return batch.size(); }
+
+    // Serializes samples the way sendData() does; returns the number of samples in json
+    size_t buildJson(const TimedSample* samples, size_t count, String& json);
+    bool buildCompact(const TimedSample* samples, size_t count, String& json);
+
+private:
+    static constexpr size_t JOURNAL_CHUNK = 100; // Records per journal append / replay upload
+    static constexpr unsigned long JOURNAL_REPLAY_INTERVAL_MS = 1000;
+    static constexpr size_t COMPACT_BUFFER_SIZE = 4096;
+
+    bool uploadSamples(const TimedSample* samples, size_t count, size_t& uploaded);
+    bool spillToJournal();
+    bool replayJournal(unsigned long now);
+
+    Uplink& uplink;
+    Clock& clock;
+    SharedPIDTable& pidTables;
+
+    std::vector<SampleRecord> batch;       // Raw samples waiting for upload, oldest first
+    std::vector<TimedSample> uploadBuffer; // Batch chunk anchored to wall clock time
+    std::vector<uint8_t> encodeBuffer;     // Compact format, allocated on first use
+    std::vector<char> encodeText;
+    String payload;
+    unsigned long batchStartedAt = 0;
+    unsigned long lastUploadAttempt = 0;
+    bool lastUploadFailed = false;
+    UploadStats uploadStats = {};
+    std::function<void()> uploadedCallback;
+
+    JournalHandler* journal = nullptr;
+    JournalHandler::Record journalBuffer[JOURNAL_CHUNK];
+    unsigned long lastReplayTime = 0;
+};
+
+#endif // UPLOAD_HANDLER_HPP
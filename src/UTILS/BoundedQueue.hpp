@@ -0,0 +1,64 @@
+#pragma once
+#include <mutex>
+#include <stddef.h>
+#include <utility>
+
+// Fixed-capacity FIFO shared between tasks. push() never waits for space:
+// when the queue is full the new item is dropped and counted instead.
+template <typename T, size_t N>
+class BoundedQueue {
+public:
+    bool push(const T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == N) {
+            dropped++;
+            return false;
+        }
+        buffer[(head + count) % N] = item;
+        count++;
+        if (count > highWater) highWater = count;
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == 0) return false;
+        item = std::move(buffer[head]);
+        head = (head + 1) % N;
+        count--;
+        return true;
+    }
+
+    // Copies the oldest item without removing it
+    bool peek(T& item) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == 0) return false;
+        item = buffer[head];
+        return true;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+
+    size_t getHighWater() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return highWater;
+    }
+
+    unsigned long getDropped() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return dropped;
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    mutable std::mutex mutex;
+    T buffer[N];
+    size_t head = 0;
+    size_t count = 0;
+    size_t highWater = 0;
+    unsigned long dropped = 0;
+};
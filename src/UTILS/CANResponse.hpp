@@ -1,7 +0,0 @@
-#pragma once
-#include <Arduino.h>
-
-struct CANResponse {
-    String PID;
-    String Value;
-};
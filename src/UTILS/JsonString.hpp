@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+// Appends text as a quoted JSON string. Quotes and backslashes are escaped,
+// control characters become spaces.
+inline void appendJsonString(String& json, const char* text) {
+    json += '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            json += '\\';
+            json += *c;
+        } else if ((unsigned char)*c < 0x20) {
+            json += ' ';
+        } else {
+            json += *c;
+        }
+    }
+    json += '"';
+}
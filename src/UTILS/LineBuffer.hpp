@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Byte ring of whole text lines for a consumer that may fall behind, such
+// as a network client. A line that does not fit is dropped, never split;
+// the number of lines lost is reported in front of the next line that fits.
+// Not thread safe.
+template <size_t N>
+class LineBuffer {
+public:
+    bool push(const char* line, size_t len) {
+        if (pendingDrops > 0) {
+            char note[48];
+            int noteLen = snprintf(note, sizeof(note), "... %lu lines dropped\r\n", pendingDrops);
+            if (space() < (size_t)noteLen + len + 2) return drop();
+            append(note, noteLen);
+            pendingDrops = 0;
+        }
+        if (space() < len + 2) return drop();
+        append(line, len);
+        append("\r\n", 2);
+        return true;
+    }
+
+    // Contiguous bytes from the oldest one on, 0 if empty
+    size_t peek(const char*& data) const {
+        data = &buffer[head];
+        return count < N - head ? count : N - head;
+    }
+
+    void consume(size_t len) {
+        if (len > count) len = count;
+        head = (head + len) % N;
+        count -= len;
+    }
+
+    void clear() {
+        head = count = 0;
+        pendingDrops = 0;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    unsigned long getDropped() const { return dropped; }
+
+private:
+    size_t space() const { return N - count; }
+
+    bool drop() {
+        pendingDrops++;
+        dropped++;
+        return false;
+    }
+
+    void append(const char* data, size_t len) {
+        size_t tail = (head + count) % N;
+        size_t first = len < N - tail ? len : N - tail;
+        memcpy(&buffer[tail], data, first);
+        memcpy(buffer, data + first, len - first);
+        count += len;
+    }
+
+    char buffer[N];
+    size_t head = 0;
+    size_t count = 0;
+    unsigned long pendingDrops = 0; // Not yet reported to the reader
+    unsigned long dropped = 0;
+};
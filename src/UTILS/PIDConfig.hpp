@@ -1,8 +1,14 @@
 #pragma once
 #include <Arduino.h>
 
+#include "../CAN/PIDFormula.hpp"
+
 struct PIDConfig {
+    byte pid = 0;
     String label;
     String formula;
     String unit;
-};
\ No newline at end of file
+    PIDFormula program; // formula compiled once when the config is loaded
+    unsigned long periodMs = 0; // Target polling period, 0 = CAN_REQUEST_INTERVAL
+    byte priority = 0; // Higher wins when deadlines tie
+};
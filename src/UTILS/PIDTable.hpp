@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "PIDConfig.hpp"
+
+// PID descriptors indexed directly by the PID byte: a lookup is one array
+// read instead of a tree walk. A table is filled with add() while it is
+// built and treated as read-only once published through SharedPIDTable.
+class PIDTable {
+public:
+    PIDTable() { memset(slots, 0xFF, sizeof(slots)); }
+
+    // Returns the descriptor for pid, adding an empty one if needed. The
+    // reference is only valid until the next add().
+    PIDConfig& add(uint8_t pid) {
+        if (slots[pid] == NO_SLOT) {
+            slots[pid] = configs.size();
+            configs.emplace_back();
+            configs.back().pid = pid;
+        }
+        return configs[slots[pid]];
+    }
+
+    const PIDConfig* find(uint8_t pid) const { return slots[pid] == NO_SLOT ? nullptr : &configs[slots[pid]]; }
+    bool contains(uint8_t pid) const { return slots[pid] != NO_SLOT; }
+    size_t size() const { return configs.size(); }
+    bool empty() const { return configs.empty(); }
+
+    // Descriptors in the order they were added
+    std::vector<PIDConfig>::const_iterator begin() const { return configs.begin(); }
+    std::vector<PIDConfig>::const_iterator end() const { return configs.end(); }
+
+private:
+    static constexpr uint16_t NO_SLOT = 0xFFFF;
+
+    std::vector<PIDConfig> configs;
+    uint16_t slots[256];
+};
+
+// The active PID config, shared between the tasks. A new config is a new
+// table swapped in as a whole; readers keep the shared_ptr they loaded, so
+// the old table stays valid until they let go of it.
+class SharedPIDTable {
+public:
+    SharedPIDTable() : table(std::make_shared<const PIDTable>()) {}
+
+    std::shared_ptr<const PIDTable> load() const { return std::atomic_load(&table); }
+    void publish(std::shared_ptr<const PIDTable> next) {
+        std::atomic_store(&table, std::move(next));
+        version++;
+    }
+    // Changes with every publish(); cheaper to poll than load()
+    uint32_t getVersion() const { return version; }
+
+private:
+    std::shared_ptr<const PIDTable> table;
+    std::atomic<uint32_t> version{0};
+};
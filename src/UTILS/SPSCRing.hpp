@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+
+// Fixed-size lock-free ring for exactly one producer and one consumer
+// (e.g. a receive task filling it and loop() draining it).
+template <typename T, size_t N>
+class SPSCRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCRing capacity must be a power of two");
+
+public:
+    // Producer side. Returns false (and stores nothing) when the ring is full.
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) return false;
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return false;
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T buffer[N];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// One PID reading as it leaves the acquisition task. Plain data with no heap
+// members, so it can be copied through preallocated queues; the label and
+// formula are only applied when the sample is serialized for upload.
+struct SampleRecord {
+    static constexpr uint8_t MAX_DATA = 8;
+
+    uint32_t timestampMs;   // millis() when the response was parsed
+    uint16_t ecuId;         // Response CAN ID, 0x7E8 - 0x7EF
+    uint8_t pid;
+    uint8_t len;            // Valid bytes in data
+    uint8_t data[MAX_DATA]; // Raw PID data, A = data[0]
+};
+
+// A sample anchored to wall clock time, as journaled and encoded for upload
+struct TimedSample {
+    uint64_t epochMs;
+    SampleRecord sample;
+};
@@ -1,216 +1,475 @@
-#include <WiFi.h>
-#include <time.h>
-#include "OTA/OTAHandler.hpp"
-#include "BLE/BLEHandler.hpp"
-#include "EEPROM/EEPROMHandler.hpp"
-#include "Firebase/FirebaseHandler.hpp"
-#include "CAN/CANHandler.hpp"
-#include "LOG/LogHandler.hpp"
-#include "SETTINGS/SettingsHandler.hpp"
-#include "UTILS/CANResponse.hpp"
-#include "UTILS/PIDConfig.hpp"
-
-#define BOOT_BUTTON_PIN 0 // GPIO pin for the boot button
-#define LED_PIN 2         // GPIO pin for the onboard LED
-
-#define CAN_CS 5 // Chip Select pin for MCP2515
-
-const char* ntpServer = "pool.ntp.org"; // NTP server for time synchronization
-
-bool isBLEActive = false; // Tracks if BLE is active
-bool wifiStatus = false;
-bool firebaseStatus = false;
-bool canActive = false;
-static unsigned long lastCanTryToActive = 0;
-
-static bool receivedDataOverCan = false;
-
-std::map<byte, PIDConfig> pidMap;
-
-// Firebase handler instance
-FirebaseHandler firebaseHandler(API_KEY, USER_EMAIL, USER_PASSWORD, DATABASE_URL, pidMap);
-
-// CAN Handler
-CANHandler canHandler(CAN_CS, pidMap);
-
-// OTAHandler otaHandler;
-BLEHandler bleHandler;
-EEPROMHandler eepromHandler(EEPROM_SIZE);
-
-std::vector<CANResponse> canResponses;
-
-void bleReceiveCallback(const std::string& message) {
-    if (!message.empty()) {
-        LogHandler::writeMessage(LogHandler::LogHandler::DebugType::BLE, String("Received command: ") + String(message.c_str()));
-
-        if (message == "CLEAR_EEPROM") {
-            eepromHandler.clear();
-            LogHandler::writeMessage(LogHandler::DebugType::BLE, String("EEPROM cleared."));
-            bleHandler.sendMessage("EEPROM cleared.");
-        } else if (message == "DISABLE_BLE") {
-            LogHandler::writeMessage(LogHandler::DebugType::BLE, String("BLE disabled."));
-            bleHandler.stopListening();
-            isBLEActive = false;
-            digitalWrite(LED_PIN, LOW);
-        } else if (message.rfind("WIFI,", 0) == 0) { // Check if message starts with "WIFI,"
-            size_t firstComma = message.find(',');
-            size_t secondComma = message.find(',', firstComma + 1);
-
-            if (secondComma != std::string::npos) {
-                std::string ssid = message.substr(firstComma + 1, secondComma - firstComma - 1);
-                std::string password = message.substr(secondComma + 1);
-                
-                // Validate SSID and password length
-                if (ssid.length() < 1 || ssid.length() > 32 || password.length() < 1 || password.length() > 32) {
-                    LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Invalid SSID or Password length. Must be between 1 and 32 characters."));
-                    bleHandler.sendMessage("Invalid SSID or Password length. Must be between 1 and 32 characters.");
-                    return; // Exit the function if validation fails
-                }
-
-                eepromHandler.saveWiFiCredentials(ssid.c_str(), password.c_str());
-                
-                WiFi.disconnect();
-                WiFi.begin(ssid.c_str(), password.c_str());
-                wifiStatus = false; // Reset WiFi status
-            } else {
-                LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Invalid WIFI command format."));
-                bleHandler.sendMessage("Invalid WIFI command format.");
-            }
-        } else {
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Invalid command: ") + String(message.c_str()));
-            bleHandler.sendMessage("Invalid command.");
-        }
-    }
-}
-
-void setup() {
-    Serial.begin(115200);
-
-    // Initialize GPIO
-    pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP); // Boot button
-    pinMode(LED_PIN, OUTPUT);               // LED
-
-    eepromHandler.begin(); // Initialize EEPROM
-
-    String ssid, password;
-    eepromHandler.loadWiFiCredentials(ssid, password);
-
-    // Connect to WiFi
-    WiFi.begin(ssid, password);
-
-    // Initialize OTA
-    // otaHandler.begin();
-
-    canActive = canHandler.begin(); // Initialize CAN handler
-
-    // Add PIDs to the CAN handler
-    // canHandler.addPID(0x0C, "RPM");
-    // canHandler.addPID(0x0D, "Speed");
-    // canHandler.addPID(0x10, "MAF");
-    // canHandler.addPID(0x05, "Coolant_Temp");
-    // canHandler.addPID(0x5C, "Oil_Temp");
-
-    // Initialize BLE
-    bleHandler.begin("SMARTCAR_BLE");
-    // bleHandler.startListening();
-    bleHandler.setReceiveMessageCallback(bleReceiveCallback);
-    bleHandler.setDeviceConnectedCallback([]() {
-        LogHandler::writeMessage(LogHandler::DebugType::BLE, String("Device connected!"));
-    });
-    bleHandler.setDeviceDisconnectedCallback([]() {
-        LogHandler::writeMessage(LogHandler::DebugType::BLE, String("Device disconnected!"));
-    });
-}
-
-void loop() {
-    static unsigned long buttonPressStartTime = 0;
-    static unsigned long lastLEDToggleTime = 0;
-    static unsigned long lastCANRequestTime = 0;
-    static bool ledState = false;
-
-    if (WiFi.status() == WL_CONNECTED) {
-        if (!wifiStatus) {
-            wifiStatus = true;
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, String("WiFi connected: ") + WiFi.SSID() + ", IP: " + WiFi.localIP().toString());
-            bleHandler.sendMessage(std::string("WiFi connected: ") + WiFi.SSID().c_str() + ", IP: " + WiFi.localIP().toString().c_str());
-            
-            // Configure time
-            configTime(0, 0, ntpServer);
-            struct tm timeinfo;
-            while (!getLocalTime(&timeinfo) || timeinfo.tm_year < (2020 - 1900)) {
-                LogHandler::writeMessage(LogHandler::DebugType::INFO, "Waiting for NTP time sync...", false);
-                delay(1000);
-            }
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "NTP time set! Year: " + String(timeinfo.tm_year + 1900), false);
-            LogHandler::writeMessage(LogHandler::DebugType::INFO, "Epoch time: " + String(LogHandler::getTime()), false);
-
-        }
-
-        if (!firebaseStatus) {
-            firebaseHandler.begin();
-            firebaseStatus = true;
-
-            // Fetch PIDs
-            while (!firebaseHandler.fetchCANPIDs()) {};
-        }
-    }
-
-    if (!canActive) {
-        if (millis() - lastCanTryToActive >= 5000) { // Try to activate CAN every 5 seconds
-            canHandler.begin();
-            lastCanTryToActive = millis();
-        }
-    }
-
-    // Check if the boot button is pressed
-    if (digitalRead(BOOT_BUTTON_PIN) == LOW) {
-        if (buttonPressStartTime == 0) {
-            buttonPressStartTime = millis(); // Start timing the button press
-        } else if (millis() - buttonPressStartTime >= 3000) { // Button held for 3 seconds
-            if (!isBLEActive) {
-                LogHandler::writeMessage(LogHandler::DebugType::BLE, String("Starting BLE..."));
-                bleHandler.startListening();
-                isBLEActive = true; // Enable BLE
-            }
-        }
-    } else {
-        buttonPressStartTime = 0; // Reset timing if button is released
-    }
-
-    // Flicker the LED while BLE is active
-    if (isBLEActive) {
-        if (millis() - lastLEDToggleTime >= 500) { // Toggle LED every 500ms
-            lastLEDToggleTime = millis();
-            ledState = !ledState;
-            digitalWrite(LED_PIN, ledState ? HIGH : LOW);
-        }
-    }
-
-    // Handle OTA updates
-    // otaHandler.handle();
-
-    // Handle BLE communication
-    bleHandler.handle();
-
-    // Send CAN requests every X seconds
-    canHandler.sendRequests();
-
-    static unsigned long lastCANReadTime = 0;
-    const unsigned long canReadInterval = 50; // ms
-
-    if (millis() - lastCANReadTime >= canReadInterval) {
-        lastCANReadTime = millis();
-        if (canHandler.handleResponses(canResponses)) {
-            firebaseHandler.addData(canResponses);
-        }
-    }
-
-    // Send firebase messages
-    receivedDataOverCan = !(firebaseHandler.sendData(receivedDataOverCan, LogHandler::getTime()));
-
-    // Receive firebase messages
-    firebaseHandler.readData();
-
-    // Send queued log messages
-    firebaseHandler.sendQueuedLogMessages();
-}
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <time.h>
+#include "OTA/OTAHandler.hpp"
+#include "BLE/BLEHandler.hpp"
+#include "EEPROM/EEPROMHandler.hpp"
+#include "Firebase/FirebaseHandler.hpp"
+#include "CAN/CANHandler.hpp"
+#include "CONNECTION/ConnectionHandler.hpp"
+#include "LOG/LogHandler.hpp"
+#include "PLATFORM/MCP2515Controller.hpp"
+#include "PLATFORM/SerialLogSink.hpp"
+#include "PLATFORM/SystemClock.hpp"
+#include "PLATFORM/TelnetLogSink.hpp"
+#include "PROFILE/LoopProfiler.hpp"
+#include "SETTINGS/SettingsHandler.hpp"
+#include "STORAGE/FileStorage.hpp"
+#include "STORAGE/PIDConfigCache.hpp"
+#include "STORAGE/JournalHandler.hpp"
+#include "UPLOAD/LogUploadHandler.hpp"
+#include "UPLOAD/UploadHandler.hpp"
+#include "UTILS/BoundedQueue.hpp"
+#include "UTILS/JsonString.hpp"
+#include "UTILS/PIDTable.hpp"
+#include "UTILS/SampleRecord.hpp"
+
+#define BOOT_BUTTON_PIN 0 // GPIO pin for the boot button
+#define LED_PIN 2         // GPIO pin for the onboard LED
+
+#define CAN_CS 5 // Chip Select pin for MCP2515
+#define CAN_INT 4 // Interrupt pin for MCP2515
+
+#define ACQUISITION_CORE 1 // CAN polling, away from the WiFi stack
+#define UPLINK_CORE 0      // WiFi, Firebase, BLE and logging
+
+#define SAMPLE_QUEUE_SIZE 128
+#define METRICS_INTERVAL 60000 // ms
+
+const char* ntpServer = "pool.ntp.org"; // NTP server for time synchronization
+
+bool isBLEActive = false; // Tracks if BLE is active
+bool canActive = false;
+static unsigned long lastCanTryToActive = 0;
+
+SharedPIDTable pidTables; // Published by Firebase on the uplink task, polled by the acquisition task
+
+SystemClock systemClock;
+SerialLogSink serialLogSink;
+TelnetLogSink telnetLogSink; // Live logs and samples on port 23, see debug.sh
+
+// Firebase handler instance
+FirebaseHandler firebaseHandler(API_KEY, USER_EMAIL, USER_PASSWORD, DATABASE_URL, pidTables);
+
+// CAN Handler
+MCP2515Controller canController(CAN_CS);
+CANHandler canHandler(canController, pidTables, CAN_INT);
+
+// Samples that could not be uploaded, kept on the LittleFS partition
+FileStorage journalStorage("/littlefs/journal");
+JournalHandler journal(journalStorage);
+// Supported PID bitmaps per VIN
+FileStorage vehicleStorage("/littlefs/vehicles");
+// Last fetched PID config, polled at boot before the network is up
+FileStorage configStorage("/littlefs/config");
+PIDConfigCache pidConfigCache(configStorage);
+
+// Batches samples for upload over Firebase
+UploadHandler uploadHandler(firebaseHandler, systemClock, pidTables);
+LogUploadHandler logUploadHandler(firebaseHandler, systemClock);
+
+// WiFi / NTP / Firebase startup state machine
+ConnectionHandler connectionHandler(firebaseHandler, ntpServer);
+
+// OTAHandler otaHandler;
+BLEHandler bleHandler;
+EEPROMHandler eepromHandler(EEPROM_SIZE);
+
+// Raw samples from the acquisition task to the uplink task
+BoundedQueue<SampleRecord, SAMPLE_QUEUE_SIZE> sampleQueue;
+
+void acquisitionTask(void* param);
+void uplinkTask(void* param);
+void handleUplink(std::vector<SampleRecord>& samples);
+
+void bleReceiveCallback(const std::string& message) {
+    if (!message.empty()) {
+        LogHandler::writeMessage(LogHandler::LogHandler::DebugType::BLE, String("Received command: ") + String(message.c_str()));
+
+        if (message == "CLEAR_EEPROM") {
+            eepromHandler.clear();
+            LogHandler::writeMessage(LogHandler::DebugType::BLE, String("EEPROM cleared."));
+            bleHandler.sendMessage("EEPROM cleared.");
+        } else if (message == "DISABLE_BLE") {
+            LogHandler::writeMessage(LogHandler::DebugType::BLE, String("BLE disabled."));
+            bleHandler.stopListening();
+            isBLEActive = false;
+            digitalWrite(LED_PIN, LOW);
+        } else if (message == "READ_VIN") {
+            canHandler.requestVIN();
+            bleHandler.sendMessage("VIN request queued.");
+        } else if (message == "READ_DTC") {
+            canHandler.requestStoredDTCs();
+            bleHandler.sendMessage("DTC request queued.");
+        } else if (message == "DISCOVER_PIDS") {
+            canHandler.requestPIDDiscovery();
+            bleHandler.sendMessage("Supported PID discovery queued.");
+        } else if (message == "PROFILE") {
+            // One message per stage: count, min/p50/p99/max us since the last report
+            for (size_t i = 0; i < (size_t)LoopProfiler::Stage::COUNT; i++) {
+                bleHandler.sendMessage(LoopProfiler::describe((LoopProfiler::Stage)i).c_str());
+            }
+        } else if (message.rfind("WIFI,", 0) == 0) { // Check if message starts with "WIFI,"
+            size_t firstComma = message.find(',');
+            size_t secondComma = message.find(',', firstComma + 1);
+
+            if (secondComma != std::string::npos) {
+                std::string ssid = message.substr(firstComma + 1, secondComma - firstComma - 1);
+                std::string password = message.substr(secondComma + 1);
+                
+                // Validate SSID and password length
+                if (ssid.length() < 1 || ssid.length() > 32 || password.length() < 1 || password.length() > 32) {
+                    LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Invalid SSID or Password length. Must be between 1 and 32 characters."));
+                    bleHandler.sendMessage("Invalid SSID or Password length. Must be between 1 and 32 characters.");
+                    return; // Exit the function if validation fails
+                }
+
+                eepromHandler.saveWiFiCredentials(ssid.c_str(), password.c_str());
+                
+                // The connection state machine notices the drop and reconnects
+                WiFi.disconnect();
+                WiFi.begin(ssid.c_str(), password.c_str());
+            } else {
+                LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Invalid WIFI command format."));
+                bleHandler.sendMessage("Invalid WIFI command format.");
+            }
+        } else {
+            LogHandler::writeMessage(LogHandler::DebugType::INFO, String("Invalid command: ") + String(message.c_str()));
+            bleHandler.sendMessage("Invalid command.");
+        }
+    }
+}
+
+void loadDefaultPIDs() {
+    const struct { byte pid; const char* label; const char* formula; const char* unit; } defaults[] = {
+        {0x0C, "RPM", "((A * 256) + B) / 4", "rpm"},
+        {0x0D, "Speed", "A", "km/h"},
+        {0x05, "Coolant_Temp", "A - 40", "C"},
+    };
+
+    std::shared_ptr<PIDTable> pids = std::make_shared<PIDTable>();
+    for (const auto& entry : defaults) {
+        PIDConfig& config = pids->add(entry.pid);
+        config.label = entry.label;
+        config.formula = entry.formula;
+        config.unit = entry.unit;
+        config.program.compile(entry.formula);
+    }
+    pidTables.publish(pids);
+}
+
+void setup() {
+    Serial.begin(115200);
+    LogHandler::setClock(&systemClock);
+    LogHandler::addSink(&serialLogSink);
+    LogHandler::addSink(&telnetLogSink);
+    LogHandler::begin();
+
+    // Initialize GPIO
+    pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP); // Boot button
+    pinMode(LED_PIN, OUTPUT);               // LED
+
+    eepromHandler.begin(); // Initialize EEPROM
+
+    String ssid, password;
+    eepromHandler.loadWiFiCredentials(ssid, password);
+
+    // Connect to WiFi
+    WiFi.begin(ssid, password);
+    telnetLogSink.begin();
+
+    // Initialize OTA
+    // otaHandler.begin();
+
+    // Store-and-forward journal for offline periods
+    bool littleFsReady = LittleFS.begin(true);
+    if (littleFsReady && journal.begin()) {
+        uploadHandler.setJournal(&journal);
+    } else {
+        LogHandler::writeMessage(LogHandler::DebugType::ERROR, String("LittleFS not available, offline samples will be dropped"));
+    }
+    if (littleFsReady && vehicleStorage.begin()) {
+        canHandler.setSupportCache(&vehicleStorage);
+    }
+    bool configCacheReady = littleFsReady && configStorage.begin();
+    if (configCacheReady) {
+        firebaseHandler.setConfigCache(&pidConfigCache);
+    }
+
+    canActive = canHandler.begin(); // Initialize CAN handler
+
+    // Poll the last fetched config right away, or a default set of PIDs
+    // until the Firebase config is fetched
+    std::shared_ptr<PIDTable> cachedPids = std::make_shared<PIDTable>();
+    if (configCacheReady && pidConfigCache.load(*cachedPids)) {
+        pidTables.publish(cachedPids);
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Loaded " + String((unsigned)cachedPids->size()) + " PIDs from the config cache");
+    } else {
+        loadDefaultPIDs();
+    }
+
+    connectionHandler.setStateChangedCallback([](ConnectionHandler::State from, ConnectionHandler::State to) {
+        if (from == ConnectionHandler::State::WIFI_CONNECTING && to != ConnectionHandler::State::BACKOFF) {
+            bleHandler.sendMessage(std::string("WiFi connected: ") + WiFi.SSID().c_str() + ", IP: " + WiFi.localIP().toString().c_str());
+        }
+    });
+    uploadHandler.setUploadedCallback([]() {
+        ConnectionHandler::markFirstUpload();
+    });
+
+    // Initialize BLE
+    bleHandler.begin("SMARTCAR_BLE");
+    // bleHandler.startListening();
+    bleHandler.setReceiveMessageCallback(bleReceiveCallback);
+    bleHandler.setDeviceConnectedCallback([]() {
+        LogHandler::writeMessage(LogHandler::DebugType::BLE, String("Device connected!"));
+    });
+    bleHandler.setDeviceDisconnectedCallback([]() {
+        LogHandler::writeMessage(LogHandler::DebugType::BLE, String("Device disconnected!"));
+    });
+
+    // CAN acquisition and network uplink run on separate cores so a slow
+    // Firebase request or BLE event never stalls PID polling
+    xTaskCreatePinnedToCore(acquisitionTask, "acquisition", 8192, nullptr, 3, nullptr, ACQUISITION_CORE);
+    xTaskCreatePinnedToCore(uplinkTask, "uplink", 16384, nullptr, 1, nullptr, UPLINK_CORE);
+}
+
+void loop() {
+    // All work happens in acquisitionTask and uplinkTask
+    vTaskDelete(NULL);
+}
+
+void acquisitionTask(void* param) {
+    std::vector<SampleRecord> samples;
+    samples.reserve(OBDPids::MAX_PIDS_PER_REQUEST * 2); // Cleared, never shrunk: no allocation per sample
+
+    while (true) {
+        PROFILE_SCOPE(ACQUISITION_LOOP);
+        if (!canActive) {
+            if (millis() - lastCanTryToActive >= 5000) { // Try to activate CAN every 5 seconds
+                canActive = canHandler.begin();
+                lastCanTryToActive = millis();
+            }
+        }
+
+        // Send CAN requests for the PIDs that are due
+        {
+            PROFILE_SCOPE(CAN_SEND);
+            canHandler.sendRequests();
+        }
+
+        // Process frames queued by the CAN receive task
+        bool received;
+        {
+            PROFILE_SCOPE(CAN_RECEIVE);
+            received = canHandler.handleResponses(samples);
+        }
+        if (received) {
+            ConnectionHandler::markFirstSample();
+            for (const auto& sample : samples) {
+                sampleQueue.push(sample);
+            }
+            samples.clear();
+        }
+
+        vTaskDelay(1);
+    }
+}
+
+// Live sample feed for telnet clients, decoded like the upload
+void streamSamples(const std::vector<SampleRecord>& samples) {
+    if (!telnetLogSink.hasSampleClients()) return;
+    char line[96];
+    std::shared_ptr<const PIDTable> pids = pidTables.load();
+    for (const auto& sample : samples) {
+        const PIDConfig* config = pids->find(sample.pid);
+        double value;
+        if (config && config->program.evaluate(sample.data, sample.len, value)) {
+            snprintf(line, sizeof(line), "[SAMPLE] %lu %X %s = %.10g", (unsigned long)sample.timestampMs, sample.ecuId, config->label.c_str(), value);
+        } else {
+            int len = snprintf(line, sizeof(line), "[SAMPLE] %lu %X %02X ", (unsigned long)sample.timestampMs, sample.ecuId, sample.pid);
+            for (uint8_t i = 0; i < sample.len && len + 2 < (int)sizeof(line); i++) len += snprintf(&line[len], sizeof(line) - len, "%02X", sample.data[i]);
+        }
+        telnetLogSink.writeSample(line);
+    }
+}
+
+void logTaskMetrics() {
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Time to first sample: " + String(ConnectionHandler::getTimeToFirstSample()) + " ms, time to first upload: " + String(ConnectionHandler::getTimeToFirstUpload()) + " ms, connection state: " + ConnectionHandler::stateName(connectionHandler.getState()));
+    UploadHandler::UploadStats upload = uploadHandler.getUploadStats();
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Uploaded " + String(upload.samples) + " samples in " + String(upload.batches) + " batches (" + String(upload.bytes) + " bytes), " + String(upload.failures) + " failed, " + String(upload.dropped) + " dropped, " + String((unsigned)uploadHandler.getPendingSamples()) + " pending");
+    LogUploadHandler::Stats logUpload = logUploadHandler.getStats();
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Log upload: " + String(logUpload.flushes) + " flushes, " + String(logUpload.entries) + " entries (last " + String(logUpload.lastEntries) + "), " + String(logUpload.dropped) + " dropped, " + String(logUpload.failures) + " failed, last " + String(logUpload.lastDurationMs) + " ms, max " + String(logUpload.maxDurationMs) + " ms");
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Journal: " + String(upload.journaled) + " samples stored, " + String(upload.replayed) + " replayed, " + String((unsigned)journal.pending()) + " pending, " + String(journal.getStats().evicted) + " evicted");
+    TelnetLogSink::Stats telnet = telnetLogSink.getStats();
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Telnet: " + String(telnet.connections) + " connections, " + String(telnet.rejected) + " rejected, " + String(telnet.bytesSent) + " bytes sent, " + String(telnet.droppedLines) + " lines dropped");
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Sample queue depth: " + String((unsigned)sampleQueue.size()) + "/" + String((unsigned)sampleQueue.capacity()) + ", high water: " + String((unsigned)sampleQueue.getHighWater()) + ", dropped: " + String(sampleQueue.getDropped()));
+}
+
+// Stage latencies of the last interval to profile/<epoch s>, then a new window
+void reportLoopProfile() {
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "Loop profile: " + LoopProfiler::describe(LoopProfiler::Stage::ACQUISITION_LOOP) + ", " + LoopProfiler::describe(LoopProfiler::Stage::UPLINK_LOOP));
+    uint64_t epochMs = systemClock.epochMs();
+    if (epochMs != 0 && firebaseHandler.isReady()) {
+        firebaseHandler.update("profile", "{\"" + String((unsigned long)(epochMs / 1000)) + "\":" + LoopProfiler::toJson() + "}");
+    }
+    LoopProfiler::reset();
+}
+
+// Cumulative per-PID request metrics and bus errors to can_health/<epoch s>
+void reportCANHealth() {
+    static CANMetrics::Snapshot health; // ~2 KB, kept off the task stack
+    canHandler.getHealth(health);
+    LogHandler::writeMessage(LogHandler::DebugType::INFO, "CAN bus: TEC " + String(health.bus.txErrors) + ", REC " + String(health.bus.rxErrors) + ", " + String(health.bus.rxOverflows) + " RX overflows, " + String(health.bus.errorPassive) + " error passive, " + String(health.bus.busOff) + " bus off");
+    uint64_t epochMs = systemClock.epochMs();
+    if (epochMs != 0 && firebaseHandler.isReady()) {
+        String json;
+        CANMetrics::buildJson(health, json);
+        firebaseHandler.update("can_health", "{\"" + String((unsigned long)(epochMs / 1000)) + "\":" + json + "}");
+    }
+}
+
+// Discovery result to pid_support whenever it or the PID config changes
+void reportPIDSupport() {
+    static uint32_t reportedVersion = 0;
+    uint32_t version = canHandler.getPIDSupportVersion();
+    if (version == reportedVersion || !firebaseHandler.isReady()) return;
+
+    CANHandler::PIDSupport support;
+    canHandler.getPIDSupport(support);
+    if (!support.discovered) {
+        reportedVersion = version;
+        return;
+    }
+
+    char entry[48];
+    String json = String("{\"source\":\"") + (support.fromCache ? "cache" : "ecu") + "\",\"vin\":";
+    appendJsonString(json, support.vin);
+    json += ",\"bitmaps\":{";
+    for (uint8_t i = 0; i < support.bitmapCount; i++) {
+        snprintf(entry, sizeof(entry), "%s\"%02X\":\"%08lX\"", i ? "," : "", i * 0x20, (unsigned long)support.bitmaps[i]);
+        json += entry;
+    }
+    json += "},\"unsupported\":";
+    if (support.unsupportedCount == 0) {
+        json += "null"; // Clears the previous list
+    } else {
+        std::shared_ptr<const PIDTable> pids = pidTables.load();
+        json += "{";
+        for (uint8_t i = 0; i < support.unsupportedCount; i++) {
+            const PIDConfig* config = pids->find(support.unsupported[i]);
+            snprintf(entry, sizeof(entry), "%s\"%02X\":", i ? "," : "", support.unsupported[i]);
+            json += entry;
+            appendJsonString(json, config ? config->label.c_str() : "");
+        }
+        json += "}";
+    }
+    json += "}";
+
+    if (firebaseHandler.update("pid_support", json)) {
+        reportedVersion = version;
+        LogHandler::writeMessage(LogHandler::DebugType::INFO, "Reported " + String(support.unsupportedCount) + " unsupported PIDs");
+    }
+}
+
+void uplinkTask(void* param) {
+    std::vector<SampleRecord> samples;
+    samples.reserve(SAMPLE_QUEUE_SIZE);
+
+    while (true) {
+        handleUplink(samples);
+        vTaskDelay(1);
+    }
+}
+
+void handleUplink(std::vector<SampleRecord>& samples) {
+    static unsigned long buttonPressStartTime = 0;
+    static unsigned long lastLEDToggleTime = 0;
+    static unsigned long lastMetricsTime = 0;
+    static bool ledState = false;
+
+    PROFILE_SCOPE(UPLINK_LOOP);
+
+    // Advance WiFi / NTP / Firebase setup without blocking
+    {
+        PROFILE_SCOPE(CONNECTION);
+        connectionHandler.handle();
+    }
+
+    // Check if the boot button is pressed
+    if (digitalRead(BOOT_BUTTON_PIN) == LOW) {
+        if (buttonPressStartTime == 0) {
+            buttonPressStartTime = millis(); // Start timing the button press
+        } else if (millis() - buttonPressStartTime >= 3000) { // Button held for 3 seconds
+            if (!isBLEActive) {
+                LogHandler::writeMessage(LogHandler::DebugType::BLE, String("Starting BLE..."));
+                bleHandler.startListening();
+                isBLEActive = true; // Enable BLE
+            }
+        }
+    } else {
+        buttonPressStartTime = 0; // Reset timing if button is released
+    }
+
+    // Flicker the LED while BLE is active
+    if (isBLEActive) {
+        if (millis() - lastLEDToggleTime >= 500) { // Toggle LED every 500ms
+            lastLEDToggleTime = millis();
+            ledState = !ledState;
+            digitalWrite(LED_PIN, ledState ? HIGH : LOW);
+        }
+    }
+
+    // Handle OTA updates
+    // otaHandler.handle();
+
+    // Handle BLE communication
+    {
+        PROFILE_SCOPE(BLE);
+        bleHandler.handle();
+    }
+
+    // Send buffered telnet output without waiting on slow clients
+    {
+        PROFILE_SCOPE(TELNET);
+        telnetLogSink.handle();
+    }
+
+    {
+        PROFILE_SCOPE(UPLOAD);
+        // Collect samples from the acquisition task and decode them for upload
+        SampleRecord sample;
+        while (sampleQueue.pop(sample)) {
+            samples.push_back(sample);
+        }
+        if (!samples.empty()) {
+            streamSamples(samples);
+            uploadHandler.addData(samples);
+            samples.clear();
+        }
+
+        // Upload the sample batch once it is full or old enough
+        uploadHandler.sendData();
+    }
+
+    // Receive firebase messages
+    {
+        PROFILE_SCOPE(FIREBASE_READ);
+        firebaseHandler.readData();
+    }
+
+    reportPIDSupport();
+
+    // Send queued log messages as one update per interval
+    {
+        PROFILE_SCOPE(LOG_UPLOAD);
+        logUploadHandler.flush();
+    }
+
+    if (millis() - lastMetricsTime >= METRICS_INTERVAL) {
+        lastMetricsTime = millis();
+        logTaskMetrics();
+        reportLoopProfile();
+        reportCANHealth();
+    }
+}
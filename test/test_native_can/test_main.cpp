@@ -0,0 +1,308 @@
+// CANHandler against a fake controller: supported-PID discovery, requests,
+// responses, health and ISO-TP from a simulated ECU
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "CAN/CANHandler.hpp"
+#include "CAN/SupportedPIDs.hpp"
+#include "HOST/FakeCANController.hpp"
+#include "HOST/HostClock.hpp"
+#include "HOST/MemoryStorage.hpp"
+#include "HOST/VirtualBus.hpp"
+#include "HOST/VirtualECU.hpp"
+#include "SETTINGS/SettingsHandler.hpp"
+
+namespace {
+
+const char* VIN = "WVWZZZ1JZXW000001";
+
+void addPID(PIDTable& pids, byte pid, const char* label, const char* formula) {
+    PIDConfig& config = pids.add(pid);
+    config.label = label;
+    config.formula = formula;
+    config.program.compile(formula);
+}
+
+// RPM, speed and ambient temperature on one handler with a support cache
+struct Fixture {
+    HostClock& clock = HostClock::instance();
+    SharedPIDTable pidTables;
+    FakeCANController controller;
+    MemoryStorage supportCache;
+    CANHandler canHandler{controller, pidTables};
+    std::vector<SampleRecord> samples;
+
+    Fixture() {
+        std::shared_ptr<PIDTable> pids = std::make_shared<PIDTable>();
+        addPID(*pids, 0x0C, "RPM", "((A*256)+B)/4");
+        addPID(*pids, 0x0D, "Speed", "A");
+        addPID(*pids, 0x46, "AmbientTemp", "A-40");
+        pidTables.publish(pids);
+        canHandler.setSupportCache(&supportCache);
+    }
+};
+
+// VIN response of the primary ECU: First Frame, then two Consecutive Frames
+// after the handler's Flow Control
+void answerVIN(FakeCANController& controller, CANHandler& canHandler) {
+    const uint8_t frames[3][8] = {
+        {0x10, 0x14, 0x49, 0x02, 0x01, 'W', 'V', 'W'},
+        {0x21, 'Z', 'Z', 'Z', '1', 'J', 'Z', 'X'},
+        {0x22, 'W', '0', '0', '0', '0', '0', '1'},
+    };
+    std::vector<SampleRecord> samples;
+    controller.inject(0x7E8, frames[0], 8);
+    canHandler.handleResponses(samples);
+    controller.inject(0x7E8, frames[1], 8);
+    controller.inject(0x7E8, frames[2], 8);
+    canHandler.handleResponses(samples);
+}
+
+// Bitmaps 0x00 (05, 0C, 0D and 0x20 supported) and 0x20 (0x21 only, so
+// 0x46 is unsupported)
+const uint8_t BITMAP_00[8] = {0x06, 0x41, 0x00, 0x08, 0x18, 0x00, 0x01, 0x00};
+const uint8_t BITMAP_20[8] = {0x06, 0x41, 0x20, 0x80, 0x00, 0x00, 0x00, 0x00};
+
+// Runs discovery to the end and leaves the handler polling
+void discover(Fixture& f) {
+    TEST_ASSERT_TRUE(f.canHandler.begin());
+    f.canHandler.sendRequests();
+    f.controller.takeSent();
+    answerVIN(f.controller, f.canHandler);
+    f.clock.advance(100);
+    f.controller.takeSent();
+    f.canHandler.sendRequests();
+    f.controller.takeSent();
+    f.controller.inject(0x7E8, BITMAP_00, 8);
+    f.canHandler.handleResponses(f.samples);
+    f.clock.advance(100);
+    f.canHandler.sendRequests();
+    f.controller.takeSent();
+    f.controller.inject(0x7E8, BITMAP_20, 8);
+    f.canHandler.handleResponses(f.samples);
+    f.clock.advance(100);
+}
+
+} // namespace
+
+int isoTpBlockSize, isoTpStMin;
+
+void setUp() {
+    HostClock::instance().setManual(1700000000000ULL);
+    HostClock::instance().advance(1000);
+    isoTpBlockSize = SettingsHandler::getIsoTpBlockSize();
+    isoTpStMin = SettingsHandler::getIsoTpStMin();
+}
+
+void tearDown() {
+    SettingsHandler::setIsoTpBlockSize(isoTpBlockSize);
+    SettingsHandler::setIsoTpStMin(isoTpStMin);
+}
+
+void test_discovery_reads_vin_then_bitmaps() {
+    Fixture f;
+    TEST_ASSERT_TRUE(f.canHandler.begin());
+    f.canHandler.sendRequests();
+    std::vector<CANFrame> sent = f.controller.takeSent();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX8(0x09, sent[0].data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x02, sent[0].data[2]);
+
+    answerVIN(f.controller, f.canHandler);
+    f.clock.advance(100);
+    f.controller.takeSent();
+    f.canHandler.sendRequests();
+    sent = f.controller.takeSent();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX8(0x01, sent[0].data[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, sent[0].data[2]);
+
+    // The next bitmap is read while the previous one announces it
+    f.controller.inject(0x7E8, BITMAP_00, 8);
+    f.canHandler.handleResponses(f.samples);
+    f.clock.advance(100);
+    f.canHandler.sendRequests();
+    sent = f.controller.takeSent();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX8(0x20, sent[0].data[2]);
+    f.controller.inject(0x7E8, BITMAP_20, 8);
+    f.canHandler.handleResponses(f.samples);
+
+    CANHandler::PIDSupport support;
+    f.canHandler.getPIDSupport(support);
+    TEST_ASSERT_TRUE(support.discovered);
+    TEST_ASSERT_FALSE(support.fromCache);
+    TEST_ASSERT_EQUAL_STRING(VIN, support.vin);
+    TEST_ASSERT_EQUAL(2, support.bitmapCount);
+    TEST_ASSERT_EQUAL(1, support.unsupportedCount);
+    TEST_ASSERT_EQUAL_HEX8(0x46, support.unsupported[0]);
+    TEST_ASSERT_GREATER_THAN(0, f.supportCache.size("WVWZZZ1JZXW000001.pids"));
+}
+
+void test_out_of_order_bitmaps_ignored() {
+    SupportedPIDs bitmaps;
+    uint8_t next = 0;
+    TEST_ASSERT_TRUE(bitmaps.add(0x20, 0x80000000, next) == SupportedPIDs::AddResult::IGNORED);
+    TEST_ASSERT_EQUAL(0, bitmaps.getBitmapCount());
+    TEST_ASSERT_TRUE(bitmaps.add(0x00, 0x18000001, next) == SupportedPIDs::AddResult::MORE);
+    TEST_ASSERT_EQUAL_HEX8(0x20, next);
+    TEST_ASSERT_TRUE(bitmaps.add(0x00, 0x18000001, next) == SupportedPIDs::AddResult::IGNORED);
+}
+
+void test_request_and_response() {
+    Fixture f;
+    discover(f);
+    f.canHandler.sendRequests();
+    std::vector<CANFrame> sent = f.controller.takeSent();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX16(0x7DF, sent[0].id);
+    // Service 01 for 0C and 0D, the unsupported 0x46 left out
+    const uint8_t* request = sent[0].data;
+    TEST_ASSERT_EQUAL(3, request[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, request[1]);
+    TEST_ASSERT_NOT_NULL(memchr(&request[2], 0x0C, 2));
+    TEST_ASSERT_NOT_NULL(memchr(&request[2], 0x0D, 2));
+
+    const uint8_t ignored[8] = {0x02, 0x41, 0x0C, 0, 0, 0, 0, 0};
+    TEST_ASSERT_FALSE_MESSAGE(f.controller.inject(0x123, ignored, 8), "acceptance filter drops non-OBD IDs");
+    const uint8_t response[8] = {0x06, 0x41, 0x0C, 0x1A, 0xF8, 0x0D, 0x32, 0x00};
+    TEST_ASSERT_TRUE(f.controller.inject(0x7E8, response, 8));
+    f.clock.advance(20);
+    TEST_ASSERT_TRUE(f.canHandler.handleResponses(f.samples));
+    TEST_ASSERT_EQUAL(2, f.samples.size());
+    TEST_ASSERT_EQUAL_HEX8(0x0C, f.samples[0].pid);
+    TEST_ASSERT_EQUAL(2, f.samples[0].len);
+    TEST_ASSERT_EQUAL_HEX8(0x0D, f.samples[1].pid);
+    TEST_ASSERT_EQUAL(0x32, f.samples[1].data[0]);
+    // Polled reception: the VIN, both bitmaps and this response
+    CANHandler::RxStats rx = f.canHandler.getRxStats();
+    TEST_ASSERT_EQUAL(6, rx.receivedFrames);
+    TEST_ASSERT_EQUAL(0, rx.droppedFrames);
+}
+
+void test_health_recorded_per_pid() {
+    Fixture f;
+    discover(f);
+    f.canHandler.sendRequests();
+    f.controller.takeSent();
+    const uint8_t response[8] = {0x06, 0x41, 0x0C, 0x1A, 0xF8, 0x0D, 0x32, 0x00};
+    f.controller.inject(0x7E8, response, 8);
+    f.clock.advance(20);
+    f.canHandler.handleResponses(f.samples);
+
+    // Published on the next sendRequests() after HEALTH_INTERVAL_MS
+    f.controller.setErrorCounters(100, 3);
+    f.clock.advance(1000);
+    f.canHandler.sendRequests();
+    CANMetrics::Snapshot health;
+    f.canHandler.getHealth(health);
+    const CANMetrics::PIDMetrics* rpm = nullptr;
+    for (uint8_t i = 0; i < health.pidCount; i++) {
+        if (health.pids[i].pid == 0x0C) rpm = &health.pids[i];
+    }
+    TEST_ASSERT_NOT_NULL(rpm);
+    TEST_ASSERT_EQUAL(1, rpm->requests);
+    TEST_ASSERT_EQUAL(1, rpm->responses);
+    TEST_ASSERT_EQUAL(1, rpm->latencyBuckets[1]);
+    TEST_ASSERT_EQUAL(100, health.bus.txErrors);
+    TEST_ASSERT_EQUAL(1, health.bus.errorWarning);
+}
+
+void test_published_table_applied_by_next_request() {
+    Fixture f;
+    discover(f);
+    std::shared_ptr<const PIDTable> oldPids = f.pidTables.load();
+    std::shared_ptr<PIDTable> nextPids = std::make_shared<PIDTable>();
+    addPID(*nextPids, 0x05, "Coolant", "A-40");
+    f.pidTables.publish(nextPids);
+    f.canHandler.sendRequests();
+    std::vector<CANFrame> sent = f.controller.takeSent();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL(2, sent[0].data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x05, sent[0].data[2]);
+
+    // Holders of the old table keep a valid copy
+    TEST_ASSERT_NOT_NULL(oldPids->find(0x0D));
+    TEST_ASSERT_TRUE(oldPids->find(0x0D)->label == "Speed");
+    TEST_ASSERT_FALSE(f.pidTables.load()->contains(0x0D));
+}
+
+void test_cached_support_used_on_next_connect() {
+    Fixture f;
+    discover(f);
+
+    // Same vehicle again: the VIN finds the cached bitmaps, no bitmap queries
+    FakeCANController nextController;
+    CANHandler nextHandler(nextController, f.pidTables);
+    nextHandler.setSupportCache(&f.supportCache);
+    nextHandler.begin();
+    nextHandler.sendRequests();
+    nextController.takeSent();
+    answerVIN(nextController, nextHandler);
+    CANHandler::PIDSupport support;
+    nextHandler.getPIDSupport(support);
+    nextController.takeSent();
+    f.clock.advance(100);
+    nextHandler.sendRequests();
+    std::vector<CANFrame> sent = nextController.takeSent();
+    TEST_ASSERT_TRUE(support.discovered);
+    TEST_ASSERT_TRUE(support.fromCache);
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_HEX8(0x01, sent[0].data[1]);
+    TEST_ASSERT_NULL(memchr(&sent[0].data[2], 0x46, sent[0].data[0] - 1));
+}
+
+void test_multi_frame_responses_from_simulated_ecu() {
+    // The VIN and a DTC list span several frames, sent in blocks of 2 with
+    // a 2 ms separation time as the handler's Flow Control asks
+    HostClock& clock = HostClock::instance();
+    SettingsHandler::setIsoTpBlockSize(2);
+    SettingsHandler::setIsoTpStMin(2);
+    std::shared_ptr<PIDTable> pids = std::make_shared<PIDTable>();
+    addPID(*pids, 0x0C, "RPM", "((A*256)+B)/4");
+    SharedPIDTable pidTables;
+    pidTables.publish(pids);
+    FakeCANController controller;
+    VirtualBus bus(controller);
+    VirtualECU& ecu = bus.addECU(VirtualECU::Config());
+    ecu.addSignal({0x0C, 2, VirtualECU::Trace::CONSTANT, 3200, 3200, 0});
+    ecu.setVIN("1FTFW1ET5DFC10312");
+    const uint16_t dtcs[] = {0x0301, 0x0420, 0x4123, 0x0171, 0xC100};
+    for (uint16_t code : dtcs) ecu.addDTC(code);
+    CANHandler canHandler(controller, pidTables);
+    canHandler.begin();
+    std::vector<SampleRecord> samples;
+    auto runBus = [&](unsigned long ms) {
+        for (unsigned long us = 0; us < ms * 1000; us += 250) {
+            clock.advanceUs(250);
+            bus.update(clock.micros());
+            canHandler.sendRequests();
+            canHandler.handleResponses(samples);
+        }
+    };
+
+    runBus(500);
+    TEST_ASSERT_EQUAL_STRING("1FTFW1ET5DFC10312", canHandler.getVIN());
+    canHandler.requestStoredDTCs();
+    runBus(500);
+    TEST_ASSERT_EQUAL(5, canHandler.getDTCCount());
+    TEST_ASSERT_EQUAL_STRING("P0301", canHandler.getDTC(0).c_str());
+    TEST_ASSERT_EQUAL_STRING("C0123", canHandler.getDTC(2).c_str());
+    TEST_ASSERT_EQUAL_STRING("U0100", canHandler.getDTC(4).c_str());
+    TEST_ASSERT_EQUAL(2, ecu.getStats().multiFrame);
+    TEST_ASSERT_EQUAL(0, ecu.getStats().aborted);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_discovery_reads_vin_then_bitmaps);
+    RUN_TEST(test_out_of_order_bitmaps_ignored);
+    RUN_TEST(test_request_and_response);
+    RUN_TEST(test_health_recorded_per_pid);
+    RUN_TEST(test_published_table_applied_by_next_request);
+    RUN_TEST(test_cached_support_used_on_next_connect);
+    RUN_TEST(test_multi_frame_responses_from_simulated_ecu);
+    return UNITY_END();
+}
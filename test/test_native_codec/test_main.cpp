@@ -0,0 +1,176 @@
+// SampleCodec columnar batches and base64, as uploaded and as read back by
+// the decode command
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "CODEC/SampleCodec.hpp"
+
+namespace {
+
+TimedSample timed(uint64_t epochMs, uint16_t ecuId, uint8_t pid, uint64_t value, uint8_t len) {
+    TimedSample t = {};
+    t.epochMs = epochMs;
+    t.sample.ecuId = ecuId;
+    t.sample.pid = pid;
+    t.sample.len = len;
+    for (uint8_t b = 0; b < len; b++) t.sample.data[b] = (uint8_t)(value >> (8 * (len - 1 - b)));
+    return t;
+}
+
+bool sameSample(const TimedSample& a, const TimedSample& b) {
+    return a.epochMs == b.epochMs && a.sample.ecuId == b.sample.ecuId && a.sample.pid == b.sample.pid &&
+           a.sample.len == b.sample.len && memcmp(a.sample.data, b.sample.data, a.sample.len) == 0;
+}
+
+// Decode yields column by column (first appearance), each in batch order
+std::vector<TimedSample> byColumn(const std::vector<TimedSample>& samples) {
+    std::vector<TimedSample> ordered;
+    std::vector<bool> taken(samples.size(), false);
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (taken[i]) continue;
+        for (size_t j = i; j < samples.size(); j++) {
+            const SampleRecord& a = samples[i].sample;
+            const SampleRecord& b = samples[j].sample;
+            if (!taken[j] && a.pid == b.pid && a.ecuId == b.ecuId && a.len == b.len) {
+                ordered.push_back(samples[j]);
+                taken[j] = true;
+            }
+        }
+    }
+    return ordered;
+}
+
+// Two ECUs answering the same PID, values going down, timestamps going
+// back within a column and the full 8 byte value range
+std::vector<TimedSample> mixedBatch() {
+    const uint64_t t = 1700000000000ULL;
+    return {
+        timed(t + 100, 0x7E8, 0x0C, 0x1AF8, 2),
+        timed(t + 100, 0x7E9, 0x0C, 0x0BB8, 2),
+        timed(t + 100, 0x7E8, 0x0D, 50, 1),
+        timed(t + 200, 0x7E8, 0x0C, 0x0FA0, 2),
+        timed(t + 150, 0x7E9, 0x0C, 0x0001, 2),
+        timed(t + 200, 0x7E8, 0x0D, 0, 1),
+        timed(t, 0x7E8, 0x0D, 255, 1),
+        timed(t + 300, 0x7E8, 0x0C, 0x0000, 2),
+        timed(t + 250, 0x7E8, 0xA6, 0xFFFFFFFFFFFFFFFFULL, 8),
+        timed(t + 260, 0x7E8, 0xA6, 1, 8),
+        timed(t + 260, 0x7E8, 0x0C, 0xFFFF, 2),
+    };
+}
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_batch_round_trips_through_base64() {
+    std::vector<TimedSample> samples = mixedBatch();
+    uint8_t encoded[512];
+    size_t size = SampleCodec::encode(samples.data(), samples.size(), encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN(0, size);
+    TEST_ASSERT_LESS_THAN(samples.size() * sizeof(TimedSample), size);
+
+    char text[SampleCodec::base64Length(sizeof(encoded)) + 1];
+    size_t length = SampleCodec::base64Encode(encoded, size, text, sizeof(text));
+    TEST_ASSERT_EQUAL(SampleCodec::base64Length(size), length);
+    TEST_ASSERT_EQUAL(length, strlen(text));
+
+    uint8_t decoded[512];
+    TEST_ASSERT_EQUAL(size, SampleCodec::base64Decode(text, length, decoded, sizeof(decoded)));
+    TEST_ASSERT_EQUAL_MEMORY(encoded, decoded, size);
+
+    std::vector<TimedSample> result;
+    TEST_ASSERT_TRUE(SampleCodec::decode(decoded, size, [&](const TimedSample& sample) { result.push_back(sample); }));
+    std::vector<TimedSample> expected = byColumn(samples);
+    TEST_ASSERT_EQUAL(expected.size(), result.size());
+    for (size_t i = 0; i < expected.size(); i++) TEST_ASSERT_TRUE_MESSAGE(sameSample(expected[i], result[i]), "sample differs after the round trip");
+}
+
+void test_single_sample_round_trips() {
+    TimedSample sample = timed(1, 0x7EF, 0x46, 0x28, 1);
+    uint8_t encoded[64];
+    size_t size = SampleCodec::encode(&sample, 1, encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN(0, size);
+    size_t decodedCount = 0;
+    TEST_ASSERT_TRUE(SampleCodec::decode(encoded, size, [&](const TimedSample& decoded) {
+        TEST_ASSERT_TRUE(sameSample(sample, decoded));
+        decodedCount++;
+    }));
+    TEST_ASSERT_EQUAL(1, decodedCount);
+}
+
+void test_encode_fails_when_the_buffer_is_too_small() {
+    std::vector<TimedSample> samples = mixedBatch();
+    uint8_t encoded[512];
+    size_t size = SampleCodec::encode(samples.data(), samples.size(), encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN(0, size);
+    for (size_t outSize = 0; outSize < size; outSize++) {
+        TEST_ASSERT_EQUAL_MESSAGE(0, SampleCodec::encode(samples.data(), samples.size(), encoded, outSize), "short buffer accepted");
+    }
+    TEST_ASSERT_EQUAL(size, SampleCodec::encode(samples.data(), samples.size(), encoded, size));
+    TEST_ASSERT_EQUAL(0, SampleCodec::encode(samples.data(), 0, encoded, sizeof(encoded)));
+
+    // 12 bytes take 16 characters and the terminator
+    char text[17];
+    TEST_ASSERT_EQUAL(0, SampleCodec::base64Encode(encoded, 12, text, 16));
+    TEST_ASSERT_EQUAL(16, SampleCodec::base64Encode(encoded, 12, text, 17));
+    uint8_t small[2];
+    TEST_ASSERT_EQUAL(0, SampleCodec::base64Decode("Zm9v", 4, small, sizeof(small)));
+}
+
+void test_encode_fails_beyond_max_columns() {
+    std::vector<TimedSample> samples;
+    for (size_t i = 0; i <= SampleCodec::MAX_COLUMNS; i++) samples.push_back(timed(1000, 0x7E8, (uint8_t)i, i, 1));
+    uint8_t encoded[2048];
+    TEST_ASSERT_EQUAL(0, SampleCodec::encode(samples.data(), samples.size(), encoded, sizeof(encoded)));
+    samples.pop_back();
+    TEST_ASSERT_GREATER_THAN(0, SampleCodec::encode(samples.data(), samples.size(), encoded, sizeof(encoded)));
+}
+
+void test_malformed_batches_rejected() {
+    std::vector<TimedSample> samples = mixedBatch();
+    uint8_t encoded[512];
+    size_t size = SampleCodec::encode(samples.data(), samples.size(), encoded, sizeof(encoded));
+    auto ignore = [](const TimedSample&) {};
+    for (size_t truncated = 0; truncated < size; truncated++) {
+        TEST_ASSERT_FALSE_MESSAGE(SampleCodec::decode(encoded, truncated, ignore), "truncated batch accepted");
+    }
+    uint8_t copy[513];
+    memcpy(copy, encoded, size);
+    copy[size] = 0;
+    TEST_ASSERT_FALSE_MESSAGE(SampleCodec::decode(copy, size + 1, ignore), "trailing byte accepted");
+    copy[2] = SampleCodec::VERSION + 1;
+    TEST_ASSERT_FALSE_MESSAGE(SampleCodec::decode(copy, size, ignore), "unknown version accepted");
+}
+
+void test_base64_vectors() {
+    const char* vectors[][2] = {{"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"}, {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}};
+    for (const auto& vector : vectors) {
+        char text[16];
+        size_t size = strlen(vector[0]);
+        TEST_ASSERT_EQUAL(strlen(vector[1]), SampleCodec::base64Encode((const uint8_t*)vector[0], size, text, sizeof(text)));
+        TEST_ASSERT_EQUAL_STRING(vector[1], text);
+        uint8_t bytes[8];
+        TEST_ASSERT_EQUAL(size, SampleCodec::base64Decode(vector[1], strlen(vector[1]), bytes, sizeof(bytes)));
+        TEST_ASSERT_EQUAL_MEMORY(vector[0], bytes, size);
+    }
+    uint8_t bytes[8];
+    TEST_ASSERT_EQUAL_MESSAGE(0, SampleCodec::base64Decode("Zm9", 3, bytes, sizeof(bytes)), "length not a multiple of 4");
+    TEST_ASSERT_EQUAL_MESSAGE(0, SampleCodec::base64Decode("Zm9*", 4, bytes, sizeof(bytes)), "invalid character");
+    TEST_ASSERT_EQUAL_MESSAGE(0, SampleCodec::base64Decode("Zg==Zm9v", 8, bytes, sizeof(bytes)), "padding before the end");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_round_trips_through_base64);
+    RUN_TEST(test_single_sample_round_trips);
+    RUN_TEST(test_encode_fails_when_the_buffer_is_too_small);
+    RUN_TEST(test_encode_fails_beyond_max_columns);
+    RUN_TEST(test_malformed_batches_rejected);
+    RUN_TEST(test_base64_vectors);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+// PIDConfigCache on storage and SensorConfig deltas
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "CAN/SensorConfig.hpp"
+#include "HOST/MemoryStorage.hpp"
+#include "STORAGE/PIDConfigCache.hpp"
+
+namespace {
+
+const uint8_t RPM_BYTES[2] = {0x1A, 0xF8};
+
+void addPID(PIDTable& pids, byte pid, const char* label, const char* formula) {
+    PIDConfig& config = pids.add(pid);
+    config.label = label;
+    config.formula = formula;
+    config.program.compile(formula);
+}
+
+void fillTable(PIDTable& pids) {
+    addPID(pids, 0x0C, "RPM", "((A*256)+B)/4");
+    addPID(pids, 0x0D, "Speed", "A");
+    addPID(pids, 0x46, "AmbientTemp", "A-40");
+}
+
+// RPM, speed and ambient temperature as list entries 0..2
+void fillSensors(SensorConfig& sensors) {
+    const char* fields[3][3] = {{"RPM", "((A*256)+B)/4", "rpm"}, {"Speed", "A", "km/h"}, {"AmbientTemp", "A-40", "C"}};
+    const int pids[3] = {0x0C, 0x0D, 0x46};
+    for (uint16_t i = 0; i < 3; i++) {
+        SensorConfig::Entry entry;
+        entry.enabled = true;
+        entry.pid = pids[i];
+        entry.label = fields[i][0];
+        entry.formula = fields[i][1];
+        entry.unit = fields[i][2];
+        sensors.set(i, entry);
+    }
+}
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_cache_round_trip_with_compiled_formulas() {
+    PIDTable table;
+    fillTable(table);
+    MemoryStorage storage;
+    PIDConfigCache cache(storage);
+    TEST_ASSERT_TRUE(cache.save(table, "\"v7\""));
+    TEST_ASSERT_EQUAL_UINT32(PIDConfigCache::hashOf(table), cache.getHash());
+
+    PIDConfigCache bootCache(storage);
+    PIDTable cached;
+    TEST_ASSERT_TRUE(bootCache.load(cached));
+    TEST_ASSERT_EQUAL(table.size(), cached.size());
+    TEST_ASSERT_EQUAL_STRING("\"v7\"", bootCache.getRemoteVersion());
+    const PIDConfig* rpm = cached.find(0x0C);
+    TEST_ASSERT_NOT_NULL(rpm);
+    TEST_ASSERT_TRUE(rpm->label == "RPM");
+    double value = 0;
+    TEST_ASSERT_TRUE(rpm->program.evaluate(RPM_BYTES, 2, value));
+    TEST_ASSERT_EQUAL_DOUBLE(1726, value);
+}
+
+void test_hash_tells_changed_configs_apart() {
+    PIDTable table, same, other;
+    fillTable(table);
+    fillTable(same);
+    addPID(other, 0x05, "Coolant", "A-40");
+    TEST_ASSERT_EQUAL_UINT32(PIDConfigCache::hashOf(table), PIDConfigCache::hashOf(same));
+    TEST_ASSERT_TRUE(PIDConfigCache::hashOf(table) != PIDConfigCache::hashOf(other));
+}
+
+void test_damaged_cache_rejected() {
+    PIDTable table;
+    fillTable(table);
+    MemoryStorage storage;
+    TEST_ASSERT_TRUE(PIDConfigCache(storage).save(table, ""));
+    std::vector<uint8_t> damaged(storage.size("pids.bin"));
+    storage.read("pids.bin", 0, damaged.data(), damaged.size());
+    damaged.back() ^= 0xFF;
+    storage.write("pids.bin", damaged.data(), damaged.size());
+    PIDTable loaded;
+    TEST_ASSERT_FALSE(PIDConfigCache(storage).load(loaded));
+}
+
+// An unchanged entry list is not swapped in again
+void test_sensor_entries_build_a_table() {
+    SensorConfig sensors;
+    fillSensors(sensors);
+    std::shared_ptr<const PIDTable> table = sensors.buildTable(PIDTable());
+    TEST_ASSERT_NOT_NULL(table.get());
+    TEST_ASSERT_EQUAL(3, table->size());
+    TEST_ASSERT_NULL(sensors.buildTable(*table).get());
+}
+
+// A delta builds a new table; the old one stays valid for its readers and
+// unchanged formulas are carried over instead of compiled again
+void test_sensor_deltas_update_and_remove_pids() {
+    SensorConfig sensors;
+    fillSensors(sensors);
+    std::shared_ptr<const PIDTable> previous = sensors.buildTable(PIDTable());
+    sensors.find(1)->rate = 10;
+    sensors.remove(2);
+    std::shared_ptr<const PIDTable> table = sensors.buildTable(*previous);
+    TEST_ASSERT_NOT_NULL(table.get());
+    TEST_ASSERT_EQUAL(2, table->size());
+    TEST_ASSERT_EQUAL(100, table->find(0x0D)->periodMs);
+    TEST_ASSERT_FALSE(table->contains(0x46));
+    TEST_ASSERT_EQUAL(3, previous->size());
+    TEST_ASSERT_NOT_NULL(previous->find(0x46));
+    double value = 0;
+    TEST_ASSERT_TRUE(table->find(0x0C)->program.evaluate(RPM_BYTES, 2, value));
+    TEST_ASSERT_EQUAL_DOUBLE(1726, value);
+}
+
+void test_sensor_index_beyond_max_rejected() {
+    SensorConfig sensors;
+    TEST_ASSERT_FALSE(sensors.set(SensorConfig::MAX_SENSORS, SensorConfig::Entry()));
+    TEST_ASSERT_EQUAL(0, sensors.size());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cache_round_trip_with_compiled_formulas);
+    RUN_TEST(test_hash_tells_changed_configs_apart);
+    RUN_TEST(test_damaged_cache_rejected);
+    RUN_TEST(test_sensor_entries_build_a_table);
+    RUN_TEST(test_sensor_deltas_update_and_remove_pids);
+    RUN_TEST(test_sensor_index_beyond_max_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,180 @@
+// PIDFormula compilation and evaluation
+#include <Arduino.h>
+#include <string>
+#include <unity.h>
+
+#include "CAN/PIDFormula.hpp"
+
+namespace {
+
+// A = 0x12, B = 0x34, C = 0x80, D = 0xFF, fifth byte (B7) = 0x05
+const uint8_t DATA[5] = {0x12, 0x34, 0x80, 0xFF, 0x05};
+
+struct Case {
+    const char* formula;
+    double expected;
+};
+
+struct Rejected {
+    const char* formula;
+    const char* error;
+    uint8_t position;
+};
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_formulas_evaluate_to_expected_values() {
+    const Case cases[] = {
+        // Precedence and associativity as in C
+        {"A+B*2", 122},
+        {"(A+B)*2", 140},
+        {"A-B-C", -162},
+        {"C/4/2", 16},
+        {"A%5", 3},
+        {"1+2<<3", 24},
+        {"A|B&0x0F", 22},
+        {"A^B", 38},
+        {"A|B^C&D", 18 | (52 ^ (128 & 255))},
+        {"-A+B", 34},
+        {"--A", 18},
+        {" ( ( A * 256 ) + B ) / 4 ", 1165},
+        {"D*100/255", 100},
+        {"0.5*A", 9},
+        {"0x1F", 31},
+        // Operands
+        {"A+B+C+D", 453},
+        {"B3", 0x12},
+        {"B4", 0x34},
+        {"B3+B7", 23},
+        // Bit extraction and signed bytes
+        {"bit(C, 7)", 1},
+        {"bit(C, 6)", 0},
+        {"BIT(A, 4)", 1},
+        {"bit(A >> 1, 0)", 1},
+        {"s8(A)", 18},
+        {"s8(C)", -128},
+        {"s8(D)", -1},
+        {"s8(D)*2+1", -1},
+        {"s16(C, A)", -32750},
+        {"s16(A, B)", 0x1234},
+    };
+    PIDFormula formula;
+    for (const Case& c : cases) {
+        TEST_ASSERT_TRUE_MESSAGE(formula.compile(c.formula), c.formula);
+        double value = 0;
+        TEST_ASSERT_TRUE_MESSAGE(formula.evaluate(DATA, sizeof(DATA), value), c.formula);
+        TEST_ASSERT_EQUAL_DOUBLE_MESSAGE(c.expected, value, c.formula);
+    }
+}
+
+void test_bytes_used_follows_the_highest_operand() {
+    PIDFormula formula;
+    TEST_ASSERT_TRUE(formula.compile("A*256+B"));
+    TEST_ASSERT_EQUAL(2, formula.bytesUsed());
+    TEST_ASSERT_TRUE(formula.compile("B7"));
+    TEST_ASSERT_EQUAL(5, formula.bytesUsed());
+    TEST_ASSERT_TRUE(formula.compile("42"));
+    TEST_ASSERT_EQUAL(0, formula.bytesUsed());
+}
+
+// Formulas evaluate in double: 32 bit values stay exact
+void test_32_bit_values_exact() {
+    PIDFormula formula;
+    double value = 0;
+    const uint8_t bytes[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+    TEST_ASSERT_TRUE(formula.compile("A*16777216+B*65536+C*256+D"));
+    TEST_ASSERT_TRUE(formula.evaluate(bytes, 4, value));
+    TEST_ASSERT_TRUE(value == 4294967295.0);
+}
+
+// Shifts act on the 32 bit pattern
+void test_shift_of_negative_value_defined() {
+    PIDFormula formula;
+    double value = 0;
+    const uint8_t bytes[1] = {0};
+    TEST_ASSERT_TRUE(formula.compile("-1 << 4"));
+    TEST_ASSERT_TRUE(formula.evaluate(bytes, 0, value));
+    TEST_ASSERT_TRUE(value == 4294967280.0);
+}
+
+void test_malformed_formulas_rejected() {
+    const Rejected cases[] = {
+        {"", "Empty formula", 0},
+        {"   ", "Empty formula", 3},
+        {"A+", "Unexpected end of formula", 2},
+        {"(A+B", "Expected ')'", 4},
+        {"A B", "Unexpected character", 2},
+        {"A $ B", "Unexpected character", 2},
+        {"E", "Unknown identifier", 0},
+        {"B8", "Unknown identifier", 0},
+        {"A+rpm", "Unknown identifier", 2},
+        {"bit(A)", "Expected ','", 5},
+        {"s8 A", "Expected '('", 3},
+        {"s16(A, B", "Expected ')'", 8},
+    };
+    PIDFormula formula;
+    for (const Rejected& c : cases) {
+        TEST_ASSERT_FALSE_MESSAGE(formula.compile(c.formula), c.formula);
+        TEST_ASSERT_FALSE(formula.isValid());
+        TEST_ASSERT_NOT_NULL(formula.getError());
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(c.error, formula.getError(), c.formula);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(c.position, formula.getErrorPosition(), c.formula);
+    }
+}
+
+void test_program_limits_rejected() {
+    PIDFormula formula;
+
+    std::string constants = "1";
+    for (int i = 2; i <= PIDFormula::MAX_CONSTANTS; i++) constants += "+" + std::to_string(i);
+    TEST_ASSERT_TRUE(formula.compile(constants.c_str()));
+    constants += "+9";
+    TEST_ASSERT_FALSE(formula.compile(constants.c_str()));
+    TEST_ASSERT_EQUAL_STRING("Too many constants", formula.getError());
+
+    // n operands and n - 1 additions
+    std::string instructions = "A";
+    for (int i = 1; i < (PIDFormula::MAX_INSTRUCTIONS + 1) / 2; i++) instructions += "+A";
+    TEST_ASSERT_TRUE(formula.compile(instructions.c_str()));
+    instructions += "+A";
+    TEST_ASSERT_FALSE(formula.compile(instructions.c_str()));
+    TEST_ASSERT_EQUAL_STRING("Formula too long", formula.getError());
+
+    // A+(A+(...)) keeps every operand on the stack until the innermost addition
+    std::string nested = "A";
+    for (int i = 1; i < PIDFormula::MAX_STACK; i++) nested = "A+(" + nested + ")";
+    TEST_ASSERT_TRUE(formula.compile(nested.c_str()));
+    nested = "A+(" + nested + ")";
+    TEST_ASSERT_FALSE(formula.compile(nested.c_str()));
+    TEST_ASSERT_EQUAL_STRING("Formula nested too deeply", formula.getError());
+}
+
+void test_evaluation_failures() {
+    PIDFormula formula;
+    double value = 0;
+    TEST_ASSERT_FALSE_MESSAGE(formula.evaluate(DATA, sizeof(DATA), value), "not compiled");
+    TEST_ASSERT_TRUE(formula.compile("A*256+B"));
+    TEST_ASSERT_FALSE_MESSAGE(formula.evaluate(DATA, 1, value), "byte beyond the response");
+    TEST_ASSERT_TRUE(formula.compile("A/(B-52)"));
+    TEST_ASSERT_FALSE_MESSAGE(formula.evaluate(DATA, sizeof(DATA), value), "division by zero");
+    TEST_ASSERT_TRUE(formula.compile("A%0"));
+    TEST_ASSERT_FALSE_MESSAGE(formula.evaluate(DATA, sizeof(DATA), value), "modulo by zero");
+    TEST_ASSERT_FALSE(formula.compile("A+"));
+    TEST_ASSERT_FALSE_MESSAGE(formula.evaluate(DATA, sizeof(DATA), value), "failed compile leaves no program");
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_formulas_evaluate_to_expected_values);
+    RUN_TEST(test_bytes_used_follows_the_highest_operand);
+    RUN_TEST(test_32_bit_values_exact);
+    RUN_TEST(test_shift_of_negative_value_defined);
+    RUN_TEST(test_malformed_formulas_rejected);
+    RUN_TEST(test_program_limits_rejected);
+    RUN_TEST(test_evaluation_failures);
+    return UNITY_END();
+}
@@ -0,0 +1,250 @@
+// JournalHandler store-and-forward on MemoryStorage and on files
+#include <Arduino.h>
+#include <functional>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+#include "HOST/FakeUplink.hpp"
+#include "HOST/HostClock.hpp"
+#include "HOST/MemoryStorage.hpp"
+#include "SETTINGS/SettingsHandler.hpp"
+#include "STORAGE/FileStorage.hpp"
+#include "STORAGE/JournalHandler.hpp"
+#include "UPLOAD/UploadHandler.hpp"
+
+namespace {
+
+using Record = JournalHandler::Record;
+
+// Record n carries n in its timestamps, so order and gaps are visible
+Record record(uint32_t n) {
+    Record r = {};
+    r.epochMs = 1700000000000ULL + n;
+    r.sample.timestampMs = n;
+    r.sample.ecuId = 0x7E8;
+    r.sample.pid = 0x0D;
+    r.sample.len = 1;
+    r.sample.data[0] = (uint8_t)n;
+    return r;
+}
+
+bool appendRange(JournalHandler& journal, uint32_t first, uint32_t count) {
+    std::vector<Record> records;
+    for (uint32_t i = 0; i < count; i++) records.push_back(record(first + i));
+    return journal.append(records.data(), records.size());
+}
+
+// Reads and acknowledges count records, checking they continue at first
+void consumeRange(JournalHandler& journal, uint32_t first, uint32_t count) {
+    Record buffer[100];
+    while (count > 0) {
+        size_t read = journal.read(buffer, count < 100 ? count : 100);
+        TEST_ASSERT_GREATER_THAN(0, read);
+        for (size_t i = 0; i < read; i++) TEST_ASSERT_EQUAL_UINT64(record(first + i).epochMs, buffer[i].epochMs);
+        journal.acknowledge(read);
+        first += read;
+        count -= read;
+    }
+}
+
+uint64_t nextEpoch(JournalHandler& journal) {
+    Record buffer;
+    return journal.read(&buffer, 1) == 1 ? buffer.epochMs : 0;
+}
+
+// A fresh directory under /tmp standing in for the flash partition
+struct TempDirectory {
+    char path[32] = "/tmp/obd-journal-test-XXXXXX";
+    bool created;
+
+    TempDirectory() { created = mkdtemp(path) != nullptr; }
+    ~TempDirectory() {
+        if (!created) return;
+        FileStorage storage(path);
+        std::vector<std::string> names;
+        storage.list([&](const char* name) { names.push_back(name); });
+        for (const std::string& name : names) storage.remove(name.c_str());
+        rmdir(path);
+    }
+};
+
+// Runs the scenario on RAM storage and again on files
+void onBothStorages(const std::function<void(Storage&)>& scenario) {
+    MemoryStorage memory;
+    scenario(memory);
+    TempDirectory directory;
+    TEST_ASSERT_TRUE(directory.created);
+    FileStorage files(directory.path);
+    scenario(files);
+}
+
+} // namespace
+
+void setUp() {
+    HostClock::instance().setManual(1700000000000ULL);
+}
+
+void tearDown() {
+    SettingsHandler::setUploadBatchSize(SettingsHandler::DEFAULT_UPLOAD_BATCH_SIZE);
+}
+
+// Across segment boundaries, and read() does not consume
+void test_replay_in_append_order() {
+    onBothStorages([](Storage& storage) {
+        JournalHandler journal(storage);
+        TEST_ASSERT_TRUE(journal.begin());
+        for (uint32_t first = 0; first < 600; first += 100) TEST_ASSERT_TRUE(appendRange(journal, first, 100));
+        TEST_ASSERT_EQUAL(600, journal.pending());
+        TEST_ASSERT_EQUAL_UINT64(record(0).epochMs, nextEpoch(journal));
+        TEST_ASSERT_EQUAL_UINT64(record(0).epochMs, nextEpoch(journal));
+        consumeRange(journal, 0, 600);
+        TEST_ASSERT_EQUAL(0, journal.pending());
+        TEST_ASSERT_EQUAL(600, journal.getStats().acknowledged);
+        // Drained segments are deleted
+        TEST_ASSERT_TRUE(storage.size("00000000.seg") < 0);
+        TEST_ASSERT_TRUE(storage.size("00000002.seg") < 0);
+    });
+}
+
+// Full journal: the oldest segment goes, pending or not
+void test_oldest_segment_evicted_at_the_size_cap() {
+    onBothStorages([](Storage& storage) {
+        JournalHandler journal(storage, 2);
+        TEST_ASSERT_TRUE(journal.begin());
+        const uint32_t segment = JournalHandler::SEGMENT_RECORDS;
+        TEST_ASSERT_TRUE(appendRange(journal, 0, 2 * segment));
+        TEST_ASSERT_EQUAL(0, journal.getStats().evicted);
+        TEST_ASSERT_TRUE(appendRange(journal, 2 * segment, 10));
+        TEST_ASSERT_EQUAL(segment, journal.getStats().evicted);
+        TEST_ASSERT_EQUAL(segment + 10, journal.pending());
+        consumeRange(journal, segment, segment + 10);
+    });
+}
+
+// Part of the oldest segment was already acknowledged: only the rest counts as lost
+void test_eviction_counts_only_unacknowledged_records() {
+    onBothStorages([](Storage& storage) {
+        JournalHandler journal(storage, 2);
+        TEST_ASSERT_TRUE(journal.begin());
+        const uint32_t segment = JournalHandler::SEGMENT_RECORDS;
+        TEST_ASSERT_TRUE(appendRange(journal, 0, 2 * segment));
+        consumeRange(journal, 0, 100);
+        TEST_ASSERT_TRUE(appendRange(journal, 2 * segment, 1));
+        TEST_ASSERT_EQUAL(segment - 100, journal.getStats().evicted);
+        TEST_ASSERT_EQUAL_UINT64(record(segment).epochMs, nextEpoch(journal));
+    });
+}
+
+void test_cursor_persists_across_reopen() {
+    onBothStorages([](Storage& storage) {
+        const uint32_t segment = JournalHandler::SEGMENT_RECORDS;
+        {
+            JournalHandler journal(storage);
+            TEST_ASSERT_TRUE(journal.begin());
+            TEST_ASSERT_TRUE(appendRange(journal, 0, segment + 100));
+            consumeRange(journal, 0, 100);
+        }
+        {
+            JournalHandler journal(storage);
+            TEST_ASSERT_TRUE(journal.begin());
+            TEST_ASSERT_EQUAL(segment, journal.pending());
+            TEST_ASSERT_EQUAL_UINT64(record(100).epochMs, nextEpoch(journal));
+            // Into the second segment, then appends continue after the last record
+            consumeRange(journal, 100, segment - 50);
+            TEST_ASSERT_TRUE(appendRange(journal, segment + 100, 5));
+        }
+        JournalHandler journal(storage);
+        TEST_ASSERT_TRUE(journal.begin());
+        TEST_ASSERT_EQUAL(55, journal.pending());
+        consumeRange(journal, segment + 50, 55);
+        TEST_ASSERT_EQUAL(0, journal.pending());
+    });
+}
+
+// A power cut in the middle of an append leaves part of a record behind
+void test_partial_record_dropped_on_reopen() {
+    onBothStorages([](Storage& storage) {
+        {
+            JournalHandler journal(storage);
+            TEST_ASSERT_TRUE(journal.begin());
+            TEST_ASSERT_TRUE(appendRange(journal, 0, 10));
+        }
+        Record torn = record(10);
+        TEST_ASSERT_TRUE(storage.append("00000000.seg", &torn, sizeof(Record) / 2));
+
+        JournalHandler journal(storage);
+        TEST_ASSERT_TRUE(journal.begin());
+        TEST_ASSERT_EQUAL(10, journal.pending());
+        TEST_ASSERT_EQUAL(10 * sizeof(Record), storage.size("00000000.seg"));
+        TEST_ASSERT_TRUE(appendRange(journal, 10, 2));
+        consumeRange(journal, 0, 12);
+    });
+}
+
+// Storage fails midway through an append: whole records are kept and
+// counted, the torn one is cut off and the next append continues after them
+void test_failed_append_truncated_to_whole_records() {
+    MemoryStorage storage;
+    JournalHandler journal(storage);
+    TEST_ASSERT_TRUE(journal.begin());
+    storage.failAfter(2 * sizeof(Record) + sizeof(Record) / 2);
+    TEST_ASSERT_FALSE(appendRange(journal, 0, 5));
+    TEST_ASSERT_EQUAL(1, journal.getStats().writeErrors);
+    TEST_ASSERT_EQUAL(2, journal.getStats().appended);
+    TEST_ASSERT_EQUAL(2, journal.pending());
+    TEST_ASSERT_EQUAL(2 * sizeof(Record), storage.size("00000000.seg"));
+    storage.failAfter(-1);
+    TEST_ASSERT_TRUE(appendRange(journal, 2, 3));
+    consumeRange(journal, 0, 5);
+}
+
+// Replayed records leave flash only once the upload succeeded
+void test_failed_replay_upload_keeps_records() {
+    HostClock& clock = HostClock::instance();
+    MemoryStorage storage;
+    JournalHandler journal(storage);
+    TEST_ASSERT_TRUE(journal.begin());
+    TEST_ASSERT_TRUE(appendRange(journal, 0, 150));
+
+    std::shared_ptr<PIDTable> pids = std::make_shared<PIDTable>();
+    PIDConfig& speed = pids->add(0x0D);
+    speed.label = "Speed";
+    speed.formula = "A";
+    speed.program.compile("A");
+    SharedPIDTable pidTables;
+    pidTables.publish(pids);
+    FakeUplink uplink;
+    UploadHandler uploadHandler(uplink, clock, pidTables);
+    uploadHandler.setJournal(&journal);
+    SettingsHandler::setUploadBatchSize(100);
+
+    uplink.setFailing(true);
+    clock.advance(1000);
+    TEST_ASSERT_FALSE(uploadHandler.sendData());
+    TEST_ASSERT_EQUAL(150, journal.pending());
+    TEST_ASSERT_EQUAL(0, journal.getStats().acknowledged);
+    TEST_ASSERT_EQUAL(1, uploadHandler.getUploadStats().failures);
+
+    uplink.setFailing(false);
+    clock.advance(SettingsHandler::getUploadBatchAge());
+    TEST_ASSERT_TRUE(uploadHandler.sendData());
+    TEST_ASSERT_EQUAL(50, journal.pending());
+    TEST_ASSERT_EQUAL(100, uploadHandler.getUploadStats().replayed);
+    TEST_ASSERT_TRUE(uplink.getUpdates().back().json.find("\"1700000000000\":{\"Speed\":0}") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT64(record(100).epochMs, nextEpoch(journal));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_in_append_order);
+    RUN_TEST(test_oldest_segment_evicted_at_the_size_cap);
+    RUN_TEST(test_eviction_counts_only_unacknowledged_records);
+    RUN_TEST(test_cursor_persists_across_reopen);
+    RUN_TEST(test_partial_record_dropped_on_reopen);
+    RUN_TEST(test_failed_append_truncated_to_whole_records);
+    RUN_TEST(test_failed_replay_upload_keeps_records);
+    return UNITY_END();
+}
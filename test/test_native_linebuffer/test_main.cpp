@@ -0,0 +1,158 @@
+// LineBuffer, the per-client output of the telnet sink: a client that falls
+// behind loses whole lines, never blocks the writer or gets torn lines
+#include <Arduino.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+
+#include "UTILS/LineBuffer.hpp"
+
+namespace {
+
+bool push(LineBuffer<64>& buffer, const std::string& line) {
+    return buffer.push(line.c_str(), line.length());
+}
+
+// A slow client: takes at most chunk bytes per send, like a socket with a
+// small send buffer, until the buffer is empty
+template <size_t N>
+std::string drain(LineBuffer<N>& buffer, size_t chunk = 1000) {
+    std::string received;
+    const char* data;
+    size_t len;
+    while ((len = buffer.peek(data)) > 0) {
+        if (len > chunk) len = chunk;
+        received.append(data, len);
+        buffer.consume(len);
+    }
+    return received;
+}
+
+} // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_lines_kept_whole_with_crlf() {
+    LineBuffer<64> buffer;
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_TRUE(push(buffer, "first"));
+    TEST_ASSERT_TRUE(push(buffer, "second"));
+    TEST_ASSERT_EQUAL(15, buffer.size());
+    TEST_ASSERT_EQUAL_STRING("first\r\nsecond\r\n", drain(buffer).c_str());
+    TEST_ASSERT_TRUE(buffer.empty());
+}
+
+// A line and its CRLF exactly filling the buffer still fit
+void test_exact_fit_accepted() {
+    LineBuffer<64> buffer;
+    TEST_ASSERT_TRUE(push(buffer, std::string(62, 'x')));
+    TEST_ASSERT_FALSE(push(buffer, ""));
+    TEST_ASSERT_EQUAL(1, buffer.getDropped());
+    TEST_ASSERT_EQUAL(64, drain(buffer).length());
+}
+
+// The writer never waits: lines that do not fit are dropped and counted,
+// what is queued stays intact
+void test_overflow_drops_whole_lines() {
+    LineBuffer<64> buffer;
+    const std::string line(18, 'a'); // 20 bytes with CRLF
+    int accepted = 0;
+    for (int i = 0; i < 10; i++) accepted += push(buffer, line) ? 1 : 0;
+    TEST_ASSERT_EQUAL(3, accepted);
+    TEST_ASSERT_EQUAL(7, buffer.getDropped());
+    TEST_ASSERT_EQUAL(60, buffer.size());
+    std::string received = drain(buffer);
+    TEST_ASSERT_EQUAL_STRING((line + "\r\n" + line + "\r\n" + line + "\r\n").c_str(), received.c_str());
+}
+
+// The loss is reported in front of the next line that fits
+void test_drop_count_reported_before_the_next_line() {
+    LineBuffer<64> buffer;
+    TEST_ASSERT_TRUE(push(buffer, std::string(55, 'a')));
+    TEST_ASSERT_FALSE(push(buffer, "lost one"));
+    TEST_ASSERT_FALSE(push(buffer, "lost two"));
+    drain(buffer);
+    TEST_ASSERT_TRUE(push(buffer, "next"));
+    TEST_ASSERT_EQUAL_STRING("... 2 lines dropped\r\nnext\r\n", drain(buffer).c_str());
+    TEST_ASSERT_EQUAL(2, buffer.getDropped());
+    // Reported once
+    TEST_ASSERT_TRUE(push(buffer, "after"));
+    TEST_ASSERT_EQUAL_STRING("after\r\n", drain(buffer).c_str());
+}
+
+// The note and the line go in together or not at all
+void test_note_and_line_dropped_together() {
+    LineBuffer<64> buffer;
+    TEST_ASSERT_TRUE(push(buffer, std::string(40, 'a')));
+    TEST_ASSERT_FALSE(push(buffer, std::string(30, 'b')));
+    // 20 bytes free: "... 1 lines dropped\r\n" alone does not fit
+    TEST_ASSERT_FALSE(push(buffer, "c"));
+    TEST_ASSERT_EQUAL(2, buffer.getDropped());
+    drain(buffer);
+    TEST_ASSERT_TRUE(push(buffer, "d"));
+    TEST_ASSERT_EQUAL_STRING("... 2 lines dropped\r\nd\r\n", drain(buffer).c_str());
+}
+
+// Partial sends leave the rest of a line queued, across the wrap of the ring
+void test_partial_consumption_across_wrap() {
+    LineBuffer<64> buffer;
+    std::string expected, received;
+    for (int i = 0; i < 40; i++) {
+        std::string line = "line " + std::to_string(i);
+        TEST_ASSERT_TRUE(push(buffer, line));
+        expected += line + "\r\n";
+        // Takes 3 bytes of the oldest line per round, falls behind slowly
+        const char* data;
+        size_t len = buffer.peek(data);
+        if (len > 3) len = 3;
+        received.append(data, len);
+        buffer.consume(len);
+        if (buffer.size() > 40) received += drain(buffer, 7);
+    }
+    received += drain(buffer, 5);
+    TEST_ASSERT_EQUAL(0, buffer.getDropped());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), received.c_str());
+}
+
+// peek() only returns the contiguous part up to the end of the ring
+void test_peek_is_contiguous() {
+    LineBuffer<16> buffer;
+    TEST_ASSERT_TRUE(buffer.push("abcdefgh", 8));
+    buffer.consume(10);
+    TEST_ASSERT_TRUE(buffer.push("0123456789", 10));
+    const char* data;
+    TEST_ASSERT_EQUAL(6, buffer.peek(data));
+    TEST_ASSERT_EQUAL(0, strncmp(data, "012345", 6));
+    buffer.consume(6);
+    TEST_ASSERT_EQUAL(6, buffer.peek(data));
+    TEST_ASSERT_EQUAL(0, strncmp(data, "6789\r\n", 6));
+    buffer.consume(100);
+    TEST_ASSERT_TRUE(buffer.empty());
+}
+
+// A disconnect clears the queue and the pending note, not the total
+void test_clear_forgets_pending_drops() {
+    LineBuffer<64> buffer;
+    TEST_ASSERT_TRUE(push(buffer, std::string(60, 'a')));
+    TEST_ASSERT_FALSE(push(buffer, "lost"));
+    buffer.clear();
+    TEST_ASSERT_TRUE(buffer.empty());
+    TEST_ASSERT_TRUE(push(buffer, "fresh"));
+    TEST_ASSERT_EQUAL_STRING("fresh\r\n", drain(buffer).c_str());
+    TEST_ASSERT_EQUAL(1, buffer.getDropped());
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lines_kept_whole_with_crlf);
+    RUN_TEST(test_exact_fit_accepted);
+    RUN_TEST(test_overflow_drops_whole_lines);
+    RUN_TEST(test_drop_count_reported_before_the_next_line);
+    RUN_TEST(test_note_and_line_dropped_together);
+    RUN_TEST(test_partial_consumption_across_wrap);
+    RUN_TEST(test_peek_is_contiguous);
+    RUN_TEST(test_clear_forgets_pending_drops);
+    return UNITY_END();
+}
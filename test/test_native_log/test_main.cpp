@@ -0,0 +1,52 @@
+// Binary log records and the packed log stream
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+#include "CODEC/LogCodec.hpp"
+#include "HOST/HostClock.hpp"
+#include "LOG/LogHandler.hpp"
+#include "SETTINGS/SettingsHandler.hpp"
+
+void setUp() {
+    HostClock::instance().setManual(1700000000000ULL);
+    SettingsHandler::setEnableLogs(true);
+}
+
+void tearDown() {
+    SettingsHandler::setEnableLogs(false);
+}
+
+void test_binary_record_formatted_at_drain_time() {
+    const uint8_t pids[] = {0x0C, 0x0D};
+    uint32_t first, second;
+    LogHandler::packPids(pids, 2, first, second);
+    LogHandler::writeBinary(LogFormat::CAN_REQUEST_SENT, first, second);
+    std::vector<LogHandler::LogEntry> logs = LogHandler::getAndClearLogs();
+    TEST_ASSERT_FALSE(logs.empty());
+    TEST_ASSERT_EQUAL_STRING("Request sent for PIDs: c, d", logs.back().message.c_str());
+}
+
+void test_binary_stream_decodes_and_formats() {
+    BinaryLogRecord record = {1000, (uint16_t)LogFormat::CAN_NEGATIVE_RESPONSE, 2, {0x31, 0x01, 0, 0}};
+    uint8_t packed[32];
+    size_t packedSize = LogCodec::encode(&record, 1, 1700000000000ULL, packed, sizeof(packed));
+    TEST_ASSERT_GREATER_THAN(0, packedSize);
+    char line[LogHandler::LogRecord::MAX_MESSAGE] = "";
+    uint64_t bootEpochMs = 0;
+    TEST_ASSERT_TRUE(LogCodec::decode(packed, packedSize, [&](uint64_t epochMs, const BinaryLogRecord& decoded) {
+        bootEpochMs = epochMs;
+        LogHandler::formatBinary(decoded, line, sizeof(line));
+    }));
+    TEST_ASSERT_EQUAL_UINT64(1700000000000ULL, bootEpochMs);
+    TEST_ASSERT_EQUAL_STRING("Negative response (NRC 31) for service 1", line);
+}
+
+int main(int, char**) {
+    LogHandler::setClock(&HostClock::instance());
+    UNITY_BEGIN();
+    RUN_TEST(test_binary_record_formatted_at_drain_time);
+    RUN_TEST(test_binary_stream_decodes_and_formats);
+    return UNITY_END();
+}
@@ -0,0 +1,35 @@
+// LoopProfiler histograms
+#include <Arduino.h>
+#include <unity.h>
+
+#include "PROFILE/LoopProfiler.hpp"
+
+void setUp() {
+    LoopProfiler::reset();
+}
+
+void tearDown() {}
+
+// 1..1000 us: percentiles within the 25% bucket resolution
+void test_min_max_exact_percentiles_from_histogram() {
+    for (uint32_t us = 1; us <= 1000; us++) LoopProfiler::record(LoopProfiler::Stage::BLE, us * 1000);
+    LoopProfiler::Summary profile = LoopProfiler::summarize(LoopProfiler::Stage::BLE);
+    TEST_ASSERT_EQUAL(1000, profile.count);
+    TEST_ASSERT_EQUAL(1, profile.minUs);
+    TEST_ASSERT_EQUAL(1000, profile.maxUs);
+    TEST_ASSERT_UINT_WITHIN(62, 562, profile.p50Us);
+    TEST_ASSERT_UINT_WITHIN(5, 995, profile.p99Us);
+}
+
+void test_reset_starts_a_new_window() {
+    LoopProfiler::record(LoopProfiler::Stage::BLE, 1000);
+    LoopProfiler::reset();
+    TEST_ASSERT_EQUAL(0, LoopProfiler::summarize(LoopProfiler::Stage::BLE).count);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_min_max_exact_percentiles_from_histogram);
+    RUN_TEST(test_reset_starts_a_new_window);
+    return UNITY_END();
+}
@@ -0,0 +1,214 @@
+// PIDScheduler deadlines, priorities and achieved rates on a manual clock
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+
+#include "CAN/PIDScheduler.hpp"
+#include "HOST/HostClock.hpp"
+
+namespace {
+
+// Requests every due PID each tick and answers it at once, like a bus with
+// no latency polled every tickMs
+void run(PIDScheduler& scheduler, unsigned long durationMs, unsigned long tickMs, unsigned long* requests) {
+    HostClock& clock = HostClock::instance();
+    for (unsigned long elapsed = 0; elapsed < durationMs; elapsed += tickMs) {
+        unsigned long now = clock.millis();
+        uint8_t pid;
+        std::vector<uint8_t> sent;
+        while (scheduler.popDue(now, pid)) sent.push_back(pid);
+        for (uint8_t p : sent) {
+            scheduler.reschedule(p, now);
+            scheduler.recordSample(p, now);
+            requests[p]++;
+        }
+        clock.advance(tickMs);
+    }
+}
+
+std::vector<uint8_t> popAll(PIDScheduler& scheduler, unsigned long now) {
+    std::vector<uint8_t> order;
+    uint8_t pid;
+    while (scheduler.popDue(now, pid)) order.push_back(pid);
+    return order;
+}
+
+} // namespace
+
+void setUp() {
+    HostClock::instance().setManual(1700000000000ULL);
+}
+
+void tearDown() {}
+
+void test_requests_follow_the_target_rates() {
+    PIDScheduler scheduler;
+    unsigned long now = HostClock::instance().millis();
+    scheduler.set(0x0C, 100, 0, now);  // 10 Hz
+    scheduler.set(0x05, 1000, 0, now); // 1 Hz
+    unsigned long requests[256] = {};
+    run(scheduler, 20000, 10, requests);
+    TEST_ASSERT_UINT_WITHIN(2, 200, requests[0x0C]);
+    TEST_ASSERT_UINT_WITHIN(1, 20, requests[0x05]);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 10.0f, (float)requests[0x0C] / requests[0x05]);
+}
+
+void test_achieved_rate_converges_to_target() {
+    PIDScheduler scheduler;
+    unsigned long now = HostClock::instance().millis();
+    scheduler.set(0x0C, 100, 0, now);
+    scheduler.set(0x05, 1000, 0, now);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, scheduler.getAchievedHz(0x0C));
+    unsigned long requests[256] = {};
+    // Two full rate windows
+    run(scheduler, 20010, 10, requests);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 10.0f, scheduler.getAchievedHz(0x0C));
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 1.0f, scheduler.getAchievedHz(0x05));
+
+    PIDScheduler::Stats stats;
+    TEST_ASSERT_TRUE(scheduler.getStats(0, stats));
+    TEST_ASSERT_EQUAL_HEX8(0x0C, stats.pid);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.0f, stats.targetHz);
+    TEST_ASSERT_EQUAL(requests[0x0C], stats.requests);
+    TEST_ASSERT_EQUAL(requests[0x0C], stats.samples);
+    TEST_ASSERT_FALSE(scheduler.getStats(2, stats));
+}
+
+// Unanswered requests lower the achieved rate, not the request rate
+void test_achieved_rate_counts_responses() {
+    PIDScheduler scheduler;
+    HostClock& clock = HostClock::instance();
+    scheduler.set(0x0C, 100, 0, clock.millis());
+    for (int i = 0; i < 201; i++) {
+        unsigned long now = clock.millis();
+        uint8_t pid;
+        TEST_ASSERT_TRUE(scheduler.popDue(now, pid));
+        scheduler.reschedule(pid, now);
+        if (i % 2 == 0) scheduler.recordSample(pid, now);
+        clock.advance(100);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 5.0f, scheduler.getAchievedHz(0x0C));
+}
+
+void test_priority_breaks_deadline_ties() {
+    PIDScheduler scheduler;
+    unsigned long now = HostClock::instance().millis();
+    scheduler.set(0x05, 1000, 1, now);
+    scheduler.set(0x0C, 1000, 5, now);
+    scheduler.set(0x0D, 1000, 3, now);
+    scheduler.set(0x0F, 1000, 0, now);
+    std::vector<uint8_t> order = popAll(scheduler, now);
+    TEST_ASSERT_EQUAL(4, order.size());
+    TEST_ASSERT_EQUAL_HEX8(0x0C, order[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x0D, order[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x05, order[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x0F, order[3]);
+}
+
+// An earlier deadline wins over a higher priority
+void test_earliest_deadline_first() {
+    PIDScheduler scheduler;
+    HostClock& clock = HostClock::instance();
+    unsigned long now = clock.millis();
+    scheduler.set(0x0C, 300, 9, now);
+    scheduler.set(0x0D, 100, 0, now);
+    std::vector<uint8_t> order = popAll(scheduler, now);
+    for (uint8_t pid : order) scheduler.reschedule(pid, now);
+    TEST_ASSERT_EQUAL(100, scheduler.timeUntilNext(now));
+    clock.advance(100);
+    order = popAll(scheduler, clock.millis());
+    TEST_ASSERT_EQUAL(1, order.size());
+    TEST_ASSERT_EQUAL_HEX8(0x0D, order[0]);
+    TEST_ASSERT_EQUAL(0, scheduler.timeUntilNext(clock.millis() + 200));
+}
+
+// A PID that could not be sent keeps its deadline and comes first again
+void test_restore_keeps_the_deadline() {
+    PIDScheduler scheduler;
+    unsigned long now = HostClock::instance().millis();
+    scheduler.set(0x0C, 100, 0, now);
+    scheduler.set(0x0D, 100, 0, now + 50);
+    uint8_t pid;
+    TEST_ASSERT_TRUE(scheduler.popDue(now, pid));
+    TEST_ASSERT_EQUAL_HEX8(0x0C, pid);
+    scheduler.restore(pid);
+    TEST_ASSERT_EQUAL(0, scheduler.timeUntilNext(now));
+    TEST_ASSERT_TRUE(scheduler.popDue(now, pid));
+    TEST_ASSERT_EQUAL_HEX8(0x0C, pid);
+    TEST_ASSERT_FALSE_MESSAGE(scheduler.popDue(now, pid), "0x0D not due yet");
+}
+
+// Running behind does not queue up missed slots
+void test_no_catch_up_after_a_stall() {
+    PIDScheduler scheduler;
+    HostClock& clock = HostClock::instance();
+    scheduler.set(0x0C, 100, 0, clock.millis());
+    uint8_t pid;
+    TEST_ASSERT_TRUE(scheduler.popDue(clock.millis(), pid));
+    clock.advance(1000);
+    scheduler.reschedule(pid, clock.millis());
+    TEST_ASSERT_EQUAL_MESSAGE(0, scheduler.timeUntilNext(clock.millis()), "due once");
+    TEST_ASSERT_TRUE(scheduler.popDue(clock.millis(), pid));
+    scheduler.reschedule(pid, clock.millis());
+    TEST_ASSERT_EQUAL(100, scheduler.timeUntilNext(clock.millis()));
+}
+
+void test_shorter_period_applies_immediately() {
+    PIDScheduler scheduler;
+    unsigned long now = HostClock::instance().millis();
+    scheduler.set(0x0C, 1000, 0, now);
+    uint8_t pid;
+    TEST_ASSERT_TRUE(scheduler.popDue(now, pid));
+    scheduler.reschedule(pid, now);
+    TEST_ASSERT_EQUAL(1000, scheduler.timeUntilNext(now));
+    scheduler.set(0x0C, 100, 0, now);
+    TEST_ASSERT_EQUAL(100, scheduler.timeUntilNext(now));
+}
+
+void test_remove_and_capacity() {
+    PIDScheduler scheduler;
+    unsigned long now = HostClock::instance().millis();
+    for (uint8_t i = 0; i < PIDScheduler::MAX_ENTRIES; i++) TEST_ASSERT_TRUE(scheduler.set(i, 100 + i, 0, now + i));
+    TEST_ASSERT_FALSE(scheduler.set(0xFF, 100, 0, now));
+    TEST_ASSERT_TRUE(scheduler.remove(0));
+    TEST_ASSERT_FALSE(scheduler.remove(0));
+    TEST_ASSERT_FALSE(scheduler.contains(0));
+    TEST_ASSERT_EQUAL(PIDScheduler::MAX_ENTRIES - 1, scheduler.size());
+    // The heap stays ordered after the last entry moved into the freed slot
+    std::vector<uint8_t> order = popAll(scheduler, now + 1000);
+    TEST_ASSERT_EQUAL(PIDScheduler::MAX_ENTRIES - 1, order.size());
+    for (size_t i = 0; i < order.size(); i++) TEST_ASSERT_EQUAL(i + 1, order[i]);
+}
+
+// Deadlines compare across the millis() wrap
+void test_deadlines_across_millis_wrap() {
+    PIDScheduler scheduler;
+    unsigned long now = (unsigned long)-50;
+    scheduler.set(0x0C, 100, 0, now);
+    scheduler.set(0x0D, 10, 0, now + 60); // Deadline 10 after the wrap
+    uint8_t pid;
+    TEST_ASSERT_TRUE(scheduler.popDue(now, pid));
+    TEST_ASSERT_EQUAL_HEX8(0x0C, pid);
+    scheduler.reschedule(pid, now); // Next at 50 after the wrap
+    TEST_ASSERT_FALSE(scheduler.popDue(now, pid));
+    TEST_ASSERT_EQUAL(60, scheduler.timeUntilNext(now));
+    std::vector<uint8_t> order = popAll(scheduler, now + 100);
+    TEST_ASSERT_EQUAL(2, order.size());
+    TEST_ASSERT_EQUAL_HEX8(0x0D, order[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x0C, order[1]);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_requests_follow_the_target_rates);
+    RUN_TEST(test_achieved_rate_converges_to_target);
+    RUN_TEST(test_achieved_rate_counts_responses);
+    RUN_TEST(test_priority_breaks_deadline_ties);
+    RUN_TEST(test_earliest_deadline_first);
+    RUN_TEST(test_restore_keeps_the_deadline);
+    RUN_TEST(test_no_catch_up_after_a_stall);
+    RUN_TEST(test_shorter_period_applies_immediately);
+    RUN_TEST(test_remove_and_capacity);
+    RUN_TEST(test_deadlines_across_millis_wrap);
+    return UNITY_END();
+}
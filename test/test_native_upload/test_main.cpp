@@ -0,0 +1,168 @@
+// UploadHandler batches, formats and overflow; LogUploadHandler flushes
+#include <Arduino.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+#include "HOST/FakeUplink.hpp"
+#include "HOST/HostClock.hpp"
+#include "LOG/LogHandler.hpp"
+#include "SETTINGS/SettingsHandler.hpp"
+#include "UPLOAD/LogUploadHandler.hpp"
+#include "UPLOAD/UploadHandler.hpp"
+#include "UTILS/JsonString.hpp"
+
+namespace {
+
+void addPID(PIDTable& pids, byte pid, const char* label, const char* formula) {
+    PIDConfig& config = pids.add(pid);
+    config.label = label;
+    config.formula = formula;
+    config.program.compile(formula);
+}
+
+SampleRecord sample(uint8_t pid, uint8_t a, uint8_t b = 0, uint8_t len = 1) {
+    SampleRecord record = {};
+    record.timestampMs = HostClock::instance().millis();
+    record.ecuId = 0x7E8;
+    record.pid = pid;
+    record.len = len;
+    record.data[0] = a;
+    record.data[1] = b;
+    return record;
+}
+
+// RPM 1726 and speed 50, as parsed from one response
+struct Fixture {
+    HostClock& clock = HostClock::instance();
+    SharedPIDTable pidTables;
+    FakeUplink uplink;
+    UploadHandler uploadHandler{uplink, clock, pidTables};
+    std::vector<SampleRecord> samples;
+
+    Fixture() {
+        std::shared_ptr<PIDTable> pids = std::make_shared<PIDTable>();
+        addPID(*pids, 0x0C, "RPM", "((A*256)+B)/4");
+        addPID(*pids, 0x0D, "Speed", "A");
+        pidTables.publish(pids);
+        samples.push_back(sample(0x0C, 0x1A, 0xF8, 2));
+        samples.push_back(sample(0x0D, 0x32));
+    }
+};
+
+} // namespace
+
+void setUp() {
+    HostClock::instance().setManual(1700000000000ULL);
+    HostClock::instance().advance(1000);
+    SettingsHandler::setUploadBatchSize(2);
+    SettingsHandler::setUploadFormat(SettingsHandler::UPLOAD_FORMAT_JSON);
+}
+
+void tearDown() {
+    SettingsHandler::setEnableLogs(false);
+}
+
+void test_batch_uploaded_once_full() {
+    Fixture f;
+    f.uploadHandler.addData(f.samples);
+    TEST_ASSERT_TRUE(f.uploadHandler.sendData());
+    TEST_ASSERT_EQUAL(1, f.uplink.getUpdates().size());
+    const FakeUplink::Update& update = f.uplink.getUpdates()[0];
+    TEST_ASSERT_EQUAL_STRING("readings", update.node.c_str());
+    // Values decoded with the PID formulas
+    TEST_ASSERT_TRUE(update.json.find("\"RPM\":1726") != std::string::npos);
+    TEST_ASSERT_TRUE(update.json.find("\"Speed\":50") != std::string::npos);
+}
+
+// Keys stay unique within one millisecond: other ECUs get their ID appended,
+// a PID repeated by the same ECU keeps its last value
+void test_json_keys_unique_per_millisecond() {
+    Fixture f;
+    TimedSample samples[4];
+    for (TimedSample& timed : samples) timed.epochMs = 1700000001000ULL;
+    samples[0].sample = sample(0x0D, 10);
+    samples[1].sample = sample(0x0D, 20);
+    samples[1].sample.ecuId = 0x7E9;
+    samples[2].sample = sample(0x0D, 30);
+    samples[3].sample = sample(0x0C, 0x1A, 0xF8, 2);
+    samples[3].sample.ecuId = 0x7E9;
+    String json;
+    TEST_ASSERT_EQUAL(3, f.uploadHandler.buildJson(samples, 4, json));
+    TEST_ASSERT_EQUAL_STRING("{\"1700000001000\":{\"Speed@7E9\":20,\"Speed\":30,\"RPM@7E9\":1726}}", json.c_str());
+    TEST_ASSERT_EQUAL(1, f.uploadHandler.getUploadStats().superseded);
+}
+
+void test_compact_batch_goes_to_batches() {
+    Fixture f;
+    SettingsHandler::setUploadFormat(SettingsHandler::UPLOAD_FORMAT_COMPACT);
+    f.uploadHandler.addData(f.samples);
+    TEST_ASSERT_TRUE(f.uploadHandler.sendData());
+    TEST_ASSERT_EQUAL(1, f.uplink.getUpdates().size());
+    TEST_ASSERT_EQUAL_STRING("batches", f.uplink.getUpdates()[0].node.c_str());
+}
+
+void test_labels_escaped_in_json_strings() {
+    String quoted;
+    appendJsonString(quoted, "Boost \"A\"\\B\n");
+    TEST_ASSERT_EQUAL_STRING("\"Boost \\\"A\\\"\\\\B \"", quoted.c_str());
+}
+
+// Offline without a journal the oldest samples are dropped a chunk at a time
+void test_batch_overflow_dropped_as_one_range() {
+    Fixture f;
+    f.uplink.setOnline(false);
+    std::vector<SampleRecord> overflow(SettingsHandler::MAX_UPLOAD_BATCH_SIZE + 1, f.samples[0]);
+    f.uploadHandler.addData(overflow);
+    unsigned long dropped = f.uploadHandler.getUploadStats().dropped;
+    TEST_ASSERT_GREATER_THAN(1, dropped);
+    TEST_ASSERT_EQUAL(overflow.size() - dropped, f.uploadHandler.getPendingSamples());
+}
+
+// Logs of one interval go out as a single update
+void test_logs_flushed_as_one_update() {
+    HostClock& clock = HostClock::instance();
+    FakeUplink uplink;
+    LogUploadHandler logUploader(uplink, clock);
+    SettingsHandler::setEnableLogs(true);
+    std::string second = std::to_string(clock.epochMs() / 1000);
+    LogHandler::writeMessage(LogHandler::DebugType::CAN, "first \"quoted\" message");
+    LogHandler::writeMessage(LogHandler::DebugType::WARNING, "second message");
+    TEST_ASSERT_FALSE_MESSAGE(logUploader.flush(), "no log flush before the interval");
+    clock.advance(LogUploadHandler::FLUSH_INTERVAL_MS);
+    TEST_ASSERT_TRUE(logUploader.flush());
+    TEST_ASSERT_EQUAL(1, uplink.getUpdates().size());
+    TEST_ASSERT_EQUAL_STRING("logs", uplink.getUpdates()[0].node.c_str());
+    // Keyed by type and second
+    const std::string& json = uplink.getUpdates()[0].json;
+    TEST_ASSERT_TRUE(json.find("\"CAN/" + second + "\":{\"timestamp\":\"" + second + "\",\"message\":\"first \\\"quoted\\\" message\"}") != std::string::npos);
+    TEST_ASSERT_TRUE(json.find("WARNING/") != std::string::npos);
+}
+
+// Over the byte budget the oldest entries are replaced by a summary
+void test_log_flush_stays_within_byte_budget() {
+    HostClock& clock = HostClock::instance();
+    FakeUplink uplink;
+    LogUploadHandler logUploader(uplink, clock);
+    SettingsHandler::setEnableLogs(true);
+    std::string longMessage(LogHandler::LogRecord::MAX_MESSAGE - 1, 'x');
+    for (size_t i = 0; i < LogHandler::UPLOAD_QUEUE_SIZE; i++) LogHandler::writeMessage(LogHandler::DebugType::INFO, longMessage.c_str());
+    clock.advance(LogUploadHandler::FLUSH_INTERVAL_MS);
+    TEST_ASSERT_TRUE(logUploader.flush());
+    TEST_ASSERT_LESS_OR_EQUAL(LogUploadHandler::MAX_FLUSH_BYTES, uplink.getUpdates().back().json.length());
+    TEST_ASSERT_GREATER_THAN(0, logUploader.getStats().dropped);
+    TEST_ASSERT_TRUE(uplink.getUpdates().back().json.find("were dropped") != std::string::npos);
+}
+
+int main(int, char**) {
+    LogHandler::setClock(&HostClock::instance());
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_uploaded_once_full);
+    RUN_TEST(test_json_keys_unique_per_millisecond);
+    RUN_TEST(test_compact_batch_goes_to_batches);
+    RUN_TEST(test_labels_escaped_in_json_strings);
+    RUN_TEST(test_batch_overflow_dropped_as_one_range);
+    RUN_TEST(test_logs_flushed_as_one_update);
+    RUN_TEST(test_log_flush_stays_within_byte_budget);
+    return UNITY_END();
+}